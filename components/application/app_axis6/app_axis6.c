@@ -1,5 +1,6 @@
 #include "stdio.h"
 #include "esp_log.h"
+#include "sdkconfig.h"
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -12,6 +13,7 @@
 static const char* TAG = "axis6";
 static int warmup = 5;   // 跳过前5帧（约200ms），按需调，目前测试下来7帧是最好的
 #define AXIS6_IMU_LOG 0  // set to 1 to enable IMU logs
+#define AXIS6_TASK_CORE ((CONFIG_JOFTMODE_AXIS6_TASK_CORE < 0) ? tskNO_AFFINITY : CONFIG_JOFTMODE_AXIS6_TASK_CORE)
 
 t_sQMI8658 qmi8658_info;
 
@@ -67,5 +69,5 @@ static void axis6_task(void* arg)
 
 void app_axis6_start(void)
 {
-    xTaskCreate(axis6_task, "axis6", 8192, NULL, 10, NULL);
+    xTaskCreatePinnedToCore(axis6_task, "axis6", 8192, NULL, 10, NULL, AXIS6_TASK_CORE);
 }
@@ -1,6 +1,7 @@
 #include <string.h>
 
 #include "esp_log.h"
+#include "sdkconfig.h"
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -12,6 +13,8 @@
 
 static const char *TAG = "gps";
 
+#define GPS_TASK_CORE ((CONFIG_JOFTMODE_GPS_TASK_CORE < 0) ? tskNO_AFFINITY : CONFIG_JOFTMODE_GPS_TASK_CORE)
+
 static unsigned char s_read_buf[GPS_BUF_SIZE];
 static char s_line_buf[GPS_BUF_SIZE];
 static size_t s_line_len = 0;
@@ -83,5 +86,5 @@ static void app_gps_task(void *arg)
 
 void app_gps_start(void)
 {
-    xTaskCreate(app_gps_task, "app_gps", 10240, NULL, 10, NULL);
+    xTaskCreatePinnedToCore(app_gps_task, "app_gps", 10240, NULL, 10, NULL, GPS_TASK_CORE);
 }
@@ -1,13 +1,20 @@
 // main/app_gui.c
 #include "app_gui.h"
+#include "app_img.h"
+#include "gui_prof.h"
 #include "display_hal.h"
 #include "ui.h"
+#include "ui_screens.h"
 
 
 #include "lvgl.h"
 #include "esp_log.h"
 #include "esp_err.h"
 #include "esp_timer.h"
+#include "esp_rom_sys.h"
+#include "esp_heap_caps.h"
+#include "esp_attr.h"
+#include "sdkconfig.h"
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -23,11 +30,382 @@
 static const char *TAG = "app_gui";
 static display_hal_t s_hal;              //  s_hal：保�?display_hal
 static esp_lcd_panel_handle_t s_panel_handle = NULL;   //屏幕句柄，用于开关屏
-static bool s_screen_on = true;  //屏幕状�?
+static volatile bool s_screen_on = true;  //屏幕状�?
 static lv_indev_t *s_touch_indev = NULL; //LVGL 输入设备
+// 触控中断、开关屏请求用这个信号量叫醒 GUI 任务。不用任务通知：LVGL 的 FreeRTOS 层
+// （LV_USE_FREERTOS_TASK_NOTIFY）在 lv_timer_handler 里等绘制单元时要用 GUI 任务的通知，会把叫醒吃掉
+static SemaphoreHandle_t s_gui_wake = NULL;
+static StaticSemaphore_t s_gui_wake_buffer;
+#define GUI_TASK_CORE ((CONFIG_JOFTMODE_GUI_TASK_CORE < 0) ? tskNO_AFFINITY : CONFIG_JOFTMODE_GUI_TASK_CORE)
 // Set to 1 to run display_hal_test_once() during startup (useful for panel bring-up).
 #define APP_GUI_RUN_DISPLAY_TEST_ONCE 0
 
+#if CONFIG_JOFTMODE_DISPLAY_ROUND_CLIP
+#define CLIP_BAND_ROWS   24     // 失效区域切带的行数，和行缓冲一样高，一带正好画一次
+#endif
+
+#if CONFIG_JOFTMODE_GUI_EVENT_LOOP
+#define GUI_MAX_SLEEP_MS  1000  // 没有定时器在跑时也最多睡这么久，兜底
+// 触控读定时器平时暂停，INT 中断置位后在 GUI 任务里恢复；松手读到一次 RELEASED 再停
+static bool          s_touch_irq_mode = false;
+static volatile bool s_touch_irq = false;
+#endif
+
+#if CONFIG_JOFTMODE_DISPLAY_STATS
+// GUI 任务空闲统计，和刷屏统计一起每 5 s 打印
+static struct {
+    int64_t  since_us;
+    uint32_t wakeups;
+    uint32_t touch_reads;
+    uint64_t busy_us;           // 在 lv_timer_handler 里的时间
+} s_gui_stats;
+#endif
+
+// 在传的块数，flush_cb 发起传输时自己先占一个；计数归零（传完）才交还缓冲
+static portMUX_TYPE  s_pend_mux = portMUX_INITIALIZER_UNLOCKED;
+static volatile int  s_xfer_pending = 0;
+
+#if CONFIG_JOFTMODE_DISPLAY_STATS
+#define DISP_STATS_INTERVAL_US  (5 * 1000 * 1000)
+
+// 刷屏统计，按帧累加、每 5 s 打印一次平均值。一帧 = REFR_START 到最后一块传完：
+//   render  GUI 任务真正在画的时间（刷新耗时减去等 TE、等上一块传完）
+//   xfer    各块 QSPI 传输之和（draw_bitmap 发起 → 传输完成中断）
+//   overlap render + xfer − 帧耗时，即被渲染掩盖掉的传输时间
+static struct {
+    int64_t  since_us;
+    uint32_t frames;
+    uint32_t flushes;
+    uint64_t bytes;             // 实际发出去的
+    uint64_t bytes_full;        // 不裁剪要发的
+    uint64_t swap_us;
+    uint64_t blocked_us;
+    uint64_t render_us;
+    uint64_t xfer_us;
+    uint32_t xfer_max_us;
+    uint64_t wall_us;
+    uint64_t overlap_us;
+} s_disp_stats;
+
+// 当前帧（GUI 任务里更新）
+static int64_t  s_frame_start_us;
+static int64_t  s_frame_ready_us;
+static int64_t  s_frame_blocked_us;
+static uint32_t s_frame_flushes;
+// 传输：flush_cb 里开始，完成中断里结束
+static portMUX_TYPE s_xfer_mux = portMUX_INITIALIZER_UNLOCKED;
+static int64_t  s_xfer_start_us;
+static int64_t  s_xfer_done_us;
+static bool     s_xfer_busy;
+static uint32_t s_frame_xfer_us;
+static uint32_t s_frame_xfer_max_us;
+
+static void disp_stats_xfer_start(void)
+{
+    taskENTER_CRITICAL(&s_xfer_mux);
+    s_xfer_start_us = esp_timer_get_time();
+    s_xfer_busy = true;
+    taskEXIT_CRITICAL(&s_xfer_mux);
+}
+
+// 一块区域传完时调用（中断里，或 flush_cb 里没发成）。中断里也调，放 IRAM
+static void IRAM_ATTR disp_stats_xfer_done(void)
+{
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL_SAFE(&s_xfer_mux);
+    if (!s_xfer_busy) {
+        portEXIT_CRITICAL_SAFE(&s_xfer_mux);
+        return;
+    }
+    uint32_t dt = (uint32_t)(now - s_xfer_start_us);
+    s_frame_xfer_us += dt;
+    if (dt > s_frame_xfer_max_us) {
+        s_frame_xfer_max_us = dt;
+    }
+    s_xfer_done_us = now;
+    s_xfer_busy = false;
+    portEXIT_CRITICAL_SAFE(&s_xfer_mux);
+}
+
+// 上一帧结算（下一帧开始时做，这时最后一块通常早已传完）
+static void disp_stats_frame_end(int64_t now)
+{
+    if (s_frame_flushes == 0) {
+        return;
+    }
+    taskENTER_CRITICAL(&s_xfer_mux);
+    int64_t end = s_xfer_busy ? now : s_xfer_done_us;
+    uint32_t xfer = s_frame_xfer_us;
+    uint32_t xfer_max = s_frame_xfer_max_us;
+    s_frame_xfer_us = 0;
+    s_frame_xfer_max_us = 0;
+    taskEXIT_CRITICAL(&s_xfer_mux);
+
+    if (end < s_frame_ready_us) {
+        end = s_frame_ready_us;
+    }
+    int64_t wall = end - s_frame_start_us;
+    int64_t render = (s_frame_ready_us - s_frame_start_us) - s_frame_blocked_us;
+    int64_t overlap = render + xfer - wall;
+
+    s_disp_stats.frames++;
+    s_disp_stats.blocked_us += s_frame_blocked_us;
+    s_disp_stats.render_us += render > 0 ? render : 0;
+    s_disp_stats.xfer_us += xfer;
+    if (xfer_max > s_disp_stats.xfer_max_us) {
+        s_disp_stats.xfer_max_us = xfer_max;
+    }
+    s_disp_stats.wall_us += wall;
+    s_disp_stats.overlap_us += overlap > 0 ? overlap : 0;
+    s_frame_flushes = 0;
+
+    int64_t span = now - s_disp_stats.since_us;
+    if (span < DISP_STATS_INTERVAL_US) {
+        return;
+    }
+    uint32_t n = s_disp_stats.frames;
+    ESP_LOGI(TAG, "disp %ubpp: %.1f fps, %u flushes, %u KB/frame (%u%% clipped); per frame render %u us"
+             " (swap %u us), xfer %u us (block max %u us), blocked %u us, total %u us, overlap %u us (%u%%)",
+             (unsigned)s_hal.bits_per_pixel, n * 1e6 / span,
+             (unsigned)s_disp_stats.flushes,
+             (unsigned)(s_disp_stats.bytes / n / 1024),
+             (unsigned)(s_disp_stats.bytes_full ? 100 - s_disp_stats.bytes * 100 / s_disp_stats.bytes_full : 0),
+             (unsigned)(s_disp_stats.render_us / n),
+             (unsigned)(s_disp_stats.swap_us / n),
+             (unsigned)(s_disp_stats.xfer_us / n),
+             (unsigned)s_disp_stats.xfer_max_us,
+             (unsigned)(s_disp_stats.blocked_us / n),
+             (unsigned)(s_disp_stats.wall_us / n),
+             (unsigned)(s_disp_stats.overlap_us / n),
+             (unsigned)(s_disp_stats.xfer_us ? s_disp_stats.overlap_us * 100 / s_disp_stats.xfer_us : 0));
+    memset(&s_disp_stats, 0, sizeof(s_disp_stats));
+    s_disp_stats.since_us = now;
+}
+
+static void refr_event_cb(lv_event_t *e)
+{
+    int64_t now = esp_timer_get_time();
+    if (lv_event_get_code(e) == LV_EVENT_REFR_START) {
+        disp_stats_frame_end(now);
+        s_frame_start_us = now;
+        s_frame_blocked_us = 0;
+    } else {
+        s_frame_ready_us = now;
+    }
+}
+#endif
+
+#if CONFIG_JOFTMODE_GUI_RENDER_BENCH
+static bool s_bench_running = false;
+#endif
+
+#if CONFIG_JOFTMODE_DISPLAY_TE_SCHED
+#define TE_SYNC_TIMEOUT_MS   40     // 两个周期都没等到 TE 就当没有，本帧不排程
+#define TE_UNSYNC_FALLBACK   3      // 连续这么多帧没等到 TE（没接、面板 TE 关了）就不再等，直到 TE 又来
+#define TE_SYNC_SLACK_US     500    // 刚过去不到这么久的 TE 直接用，不再等下一个
+#define TE_MARGIN_LINES      8      // 扫描线估计的余量：TE 后的消隐期、周期抖动
+#define TE_XFER_OVERHEAD_US  30     // 每次 draw_bitmap 的命令、地址窗口开销
+#define TE_HOLD_SPIN_US      150    // 保持的最后这段忙等：esp_timer 回调经定时器任务叫醒 GUI 任务的延迟
+#define TE_STATS_INTERVAL_US (5 * 1000 * 1000)
+
+// 帧对齐 TE 的排程。以本帧对齐的那次 TE 为 f0、刷新周期 T，面板第 k 次刷新在 f0 + k*T + y*T/V 读第 y 行。
+// 一帧的所有带都要落在同一次刷新（target）读到之前、上一次刷新读过之后，这次刷新才是完整的一帧：
+// 第一带定下 target；后面的带赶在 target 之前的刷新里就会被读到（写指针跑到读指针前面）就先等扫描线扫过；
+// 赶不上 target（读指针追上了写指针）这帧就撕裂了，记下来
+static struct {
+    bool     active;
+    int64_t  f0_us;
+    int64_t  period_us;
+    int      target;            // -1：本帧还没有带发出去
+    bool     torn;
+    int64_t  tail_us;           // 已排队的传输预计全部发完的时刻
+    uint32_t last_count;        // 上一帧对齐的 TE 计数
+    uint32_t miss_run;          // 连续没等到 TE 的帧，到 TE_UNSYNC_FALLBACK 后不再等
+    // 统计
+    int64_t  since_us;
+    uint32_t frames;
+    uint32_t unsynced;          // 没等到 TE 的帧
+    uint32_t tears;
+    uint32_t late_bands;
+    uint32_t holds;
+    uint64_t hold_us;
+    uint64_t sync_us;
+    uint32_t pace[4];           // 相邻两帧隔了 1/2/3/≥4 个 TE 周期
+} s_te = { .target = -1 };
+
+// 保持用的单次定时器：到点给信号量。不用任务通知，GUI 任务的通知归 LVGL 等绘制单元用（见 s_gui_wake）
+static esp_timer_handle_t s_te_hold_timer;
+static SemaphoreHandle_t  s_te_hold_sema;
+
+static void te_hold_timer_cb(void *arg)
+{
+    LV_UNUSED(arg);
+    xSemaphoreGive(s_te_hold_sema);
+}
+
+static void te_hold_init(void)
+{
+    s_te_hold_sema = xSemaphoreCreateBinary();
+    const esp_timer_create_args_t args = {
+        .callback = te_hold_timer_cb,
+        .name = "te_hold",
+    };
+    if (!s_te_hold_sema || esp_timer_create(&args, &s_te_hold_timer) != ESP_OK) {
+        ESP_LOGW(TAG, "te_hold timer unavailable, busy-waiting TE holds");
+        s_te_hold_timer = NULL;
+    }
+}
+
+static void te_stats_log(int64_t now)
+{
+    int64_t span = now - s_te.since_us;
+    if (span < TE_STATS_INTERVAL_US) {
+        return;
+    }
+    uint32_t period = 0;
+    (void)display_hal_te_timing(&s_hal, NULL, &period, NULL);
+    uint32_t n = s_te.frames ? s_te.frames : 1;
+    ESP_LOGI(TAG, "te %u.%u Hz: %u frames (%u unsynced), pacing 1T/2T/3T/4T+ %u/%u/%u/%u, "
+             "%u torn (%u late bands), %u holds avg %u us, sync wait %u us/frame",
+             (unsigned)(period ? 1000000 / period : 0), (unsigned)(period ? 10000000 / period % 10 : 0),
+             (unsigned)s_te.frames, (unsigned)s_te.unsynced,
+             (unsigned)s_te.pace[0], (unsigned)s_te.pace[1], (unsigned)s_te.pace[2], (unsigned)s_te.pace[3],
+             (unsigned)s_te.tears, (unsigned)s_te.late_bands,
+             (unsigned)s_te.holds, (unsigned)(s_te.holds ? s_te.hold_us / s_te.holds : 0),
+             (unsigned)(s_te.sync_us / n));
+    uint32_t last_count = s_te.last_count;
+    uint32_t miss_run = s_te.miss_run;
+    memset(&s_te, 0, sizeof(s_te));
+    s_te.target = -1;
+    s_te.last_count = last_count;
+    s_te.miss_run = miss_run;
+    s_te.since_us = now;
+}
+
+// 帧开始（REFR_START）：对齐到 TE，刚过去的 TE 直接用，否则等下一个。
+// 连续几帧都没等到 TE 就不再每帧白等 TE_SYNC_TIMEOUT_MS，直接不排程地刷，display_hal_te_timing 又有效了再恢复
+static void te_frame_start(lv_event_t *e)
+{
+    LV_UNUSED(e);
+    int64_t t0 = esp_timer_get_time();
+    int64_t last;
+    uint32_t period, count;
+
+    te_stats_log(t0);
+    s_te.active = false;
+    s_te.target = -1;
+    s_te.torn = false;
+#if CONFIG_JOFTMODE_GUI_RENDER_BENCH
+    if (s_bench_running) {
+        return;     // 跑分时不对齐 TE，只量渲染和传输
+    }
+#endif
+    bool have = display_hal_te_timing(&s_hal, &last, &period, &count);
+    if (s_te.miss_run >= TE_UNSYNC_FALLBACK) {
+        if (!have) {
+            s_te.unsynced++;
+            return;
+        }
+        ESP_LOGI(TAG, "TE back, scheduling against it again");
+        s_te.miss_run = 0;
+    }
+    if (!have || t0 - last > TE_SYNC_SLACK_US) {
+        (void)xSemaphoreTake(s_hal.te_sema, 0);     // 旧的 TE 不算
+        if (xSemaphoreTake(s_hal.te_sema, pdMS_TO_TICKS(TE_SYNC_TIMEOUT_MS)) != pdTRUE ||
+            !display_hal_te_timing(&s_hal, &last, &period, &count)) {
+            s_te.unsynced++;
+            if (++s_te.miss_run == TE_UNSYNC_FALLBACK) {
+                ESP_LOGW(TAG, "no TE for %d frames, flushing unscheduled until it returns", TE_UNSYNC_FALLBACK);
+            }
+            gui_prof_te_wait((uint32_t)(esp_timer_get_time() - t0));
+            return;
+        }
+    }
+    s_te.miss_run = 0;
+    int64_t t1 = esp_timer_get_time();
+    s_te.sync_us += t1 - t0;
+    gui_prof_te_wait((uint32_t)(t1 - t0));
+#if CONFIG_JOFTMODE_DISPLAY_STATS
+    s_frame_blocked_us += t1 - t0;
+#endif
+
+    if (s_te.last_count != 0) {
+        uint32_t gap = count - s_te.last_count;
+        s_te.pace[gap == 0 ? 0 : (gap > 4 ? 3 : gap - 1)]++;
+    }
+    s_te.last_count = count;
+    s_te.f0_us = last;
+    s_te.period_us = period;
+    s_te.active = true;
+    s_te.frames++;
+}
+
+// 等到 t_us：单次定时器叫醒之前挂起（tick 只有 10 ms，一个 TE 周期里的保持用 vTaskDelay 睡不了），
+// 只有最后 TE_HOLD_SPIN_US 忙等，不占着核 1 饿着同核的 ML 任务
+static void te_hold_until(int64_t t_us)
+{
+    int64_t wait = t_us - esp_timer_get_time();
+    if (wait <= 0) {
+        return;
+    }
+    s_te.holds++;
+    s_te.hold_us += wait;
+    gui_prof_te_wait((uint32_t)wait);
+#if CONFIG_JOFTMODE_DISPLAY_STATS
+    s_frame_blocked_us += wait;
+#endif
+    if (wait > TE_HOLD_SPIN_US && s_te_hold_timer) {
+        (void)xSemaphoreTake(s_te_hold_sema, 0);
+        if (esp_timer_start_once(s_te_hold_timer, (uint64_t)(wait - TE_HOLD_SPIN_US)) == ESP_OK &&
+            xSemaphoreTake(s_te_hold_sema, pdMS_TO_TICKS((uint32_t)(wait / 1000)) + 2) != pdTRUE) {
+            (void)esp_timer_stop(s_te_hold_timer);
+        }
+    }
+    wait = t_us - esp_timer_get_time();
+    if (wait > 0) {
+        esp_rom_delay_us((uint32_t)wait);
+    }
+}
+
+// 一带（y1..y2 行，bytes 字节）发起传输之前调用：按估算的扫描线决定马上发还是先等
+static void te_schedule_band(int y1, int y2, uint32_t bytes)
+{
+    if (!s_te.active) {
+        return;
+    }
+    const int64_t T = s_te.period_us;
+    const int64_t v = s_hal.ver_res;
+    const int64_t m = T * TE_MARGIN_LINES / v;
+    const int64_t dur = (int64_t)bytes * 1000 / s_hal.qspi_bytes_per_ms + TE_XFER_OVERHEAD_US;
+    // 第 0 次刷新开始读、读完这带行的时刻（各加余量）
+    const int64_t read_in = s_te.f0_us + T * y1 / v - m;
+    const int64_t read_out = s_te.f0_us + T * (y2 + 1) / v + m;
+
+    int64_t now = esp_timer_get_time();
+    int64_t ts = (now > s_te.tail_us) ? now : s_te.tail_us;
+    if (s_te.target < 0) {
+        // 第一带：能在它读到之前写完的最早一次刷新
+        int64_t over = ts + dur - read_in;
+        s_te.target = (over <= 0) ? 0 : (int)((over + T - 1) / T);
+    }
+    const int64_t win_start = read_out + (s_te.target - 1) * T;
+    const int64_t win_end = read_in + s_te.target * T;
+    if (ts < win_start) {
+        te_hold_until(win_start);
+        now = esp_timer_get_time();
+        ts = (now > s_te.tail_us) ? now : s_te.tail_us;
+    }
+    if (ts + dur > win_end) {
+        s_te.late_bands++;
+        if (!s_te.torn) {
+            s_te.torn = true;
+            s_te.tears++;
+        }
+    }
+    s_te.tail_us = ts + dur;
+}
+#endif
+
 #if 0
 
 static lv_obj_t *s_main_screen = NULL;
@@ -45,29 +423,429 @@ static uint32_t lv_tick_cb(void)  //告诉 LVGL “现在的毫秒数”，LVGL
     return (uint32_t)(esp_timer_get_time() / 1000ULL);
 }
 
+// 放掉一个传输计数（DMA 完成中断或任务里都可能调用）。返回是否归零。
+// SPI 中断在 flash 缓存关闭时（LittleFS 写内部 flash）也会跑，所以这条路径全放 IRAM、不碰 LVGL：
+// 缓冲由 GUI 任务在 flush_wait_cb 里等计数归零后交还
+static bool IRAM_ATTR xfer_release(void)
+{
+    portENTER_CRITICAL_SAFE(&s_pend_mux);
+    bool last = (--s_xfer_pending == 0);
+    portEXIT_CRITICAL_SAFE(&s_pend_mux);
+#if CONFIG_JOFTMODE_DISPLAY_STATS
+    if (last) {
+        disp_stats_xfer_done();
+    }
+#endif
+    return last;
+}
+
 /* ---------- 刷新回调：把 px_map 区域刷到面板 ---------- */
-//LVGL 画完一块区域后回调，把像素数据交给 esp_lcd_panel_draw_bitmap() 真正刷到屏上�?
-//使用 trans_done �?te_sema 做同步，避免撕裂或传输冲突�?
+// LVGL 画完一块区域后回调：只发起 DMA 就返回，期间 LVGL 接着往另一块缓冲里画；
+// LVGL 要再用这块缓冲时进 flush_wait_cb，等传完再交还。防撕裂：帧开始对齐 TE，每带按扫描线排程（JOFTMODE_DISPLAY_TE_SCHED），
+// 不排程时每块等一下 TE。
+// 一块区域只发一次 draw_bitmap：SH8601 的 CASET / RASET 走轮询传输，要先等前面排队的 DMA 全传完，
+// 一块拆成几次发就又变回同步了。圆屏裁剪打开时列窗口取这几行里最宽那行的弦（invalidate_cb 切带时
+// 通常已经裁好，LVGL 合并过的区域在这里再裁一次，就地压紧成连续的行）
 static void flush_cb(lv_display_t *disp, const lv_area_t *area, uint8_t *px_map)
 {
+    LV_UNUSED(disp);
+    const int bpp = s_hal.bits_per_pixel / 8;
+    const int w = lv_area_get_width(area);
+    const int rows = lv_area_get_height(area);
+    int gx1 = area->x1;
+    int gx2 = area->x2;
+    uint32_t sent = 0;
+    gui_prof_flush_begin();
+#if CONFIG_JOFTMODE_DISPLAY_STATS
+    int64_t t_wait = esp_timer_get_time();
+#endif
+
+    // 上一块完成时 LVGL 没进 flush_wait_cb 的话，它的完成信号还留着，先清掉
     if (s_hal.trans_done) (void)xSemaphoreTake(s_hal.trans_done, 0);
-    if (s_hal.te_sema) (void)xSemaphoreTake(s_hal.te_sema, pdMS_TO_TICKS(5));
+#if !CONFIG_JOFTMODE_DISPLAY_TE_SCHED
+    if (s_hal.te_sema) {
+        int64_t t_te = gui_prof_now();
+        (void)xSemaphoreTake(s_hal.te_sema, pdMS_TO_TICKS(5));
+        gui_prof_te_wait((uint32_t)(gui_prof_now() - t_te));
+    }
+#endif
+
+#if CONFIG_JOFTMODE_DISPLAY_STATS
+    s_frame_blocked_us += esp_timer_get_time() - t_wait;
+    s_frame_flushes++;
+    s_disp_stats.flushes++;
+    s_disp_stats.bytes_full += (uint64_t)lv_area_get_size(area) * bpp;
+#endif
+
+#if CONFIG_JOFTMODE_DISPLAY_ROUND_CLIP
+    int vx1, vx2;
+    if (display_hal_visible_span(area->y1, area->y2, &vx1, &vx2)) {
+        if (gx1 < vx1) gx1 = vx1;
+        if (gx2 > vx2) gx2 = vx2;
+    }
+#endif
+    s_xfer_pending = 1;     // flush_cb 自己占一个，发起传输之后再放
+    if (gx1 <= gx2) {
+        const int gw = gx2 - gx1 + 1;
+        // 压紧到缓冲起点：每行目标不超前于源，顺序 memmove 安全
+        if (gw != w) {
+            const uint8_t *src = px_map + (size_t)(gx1 - area->x1) * bpp;
+            for (int r = 0; r < rows; ++r) {
+                memmove(px_map + (size_t)r * gw * bpp, src + (size_t)r * w * bpp, (size_t)gw * bpp);
+            }
+        }
+#if CONFIG_JOFTMODE_DISPLAY_RGB565_SWAP
+        // LVGL 的 RGB565 是小端，SH8601 要高字节在前；只换要发的像素
+#if CONFIG_JOFTMODE_DISPLAY_STATS
+        int64_t t_swap = esp_timer_get_time();
+#endif
+        lv_draw_sw_rgb565_swap(px_map, (uint32_t)gw * rows);
+#if CONFIG_JOFTMODE_DISPLAY_STATS
+        s_disp_stats.swap_us += esp_timer_get_time() - t_swap;
+#endif
+#endif
+
+        sent = (uint32_t)gw * rows * bpp;
+#if CONFIG_JOFTMODE_DISPLAY_TE_SCHED
+        te_schedule_band(area->y1, area->y2, sent);
+#endif
+        taskENTER_CRITICAL(&s_pend_mux);
+        s_xfer_pending++;
+        taskEXIT_CRITICAL(&s_pend_mux);
+#if CONFIG_JOFTMODE_DISPLAY_STATS
+        disp_stats_xfer_start();
+        s_disp_stats.bytes += sent;
+#endif
+        esp_err_t e = esp_lcd_panel_draw_bitmap(
+            s_hal.panel,
+            gx1, area->y1,
+            gx2 + 1, area->y2 + 1,      //  +1（右下角开区间
+            px_map                      //  格式同 s_hal.bits_per_pixel（RGB565 已换成大端）
+        );
+        if (e != ESP_OK) {
+            // 没发起传输就不会有完成中断
+            ESP_LOGE(TAG, "draw_bitmap failed: %d", (int)e);
+            (void)xfer_release();
+        }
+    }
+    gui_prof_flush_end(sent);
+    (void)xfer_release();
+}
+
+// DMA 传输完成（中断上下文，IRAM）：只放掉计数；display_hal 随后给 trans_done 信号叫醒等待的 GUI 任务
+static bool IRAM_ATTR on_trans_done(void *ctx)
+{
+    (void)ctx;
+    (void)xfer_release();
+    return false;
+}
+
+// LVGL 要用的缓冲还在传：挂起等完成信号，不空转占着 CPU；传完在这里（任务上下文）交还缓冲。
+// disp 为 NULL 时只等传完（熄屏、快照动画借缓冲前）
+static void flush_wait_cb(lv_display_t *disp)
+{
+#if CONFIG_JOFTMODE_DISPLAY_STATS
+    int64_t t0 = esp_timer_get_time();
+#endif
+    int64_t t_prof = gui_prof_now();
+    // 每块传完都会给一次信号，等到计数归零（计数在给信号之前已经减掉）
+    while (s_xfer_pending > 0) {
+        (void)xSemaphoreTake(s_hal.trans_done, portMAX_DELAY);
+    }
+    gui_prof_dma_wait((uint32_t)(gui_prof_now() - t_prof));
+#if CONFIG_JOFTMODE_DISPLAY_STATS
+    s_frame_blocked_us += esp_timer_get_time() - t0;
+#endif
+    if (disp) {
+        lv_display_flush_ready(disp);
+    }
+}
+
+/* ---------- 刷新区域：圆屏裁剪 + 对齐 ---------- */
+// 失效区域按 CLIP_BAND_ROWS 行一带切开，每带只留圆内的列，四角看不见的部分不画。
+// SH8601 的列 / 行起点要是偶数、宽高也要是偶数，否则 16bpp 下整块错位（以前 RGB565 乱码的另一半原因）
+static void invalidate_cb(lv_event_t *e)
+{
+    lv_area_t *area = lv_event_get_invalidated_area(e);
+    area->x1 &= ~1;
+    area->y1 &= ~1;
+    area->x2 |= 1;
+    area->y2 |= 1;
+#if CONFIG_JOFTMODE_DISPLAY_ROUND_CLIP
+    lv_display_t *disp = (lv_display_t *)lv_event_get_user_data(e);
+    int32_t band_end = (area->y1 / CLIP_BAND_ROWS + 1) * CLIP_BAND_ROWS - 1;
+    if (area->y2 > band_end) {
+        // 后面的带各自再失效一次（会再进这里，只裁不切），这次只留第一带
+        lv_area_t band = *area;
+        for (band.y1 = band_end + 1; band.y1 <= area->y2; band.y1 += CLIP_BAND_ROWS) {
+            band.y2 = band.y1 + CLIP_BAND_ROWS - 1;
+            if (band.y2 > area->y2) band.y2 = area->y2;
+            lv_inv_area(disp, &band);
+        }
+        area->y2 = band_end;
+    }
+
+    int vx1, vx2;
+    if (display_hal_visible_span(area->y1, area->y2, &vx1, &vx2)) {
+        if (area->x1 > vx2) {
+            // 整块在圆外：事件里取消不了这次失效，缩成圆边上的 2 列
+            area->x1 = vx2 - 1;
+            area->x2 = vx2;
+        } else if (area->x2 < vx1) {
+            area->x1 = vx1;
+            area->x2 = vx1 + 1;
+        } else {
+            if (area->x1 < vx1) area->x1 = vx1;
+            if (area->x2 > vx2) area->x2 = vx2;
+        }
+    }
+#endif
+}
+
+#if CONFIG_JOFTMODE_DISPLAY_ROUND_CLIP
+// 整屏重绘时按上面的分带实际要画、要发的量（每带一个列窗口，画多少发多少）
+static void log_round_clip_saving(void)
+{
+    const uint32_t bpp = s_hal.bits_per_pixel / 8;
+    uint32_t full = (uint32_t)s_hal.hor_res * s_hal.ver_res;
+    uint32_t sent = 0;
+    int x1, x2;
+    for (int by1 = 0; by1 < s_hal.ver_res; by1 += CLIP_BAND_ROWS) {
+        int by2 = by1 + CLIP_BAND_ROWS - 1;
+        if (by2 > s_hal.ver_res - 1) by2 = s_hal.ver_res - 1;
+        if (display_hal_visible_span(by1, by2, &x1, &x2)) {
+            sent += (uint32_t)(x2 - x1 + 1) * (by2 - by1 + 1);
+        }
+    }
+    ESP_LOGI(TAG, "round clip: full redraw %u KB -> render and send %u KB (%u%% less QSPI traffic)",
+             (unsigned)(full * bpp / 1024), (unsigned)(sent * bpp / 1024),
+             (unsigned)((full - sent) * 100 / full));
+}
+#endif
+
 
-    esp_err_t e = esp_lcd_panel_draw_bitmap(
-        s_hal.panel,
-        area->x1, area->y1,
-        area->x2 + 1, area->y2 + 1,     //  +1（右下角开区间
-        px_map                          //  RGB888�?B/像素，试过rgb5xx会乱码
-    );
+#if CONFIG_JOFTMODE_GUI_SNAPSHOT_ANIM
+/* ---------- 快照切屏动画 ---------- */
+// LVGL 的切屏动画每帧要把新旧两屏整个重画一遍，再按 24 行一带发出去，QSPI 这边跟不上就卡。
+// 这里切屏时把旧屏、新屏各画一次到 PSRAM 快照（格式同面板，RGB565 已换好字节序），动画每帧只按偏移
+// 从两张快照拷行、拼进 LVGL 的两块行缓冲发出去（一块在传时拼另一块），不经过 LVGL 渲染。
+// 帧对齐 TE、按扫描线排程和圆屏裁剪都跟 flush_cb 一样。只接 MOVE / OVER / OUT 这几种平移动画
+// （线性，同 LVGL），淡入淡出之类还交给 LVGL
+typedef struct {
+    lv_screen_load_anim_t anim;
+    const char *name;
+    int8_t old_to[2];           // 旧屏结束时的偏移（屏宽 / 屏高的倍数），从 (0, 0) 开始
+    int8_t new_from[2];         // 新屏开始时的偏移，到 (0, 0) 结束
+    bool   old_on_top;
+} snap_anim_def_t;
 
-    if (e == ESP_OK && s_hal.trans_done) {
+static const snap_anim_def_t k_snap_anims[] = {
+    { LV_SCR_LOAD_ANIM_OVER_LEFT,   "over_left",   {  0,  0 }, {  1,  0 }, false },
+    { LV_SCR_LOAD_ANIM_OVER_RIGHT,  "over_right",  {  0,  0 }, { -1,  0 }, false },
+    { LV_SCR_LOAD_ANIM_OVER_TOP,    "over_top",    {  0,  0 }, {  0,  1 }, false },
+    { LV_SCR_LOAD_ANIM_OVER_BOTTOM, "over_bottom", {  0,  0 }, {  0, -1 }, false },
+    { LV_SCR_LOAD_ANIM_MOVE_LEFT,   "move_left",   { -1,  0 }, {  1,  0 }, false },
+    { LV_SCR_LOAD_ANIM_MOVE_RIGHT,  "move_right",  {  1,  0 }, { -1,  0 }, false },
+    { LV_SCR_LOAD_ANIM_MOVE_TOP,    "move_top",    {  0, -1 }, {  0,  1 }, false },
+    { LV_SCR_LOAD_ANIM_MOVE_BOTTOM, "move_bottom", {  0,  1 }, {  0, -1 }, false },
+    { LV_SCR_LOAD_ANIM_OUT_LEFT,    "out_left",    { -1,  0 }, {  0,  0 }, true },
+    { LV_SCR_LOAD_ANIM_OUT_RIGHT,   "out_right",   {  1,  0 }, {  0,  0 }, true },
+    { LV_SCR_LOAD_ANIM_OUT_TOP,     "out_top",     {  0, -1 }, {  0,  0 }, true },
+    { LV_SCR_LOAD_ANIM_OUT_BOTTOM,  "out_bottom",  {  0,  1 }, {  0,  0 }, true },
+};
+
+static struct {
+    lv_display_t  *disp;
+    lv_color_format_t cf;
+    lv_draw_buf_t  snap[2];     // 0 旧屏，1 新屏；第一次切屏时分配，之后一直留着
+    uint8_t       *band[2];     // LVGL 的两块行缓冲，动画期间 LVGL 不画，借来拼行
+    int            band_rows;
+    // 钩子里记下的切屏，GUI 任务在 lv_timer_handler 返回后执行
+    lv_obj_t      *scr;
+    const snap_anim_def_t *def;
+    uint32_t       time_ms;
+    uint32_t       delay_ms;
+} s_snap;
+
+static bool snap_alloc(void)
+{
+    if (s_snap.snap[1].data) {
+        return true;
+    }
+    const uint32_t stride = (uint32_t)s_hal.hor_res * (s_hal.bits_per_pixel / 8);
+    const uint32_t size = stride * s_hal.ver_res;
+    for (int i = 0; i < 2; ++i) {
+        void *p = heap_caps_aligned_alloc(LV_DRAW_BUF_ALIGN, size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (!p) {
+            ESP_LOGW(TAG, "no PSRAM for %u KB screen snapshots, using LVGL transitions",
+                     (unsigned)(2 * size / 1024));
+            if (i == 1) {
+                heap_caps_free(s_snap.snap[0].data);
+                s_snap.snap[0].data = NULL;
+            }
+            return false;
+        }
+        lv_draw_buf_init(&s_snap.snap[i], s_hal.hor_res, s_hal.ver_res, s_snap.cf, stride, p, size);
+    }
+    return true;
+}
+
+static bool snap_take(int i, lv_obj_t *scr)
+{
+    lv_obj_update_layout(scr);
+    if (lv_snapshot_take_to_draw_buf(scr, s_snap.cf, &s_snap.snap[i]) != LV_RESULT_OK) {
+        ESP_LOGW(TAG, "snapshot failed");
+        return false;
+    }
+#if CONFIG_JOFTMODE_DISPLAY_RGB565_SWAP
+    lv_draw_sw_rgb565_swap(s_snap.snap[i].data, (uint32_t)s_hal.hor_res * s_hal.ver_res);
+#endif
+    return true;
+}
+
+// 快照 i 平移 (dx, dy) 后落在第 y 行 gx1..gx2 列的部分拷到 row（row 对应 gx1）
+static void snap_blit_row(uint8_t *row, int i, int dx, int dy, int y, int gx1, int gx2)
+{
+    const int bpp = s_hal.bits_per_pixel / 8;
+    const int sy = y - dy;
+    if (sy < 0 || sy >= s_hal.ver_res) {
+        return;
+    }
+    int x1 = (gx1 > dx) ? gx1 : dx;
+    int x2 = (gx2 < dx + s_hal.hor_res - 1) ? gx2 : dx + s_hal.hor_res - 1;
+    if (x1 > x2) {
+        return;
+    }
+    const lv_draw_buf_t *s = &s_snap.snap[i];
+    memcpy(row + (size_t)(x1 - gx1) * bpp,
+           s->data + (size_t)sy * s->header.stride + (size_t)(x1 - dx) * bpp,
+           (size_t)(x2 - x1 + 1) * bpp);
+}
+
+// 等到在传的带不超过 allowed 个（传输按发起顺序完成）
+static void snap_wait_pending(int allowed)
+{
+    while (s_xfer_pending > allowed) {
         (void)xSemaphoreTake(s_hal.trans_done, portMAX_DELAY);
-    } else if (e != ESP_OK) {
-        ESP_LOGE(TAG, "draw_bitmap failed: %d", (int)e);
     }
+}
+
+// 拼一帧发出去：off[i] 是快照 i 的偏移，top 是盖在上面的那张（平移时两张不重叠，谁在上都一样）
+static void snap_send_frame(const int off[2][2], int top)
+{
+    const int bpp = s_hal.bits_per_pixel / 8;
+    const int bottom = top ^ 1;
+    int buf = 0;
+    int prev_sent = 0;
+
+#if CONFIG_JOFTMODE_DISPLAY_TE_SCHED
+    te_frame_start(NULL);
+#endif
+    for (int by1 = 0; by1 < s_hal.ver_res; by1 += s_snap.band_rows) {
+        int by2 = by1 + s_snap.band_rows - 1;
+        if (by2 > s_hal.ver_res - 1) by2 = s_hal.ver_res - 1;
+        // 这块缓冲上上一带用过：等到只剩上一带还在传
+        snap_wait_pending(prev_sent);
+#if !CONFIG_JOFTMODE_DISPLAY_TE_SCHED
+        if (s_hal.te_sema) (void)xSemaphoreTake(s_hal.te_sema, pdMS_TO_TICKS(5));
+#endif
+        // 和 flush_cb 一样每带一个列窗口（最宽那行的弦），一次 draw_bitmap
+        uint8_t *dst = s_snap.band[buf];
+        int gx1 = 0;
+        int gx2 = s_hal.hor_res - 1;
+#if CONFIG_JOFTMODE_DISPLAY_ROUND_CLIP
+        (void)display_hal_visible_span(by1, by2, &gx1, &gx2);
+#endif
+        const int gw = gx2 - gx1 + 1;
+        for (int y = by1; y <= by2; ++y) {
+            uint8_t *row = dst + (size_t)(y - by1) * gw * bpp;
+            snap_blit_row(row, bottom, off[bottom][0], off[bottom][1], y, gx1, gx2);
+            snap_blit_row(row, top, off[top][0], off[top][1], y, gx1, gx2);
+        }
+#if CONFIG_JOFTMODE_DISPLAY_TE_SCHED
+        te_schedule_band(by1, by2, (uint32_t)gw * (by2 - by1 + 1) * bpp);
+#endif
+        taskENTER_CRITICAL(&s_pend_mux);
+        s_xfer_pending++;
+        taskEXIT_CRITICAL(&s_pend_mux);
+        prev_sent = 1;
+        if (esp_lcd_panel_draw_bitmap(s_hal.panel, gx1, by1, gx2 + 1, by2 + 1, dst) != ESP_OK) {
+            ESP_LOGE(TAG, "draw_bitmap failed");
+            (void)xfer_release();
+            prev_sent = 0;
+        }
+        buf ^= 1;
+    }
+}
+
+static void snap_anim_run(void)
+{
+    lv_obj_t *scr = s_snap.scr;
+    const snap_anim_def_t *d = s_snap.def;
+    s_snap.scr = NULL;
+    if (s_snap.delay_ms) {
+        vTaskDelay(pdMS_TO_TICKS(s_snap.delay_ms));
+    }
+    flush_wait_cb(s_snap.disp); // LVGL 上一帧传完，行缓冲才能借
+
+    int64_t t0 = esp_timer_get_time();
+    if (!snap_take(0, lv_screen_active()) || !snap_take(1, scr)) {
+        lv_screen_load_anim(scr, d->anim, s_snap.time_ms, 0, false);
+        return;
+    }
+    int64_t t1 = esp_timer_get_time();
+
+    const int64_t dur = (int64_t)s_snap.time_ms * 1000;
+    const int w = s_hal.hor_res;
+    const int h = s_hal.ver_res;
+    uint32_t frames = 0;
+    int64_t el;
+    do {
+        el = esp_timer_get_time() - t1;
+        if (el > dur) el = dur;
+        // 线性插值，和 LVGL 的切屏动画一样
+        const int off[2][2] = {
+            { (int)(d->old_to[0] * w * el / dur), (int)(d->old_to[1] * h * el / dur) },
+            { (int)(d->new_from[0] * w * (dur - el) / dur), (int)(d->new_from[1] * h * (dur - el) / dur) },
+        };
+        snap_send_frame(off, d->old_on_top ? 0 : 1);
+        frames++;
+    } while (el < dur);
+    snap_wait_pending(0);
+    int64_t t2 = esp_timer_get_time();
 
-    lv_display_flush_ready(disp);
+    // 最后一帧已经是新屏；LVGL 接手后整屏重画一次，画面不变
+    lv_screen_load(scr);
+    ESP_LOGI(TAG, "snapshot %s: %u frames in %u ms (%u.%u fps), snapshots %u ms",
+             d->name, (unsigned)frames, (unsigned)((t2 - t1) / 1000),
+             (unsigned)(frames * 1000000ULL / (uint64_t)(t2 - t1)),
+             (unsigned)(frames * 10000000ULL / (uint64_t)(t2 - t1) % 10),
+             (unsigned)((t1 - t0) / 1000));
+}
+
+// ui_screens 的切屏钩子：能做的平移动画记下来，在 lv_timer_handler 外面跑
+static bool snap_load_hook(lv_obj_t *scr, lv_screen_load_anim_t anim, uint32_t time, uint32_t delay)
+{
+    if (time == 0 || !s_screen_on || scr == lv_screen_active()) {
+        return false;
+    }
+    const snap_anim_def_t *def = NULL;
+    for (size_t i = 0; i < sizeof(k_snap_anims) / sizeof(k_snap_anims[0]); ++i) {
+        if (k_snap_anims[i].anim == anim) {
+            def = &k_snap_anims[i];
+            break;
+        }
+    }
+    if (!def || !snap_alloc()) {
+        return false;
+    }
+    s_snap.scr = scr;
+    s_snap.def = def;
+    s_snap.time_ms = time;
+    s_snap.delay_ms = delay;
+    return true;
 }
+#endif
 
 
 /* ---------- 触控回调函数 ---------- */
@@ -78,6 +856,9 @@ static void touch_read_cb(lv_indev_t * indev, lv_indev_data_t * data)
 
     int32_t x = 0, y = 0;
     bool pressed = app_touch_read(&x, &y); // 调用 C++ 那边的方法
+#if CONFIG_JOFTMODE_DISPLAY_STATS
+    s_gui_stats.touch_reads++;
+#endif
 
     if(pressed) {
         data->state = LV_INDEV_STATE_PRESSED;
@@ -85,9 +866,86 @@ static void touch_read_cb(lv_indev_t * indev, lv_indev_data_t * data)
         data->point.y = y;
     } else {
         data->state = LV_INDEV_STATE_RELEASED;
+#if CONFIG_JOFTMODE_GUI_EVENT_LOOP
+        // 已经把松手报给 LVGL 了，停掉读定时器，不再空读 I2C，等下一次 INT
+        if (s_touch_irq_mode) {
+            lv_timer_pause(lv_indev_get_read_timer(indev));
+        }
+#endif
     }
 }
 
+#if CONFIG_JOFTMODE_GUI_EVENT_LOOP
+// 触控 INT（ISR 里）：记一下，叫醒 GUI 任务去恢复读定时器
+static void touch_irq_cb(void *ctx)
+{
+    LV_UNUSED(ctx);
+    BaseType_t hp_woken = pdFALSE;
+    s_touch_irq = true;
+    if (s_gui_wake) {
+        xSemaphoreGiveFromISR(s_gui_wake, &hp_woken);
+    }
+    if (hp_woken == pdTRUE) portYIELD_FROM_ISR();
+}
+
+static void touch_irq_resume_read(void)
+{
+    if (!s_touch_irq) {
+        return;
+    }
+    s_touch_irq = false;
+    lv_timer_t *t = lv_indev_get_read_timer(s_touch_indev);
+    lv_timer_resume(t);
+    lv_timer_ready(t);
+}
+#endif
+
+// 熄屏/亮屏在 GUI 任务里生效：熄屏前等在途的传输发完，熄屏期间不渲染也不读触控
+static void gui_apply_screen(bool on)
+{
+    if (!s_panel_handle) {
+        return;
+    }
+    if (on) {
+        esp_lcd_panel_disp_on_off(s_panel_handle, true);
+        app_touch_irq_enable(true);
+#if CONFIG_JOFTMODE_GUI_EVENT_LOOP
+        if (!s_touch_irq_mode)
+#endif
+        {
+            lv_timer_resume(lv_indev_get_read_timer(s_touch_indev));
+        }
+        lv_obj_invalidate(lv_screen_active());
+    } else {
+        flush_wait_cb(NULL);
+        app_touch_irq_enable(false);
+        lv_timer_pause(lv_indev_get_read_timer(s_touch_indev));
+        esp_lcd_panel_disp_on_off(s_panel_handle, false);
+    }
+    ESP_LOGI(TAG, "screen %s", on ? "on" : "off");
+}
+
+#if CONFIG_JOFTMODE_DISPLAY_STATS
+static void gui_stats_log(int64_t now)
+{
+    int64_t span = now - s_gui_stats.since_us;
+    if (span < DISP_STATS_INTERVAL_US) {
+        return;
+    }
+    uint32_t ms = (uint32_t)(span / 1000);
+    ESP_LOGI(TAG, "gui: %u.%u wakeups/s, %u.%u touch reads/s, busy %u.%u%%",
+             (unsigned)(s_gui_stats.wakeups * 1000 / ms),
+             (unsigned)(s_gui_stats.wakeups * 10000 / ms % 10),
+             (unsigned)(s_gui_stats.touch_reads * 1000 / ms),
+             (unsigned)(s_gui_stats.touch_reads * 10000 / ms % 10),
+             (unsigned)(s_gui_stats.busy_us * 100 / span),
+             (unsigned)(s_gui_stats.busy_us * 1000 / span % 10));
+    memset(&s_gui_stats, 0, sizeof(s_gui_stats));
+    s_gui_stats.since_us = now;
+    app_img_log_stats();
+}
+#endif
+
 /* update_clock_label()/clock_timer_cb()：更新文字时间，每秒 +1�?*/
 #if 0
 static void update_clock_label(void)
@@ -137,6 +995,115 @@ static void gesture_event_cb(lv_event_t *e)
 #endif
 
 
+#if CONFIG_JOFTMODE_GUI_RENDER_BENCH
+#define GUI_BENCH_FRAMES  20
+
+// 整屏重画 GUI_BENCH_FRAMES 次：total 是 lv_refr_now 的耗时，render 扣掉了等传输完成的时间。
+// img_uncached 时每帧前清空图片缓存，量压缩图片每次现解的代价
+static void gui_bench_screen(lv_display_t *disp, const char *name, lv_obj_t *scr, bool img_uncached)
+{
+    if (!scr) {
+        return;
+    }
+    lv_screen_load(scr);
+    lv_refr_now(disp);          // 第一遍有布局、样式计算，不算
+
+    int64_t sum = 0, render_sum = 0;
+    int64_t min = INT64_MAX, max = 0;
+    for (int i = 0; i < GUI_BENCH_FRAMES; ++i) {
+        if (img_uncached) {
+            app_img_cache_flush();
+        }
+        lv_obj_invalidate(scr);
+        int64_t t0 = esp_timer_get_time();
+        lv_refr_now(disp);
+        int64_t dt = esp_timer_get_time() - t0;
+        sum += dt;
+        render_sum += dt - s_frame_blocked_us;
+        if (dt < min) min = dt;
+        if (dt > max) max = dt;
+    }
+    ESP_LOGI(TAG, "bench %s%s (%d draw unit%s): total avg %u us (min %u, max %u), render avg %u us",
+             name, img_uncached ? " (images uncached)" : "", LV_DRAW_SW_DRAW_UNIT_CNT, LV_DRAW_SW_DRAW_UNIT_CNT > 1 ? "s" : "",
+             (unsigned)(sum / GUI_BENCH_FRAMES), (unsigned)min, (unsigned)max,
+             (unsigned)(render_sum / GUI_BENCH_FRAMES));
+}
+
+#if CONFIG_JOFTMODE_GUI_SNAPSHOT_ANIM
+static uint32_t s_bench_frames;
+
+static void bench_frame_cb(lv_event_t *e)
+{
+    LV_UNUSED(e);
+    s_bench_frames++;
+}
+
+// 同一个切屏（主页左滑进碳排图，500 ms）LVGL 动画和快照动画各跑一次，比帧率；照常对齐 TE
+static void gui_bench_transition(lv_display_t *disp)
+{
+    lv_obj_t *from = ui_screens_get(UI_SCR_HOME);
+    lv_obj_t *to = ui_screens_get(UI_SCR_CARBON);
+
+    lv_screen_load(from);
+    lv_refr_now(disp);
+    lv_display_add_event_cb(disp, bench_frame_cb, LV_EVENT_REFR_READY, NULL);
+    s_bench_frames = 0;
+    int64_t t0 = esp_timer_get_time();
+    lv_screen_load_anim(to, LV_SCR_LOAD_ANIM_MOVE_LEFT, 500, 0, false);
+    do {
+        (void)lv_timer_handler();
+    } while (lv_anim_count_running() > 0);
+    int64_t dt = esp_timer_get_time() - t0;
+    lv_display_remove_event_cb_with_user_data(disp, bench_frame_cb, NULL);
+    ESP_LOGI(TAG, "bench move_left via LVGL: %u frames in %u ms (%u.%u fps)",
+             (unsigned)s_bench_frames, (unsigned)(dt / 1000),
+             (unsigned)(s_bench_frames * 1000000ULL / (uint64_t)dt),
+             (unsigned)(s_bench_frames * 10000000ULL / (uint64_t)dt % 10));
+
+    lv_screen_load(from);
+    lv_refr_now(disp);
+    if (snap_load_hook(to, LV_SCR_LOAD_ANIM_MOVE_LEFT, 500, 0)) {
+        snap_anim_run();    // 自己打帧率
+    }
+    lv_screen_load(from);
+    lv_refr_now(disp);
+}
+#endif
+
+static void gui_bench_run(lv_display_t *disp)
+{
+    s_bench_running = true;
+    gui_bench_screen(disp, "scrcarbon", ui_screens_get(UI_SCR_CARBON), false);
+    gui_bench_screen(disp, "Calendar", ui_screens_get(UI_SCR_CALENDAR), false);
+    gui_bench_screen(disp, "scrsettings", ui_screens_get(UI_SCR_SETTINGS), false);
+    gui_bench_screen(disp, "scrsettings", ui_screens_get(UI_SCR_SETTINGS), true);
+    app_img_log_stats();
+    gui_bench_screen(disp, "scrhome", ui_screens_get(UI_SCR_HOME), false);    // 最后回到主页
+    s_bench_running = false;
+#if CONFIG_JOFTMODE_GUI_SNAPSHOT_ANIM
+    gui_bench_transition(disp);
+#endif
+}
+#endif
+
+
+// 开机到第一帧画完的时间和那时的 LVGL 内存，只打一次
+static uint32_t s_ui_init_ms;
+
+static void first_frame_cb(lv_event_t *e)
+{
+    static bool done = false;
+    LV_UNUSED(e);
+    if (done) {
+        return;
+    }
+    done = true;
+    ESP_LOGI(TAG, "first frame %u ms after boot (ui_init %u ms)",
+             (unsigned)(esp_timer_get_time() / 1000), (unsigned)s_ui_init_ms);
+    ui_screens_log_mem("first frame");
+}
+
+
 /* ---------- GUI 任务（唯一地方调用 lv_label_set_text---------- */
 static void gui_task(void *arg)
 {
@@ -150,7 +1117,6 @@ static void gui_task(void *arg)
         return;
     }
     s_panel_handle = s_hal.panel;
-    s_screen_on = true;
 
 #if APP_GUI_RUN_DISPLAY_TEST_ONCE
     {
@@ -165,23 +1131,45 @@ static void gui_task(void *arg)
     // 2) 初始�?LVGL & tick
     lv_init();
     lv_tick_set_cb(lv_tick_cb);
+    app_img_init();     // 压缩图片的解码器要在 ui_init() 建图片控件之前注册
 
-    // 3) 创建 display —�?保持 RGB888�? 字节/像素�?
+    // 3) 创建 display，像素格式跟面板（JOFTMODE_DISPLAY_COLOR）一致
+    const lv_color_format_t cf = (s_hal.bits_per_pixel == 16) ? LV_COLOR_FORMAT_RGB565
+                                                              : LV_COLOR_FORMAT_RGB888;
     lv_display_t *disp = lv_display_create(s_hal.hor_res, s_hal.ver_res);
-    lv_display_set_color_format(disp, LV_COLOR_FORMAT_RGB888);
+    lv_display_set_color_format(disp, cf);
+    lv_display_add_event_cb(disp, invalidate_cb, LV_EVENT_INVALIDATE_AREA, disp);
 
-    // 4) 配置行缓冲（格式也用 RGB888）（24 行的 line buffer�?
+    // 4) 配置行缓冲（格式同上）（24 行的 line buffer）
     const uint32_t line_cnt = 24;   // 24 行缓冲，带宽与内存的折中
-    lv_draw_buf_t *dbuf1 = lv_draw_buf_create(
-        s_hal.hor_res, line_cnt, LV_COLOR_FORMAT_RGB888, 0
-    );
-    lv_draw_buf_t *dbuf2 = lv_draw_buf_create(
-        s_hal.hor_res, line_cnt, LV_COLOR_FORMAT_RGB888, 0
-    );
+    lv_draw_buf_t *dbuf1 = lv_draw_buf_create(s_hal.hor_res, line_cnt, cf, 0);
+    lv_draw_buf_t *dbuf2 = lv_draw_buf_create(s_hal.hor_res, line_cnt, cf, 0);
     lv_display_set_draw_buffers(disp, dbuf1, dbuf2);
+#if CONFIG_JOFTMODE_GUI_SNAPSHOT_ANIM
+    s_snap.disp = disp;
+    s_snap.cf = cf;
+    s_snap.band[0] = dbuf1->data;
+    s_snap.band[1] = dbuf2->data;
+    s_snap.band_rows = (int)line_cnt;
+    ui_screens_set_load_hook(snap_load_hook);
+#endif
 
-    // 5) 刷新回调，设flush 回调 flush_cb()
+    // 5) 刷新回调，设flush 回调 flush_cb()；传输完成中断只放计数，flush_wait_cb 挂起等完再交还缓冲
     lv_display_set_flush_cb(disp, flush_cb);
+    lv_display_set_flush_wait_cb(disp, flush_wait_cb);
+    display_hal_set_trans_done_cb(&s_hal, on_trans_done, disp);
+#if CONFIG_JOFTMODE_DISPLAY_STATS
+    lv_display_add_event_cb(disp, refr_event_cb, LV_EVENT_REFR_START, NULL);
+    lv_display_add_event_cb(disp, refr_event_cb, LV_EVENT_REFR_READY, NULL);
+#endif
+#if CONFIG_JOFTMODE_DISPLAY_TE_SCHED
+    // 在统计的 REFR_START 之后注册：对齐 TE 的等待算进本帧
+    lv_display_add_event_cb(disp, te_frame_start, LV_EVENT_REFR_START, NULL);
+    te_hold_init();
+    s_te.since_us = esp_timer_get_time();
+#endif
+    // 在 invalidate_cb、对齐 TE 之后注册：失效像素按裁剪后算，帧时间从对齐之后算
+    gui_prof_init(disp);
 
 // ... 原有�?lv_display_set_flush_cb(disp, flush_cb); 之后 ...
 
@@ -193,7 +1181,19 @@ static void gui_task(void *arg)
     lv_indev_set_type(s_touch_indev, LV_INDEV_TYPE_POINTER);  // 设置类型为指触摸)
     lv_indev_set_read_cb(s_touch_indev, touch_read_cb);       // 设置回调函数
     lv_indev_set_display(s_touch_indev, disp);                // 绑定到当前屏幕
+#if CONFIG_JOFTMODE_GUI_EVENT_LOOP
+    // 有 INT 中断就不再按刷新周期轮询 I2C；没有（触控没找到）就退回轮询
+    if (app_touch_set_irq_handler(touch_irq_cb, NULL) == ESP_OK) {
+        s_touch_irq_mode = true;
+        lv_timer_pause(lv_indev_get_read_timer(s_touch_indev));
+    } else {
+        ESP_LOGW(TAG, "touch INT unavailable, polling touch");
+    }
+#endif
+    lv_display_add_event_cb(disp, first_frame_cb, LV_EVENT_REFR_READY, NULL);
+    int64_t t_ui = esp_timer_get_time();
     ui_init();
+    s_ui_init_ms = (uint32_t)((esp_timer_get_time() - t_ui) / 1000);
 
     // ... 原有�?lv_obj_set_style_bg_color ...
 
@@ -249,13 +1249,67 @@ static void gui_task(void *arg)
 #endif
 
 
-    ESP_LOGW(TAG, "LVGL fmt=RGB888; ensure panel is 3B/px (18/24bpp) to avoid slant.");
+    ESP_LOGI(TAG, "LVGL fmt=%s, %u KB per full frame, %s, %d draw unit(s), gui on core %d",
+             (cf == LV_COLOR_FORMAT_RGB565) ? "RGB565" : "RGB888",
+             (unsigned)((uint32_t)s_hal.hor_res * s_hal.ver_res * s_hal.bits_per_pixel / 8 / 1024),
+             (LV_USE_OS == LV_OS_FREERTOS) ? "LV_OS_FREERTOS" : "no LV_OS (draw units inline)",
+             LV_DRAW_SW_DRAW_UNIT_CNT, (int)xPortGetCoreID());
+#if CONFIG_JOFTMODE_DISPLAY_ROUND_CLIP
+    log_round_clip_saving();
+#endif
+#if CONFIG_JOFTMODE_DISPLAY_STATS
+    s_disp_stats.since_us = esp_timer_get_time();
+    s_gui_stats.since_us = s_disp_stats.since_us;
+#endif
+#if CONFIG_JOFTMODE_GUI_RENDER_BENCH
+    gui_bench_run(disp);
+#endif
 
+    bool screen_on = true;
     while (1) {
-        lv_timer_handler();
+        if (s_screen_on != screen_on) {
+            screen_on = s_screen_on;
+            gui_apply_screen(screen_on);
+        }
+        if (!screen_on) {
+            (void)xSemaphoreTake(s_gui_wake, portMAX_DELAY);
+            continue;
+        }
+#if CONFIG_JOFTMODE_GUI_EVENT_LOOP
+        touch_irq_resume_read();
+#endif
 
+#if CONFIG_JOFTMODE_DISPLAY_STATS
+        int64_t t0 = esp_timer_get_time();
+#endif
+        int64_t t_prof = gui_prof_now();
+        uint32_t next_ms = lv_timer_handler();
+        int64_t t_prof_end = gui_prof_now();
+        gui_prof_add(GUI_PROF_LOOP_US, (uint32_t)(t_prof_end - t_prof));
+        gui_prof_poll(t_prof_end);
+#if CONFIG_JOFTMODE_DISPLAY_STATS
+        int64_t t1 = esp_timer_get_time();
+        s_gui_stats.wakeups++;
+        s_gui_stats.busy_us += t1 - t0;
+        gui_stats_log(t1);
+#endif
+#if CONFIG_JOFTMODE_GUI_SNAPSHOT_ANIM
+        if (s_snap.scr) {
+            snap_anim_run();
+            next_ms = 0;        // 动画期间 LVGL 的定时器都到期了，马上再跑一轮
+        }
+#endif
 
+#if CONFIG_JOFTMODE_GUI_EVENT_LOOP
+        // 睡到下一个 LVGL 定时器到期（没有就是 LV_NO_TIMER_READY），触控中断和开关屏请求会提前叫醒
+        if (next_ms > GUI_MAX_SLEEP_MS) next_ms = GUI_MAX_SLEEP_MS;
+        TickType_t ticks = pdMS_TO_TICKS(next_ms);
+        if (ticks == 0) ticks = 1;
+        (void)xSemaphoreTake(s_gui_wake, ticks);
+#else
+        LV_UNUSED(next_ms);
         vTaskDelay(pdMS_TO_TICKS(10));
+#endif
     }
 }
 
@@ -266,24 +1320,25 @@ esp_err_t app_gui_start(void)
     if (started) return ESP_OK;
     started = true;
 
-    BaseType_t ok = xTaskCreate(gui_task, "gui", 8192, NULL, 5, NULL);
+    s_gui_wake = xSemaphoreCreateBinaryStatic(&s_gui_wake_buffer);
+    BaseType_t ok = xTaskCreatePinnedToCore(gui_task, "gui", 8192, NULL, 5, NULL, GUI_TASK_CORE);
     return ok == pdPASS ? ESP_OK : ESP_FAIL;
 }
 
-//控制/查询屏幕开关状
+//控制/查询屏幕开关状态：只记下请求，由 GUI 任务在两次渲染之间真正开关屏
 void app_gui_screen_on(void)
 {
     s_screen_on = true;
-    if (s_panel_handle) {
-        esp_lcd_panel_disp_on_off(s_panel_handle, true);
+    if (s_gui_wake) {
+        xSemaphoreGive(s_gui_wake);
     }
 }
 
 void app_gui_screen_off(void)
 {
     s_screen_on = false;
-    if (s_panel_handle) {
-        esp_lcd_panel_disp_on_off(s_panel_handle, false);
+    if (s_gui_wake) {
+        xSemaphoreGive(s_gui_wake);
     }
 }
 
@@ -291,3 +1346,13 @@ bool app_gui_screen_is_on(void)
 {
     return s_screen_on;
 }
+
+void app_gui_prof_overlay_toggle(void)
+{
+#if CONFIG_JOFTMODE_GUI_PROF
+    gui_prof_overlay_toggle();
+    if (s_gui_wake) {
+        xSemaphoreGive(s_gui_wake);
+    }
+#endif
+}
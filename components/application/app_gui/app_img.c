@@ -0,0 +1,355 @@
+// app_img.c —— 压缩图片的 LVGL 解码器 + PSRAM 解码缓存
+// 图片在 flash 里是 tools/img_pack.py 打的包（RLE 或 LZ4），第一次画时解开放进缓存，
+// 之后再画直接用缓存里的像素。缓存按总字节数限额（JOFTMODE_IMG_CACHE_KB），满了先丢最久没用、
+// 当前没人在画的；实在放不下的就解到临时缓冲，画完即丢。
+// 两个绘制单元会在各自的绘制任务里同时开图片，缓存操作都在锁里。
+#include "app_img.h"
+#include "log_lz4.h"         // LZ4 块格式跟日志压缩是同一套（app_sdcard/include）
+
+#include <string.h>
+
+#include "lvgl.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "sdkconfig.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+static const char *TAG = "app_img";
+
+#define IMG_MAGIC            "JIMG"
+#define IMG_VERSION          1
+#define IMG_METHOD_RLE       1
+#define IMG_METHOD_LZ4       2
+#define IMG_HDR_SIZE         20
+#define IMG_MAX_ENTRIES      16
+#define IMG_CACHE_BUDGET     ((uint32_t)CONFIG_JOFTMODE_IMG_CACHE_KB * 1024u)
+
+typedef struct {
+    const lv_image_dsc_t *src;          // NULL = 空槽
+    uint8_t      *data;
+    uint32_t      size;
+    uint32_t      last_use;
+    uint16_t      refs;
+    bool          cached;               // false：临时解码，最后一个 close 时释放
+    lv_draw_buf_t buf;
+} img_entry_t;
+
+static img_entry_t s_entries[IMG_MAX_ENTRIES];
+static SemaphoreHandle_t s_lock = NULL;
+static uint32_t s_use_clock = 0;
+static app_img_stats_t s_stats;
+
+static uint32_t rd32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t rd16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static bool is_packed(const lv_image_dsc_t *img)
+{
+    return (img->header.flags & LV_IMAGE_FLAGS_USER1) && img->data_size >= IMG_HDR_SIZE &&
+           memcmp(img->data, IMG_MAGIC, 4) == 0 && img->data[4] == IMG_VERSION;
+}
+
+static uint32_t raw_size(const lv_image_dsc_t *img)
+{
+    return rd32(img->data + 8);
+}
+
+static bool decode_rle(const uint8_t *src, const uint8_t *end, uint8_t *dst, uint32_t raw, uint8_t unit)
+{
+    uint32_t out = 0;
+    while (src < end) {
+        uint8_t c = *src++;
+        uint32_t cnt = (uint32_t)(c & 0x7F) + 1;
+        if (c & 0x80) {
+            if (src + unit > end || out + cnt * unit > raw) {
+                return false;
+            }
+            for (uint32_t i = 0; i < cnt; ++i, out += unit) {
+                memcpy(dst + out, src, unit);
+            }
+            src += unit;
+        } else {
+            uint32_t n = cnt * unit;
+            if (src + n > end || out + n > raw) {
+                return false;
+            }
+            memcpy(dst + out, src, n);
+            src += n;
+            out += n;
+        }
+    }
+    return out == raw;
+}
+
+static bool decode_lz4(const uint8_t *blob, const uint8_t *end, uint8_t *dst, uint32_t raw)
+{
+    uint32_t block = rd32(blob + 12);
+    uint16_t nblocks = rd16(blob + 16);
+    const uint8_t *sizes = blob + IMG_HDR_SIZE;
+    const uint8_t *src = sizes + 4u * nblocks;
+    uint32_t out = 0;
+    if (block == 0 || src > end) {
+        return false;
+    }
+    for (uint16_t k = 0; k < nblocks; ++k) {
+        uint32_t len = rd32(sizes + 4u * k);
+        uint32_t want = (raw - out < block) ? raw - out : block;
+        if (src + len > end ||
+            log_lz4_decompress(src, len, dst + out, want) != (int)want) {
+            return false;
+        }
+        src += len;
+        out += want;
+    }
+    return out == raw;
+}
+
+static bool decode(const lv_image_dsc_t *img, uint8_t *dst)
+{
+    const uint8_t *blob = img->data;
+    const uint8_t *end = blob + img->data_size;
+    uint32_t raw = raw_size(img);
+    switch (blob[5]) {
+    case IMG_METHOD_RLE:
+        return blob[6] > 0 && decode_rle(blob + IMG_HDR_SIZE, end, dst, raw, blob[6]);
+    case IMG_METHOD_LZ4:
+        return decode_lz4(blob, end, dst, raw);
+    default:
+        return false;
+    }
+}
+
+static void entry_free(img_entry_t *e)
+{
+    if (e->cached) {
+        s_stats.cached_bytes -= e->size;
+    }
+    heap_caps_free(e->data);
+    memset(e, 0, sizeof(*e));
+}
+
+// 丢最久没用、没人在画的缓存项，直到再放 need 字节不超限额
+static bool make_room(uint32_t need)
+{
+    if (need > IMG_CACHE_BUDGET) {
+        return false;
+    }
+    while (s_stats.cached_bytes + need > IMG_CACHE_BUDGET) {
+        img_entry_t *victim = NULL;
+        for (int i = 0; i < IMG_MAX_ENTRIES; ++i) {
+            img_entry_t *e = &s_entries[i];
+            if (e->src && e->cached && e->refs == 0 &&
+                (!victim || (int32_t)(e->last_use - victim->last_use) < 0)) {
+                victim = e;
+            }
+        }
+        if (!victim) {
+            return false;
+        }
+        entry_free(victim);
+        s_stats.evictions++;
+    }
+    return true;
+}
+
+static img_entry_t *entry_find(const lv_image_dsc_t *img)
+{
+    for (int i = 0; i < IMG_MAX_ENTRIES; ++i) {
+        if (s_entries[i].src == img && s_entries[i].cached) {
+            return &s_entries[i];
+        }
+    }
+    return NULL;
+}
+
+static img_entry_t *entry_alloc(void)
+{
+    for (int i = 0; i < IMG_MAX_ENTRIES; ++i) {
+        if (!s_entries[i].src) {
+            return &s_entries[i];
+        }
+    }
+    // 槽用完了：丢一个最久没用的缓存项腾槽
+    img_entry_t *victim = NULL;
+    for (int i = 0; i < IMG_MAX_ENTRIES; ++i) {
+        img_entry_t *e = &s_entries[i];
+        if (e->cached && e->refs == 0 && (!victim || (int32_t)(e->last_use - victim->last_use) < 0)) {
+            victim = e;
+        }
+    }
+    if (victim) {
+        entry_free(victim);
+        s_stats.evictions++;
+    }
+    return victim;
+}
+
+static img_entry_t *cache_get(const lv_image_dsc_t *img, const lv_image_header_t *header)
+{
+    img_entry_t *e = entry_find(img);
+    if (e) {
+        e->refs++;
+        e->last_use = ++s_use_clock;
+        s_stats.hits++;
+        return e;
+    }
+
+    uint32_t size = raw_size(img);
+    bool cached = make_room(size);
+    e = entry_alloc();
+    if (!e) {
+        ESP_LOGW(TAG, "no free slot for %ux%u image", (unsigned)header->w, (unsigned)header->h);
+        return NULL;
+    }
+    uint8_t *data = heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!data) {
+        data = heap_caps_malloc(size, MALLOC_CAP_8BIT);
+    }
+    if (!data) {
+        ESP_LOGW(TAG, "no memory to decode %u byte image", (unsigned)size);
+        return NULL;
+    }
+
+    int64_t t0 = esp_timer_get_time();
+    if (!decode(img, data)) {
+        ESP_LOGE(TAG, "corrupt packed image %p", (const void *)img);
+        heap_caps_free(data);
+        return NULL;
+    }
+    uint32_t dt = (uint32_t)(esp_timer_get_time() - t0);
+    s_stats.misses++;
+    s_stats.decode_us += dt;
+    if (dt > s_stats.decode_max_us) {
+        s_stats.decode_max_us = dt;
+    }
+
+    e->src = img;
+    e->data = data;
+    e->size = size;
+    e->refs = 1;
+    e->cached = cached;
+    e->last_use = ++s_use_clock;
+    lv_draw_buf_init(&e->buf, header->w, header->h, header->cf, header->stride, data, size);
+    if (cached) {
+        s_stats.cached_bytes += size;
+    } else {
+        s_stats.uncached++;
+    }
+    return e;
+}
+
+static void cache_put(img_entry_t *e)
+{
+    if (e->refs > 0 && --e->refs == 0 && !e->cached) {
+        entry_free(e);
+    }
+}
+
+static lv_result_t img_info_cb(lv_image_decoder_t *decoder, lv_image_decoder_dsc_t *dsc,
+                               lv_image_header_t *header)
+{
+    LV_UNUSED(decoder);
+    if (dsc->src_type != LV_IMAGE_SRC_VARIABLE) {
+        return LV_RESULT_INVALID;
+    }
+    const lv_image_dsc_t *img = (const lv_image_dsc_t *)dsc->src;
+    if (!is_packed(img)) {
+        return LV_RESULT_INVALID;
+    }
+    *header = img->header;
+    header->flags &= ~LV_IMAGE_FLAGS_USER1;
+    if (header->stride == 0) {
+        header->stride = raw_size(img) / img->header.h;     // 打包前的像素是逐行紧排的
+    }
+    return LV_RESULT_OK;
+}
+
+static lv_result_t img_open_cb(lv_image_decoder_t *decoder, lv_image_decoder_dsc_t *dsc)
+{
+    LV_UNUSED(decoder);
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    img_entry_t *e = cache_get((const lv_image_dsc_t *)dsc->src, &dsc->header);
+    xSemaphoreGive(s_lock);
+    if (!e) {
+        return LV_RESULT_INVALID;
+    }
+    dsc->decoded = &e->buf;
+    dsc->user_data = e;
+    return LV_RESULT_OK;
+}
+
+static void img_close_cb(lv_image_decoder_t *decoder, lv_image_decoder_dsc_t *dsc)
+{
+    LV_UNUSED(decoder);
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    cache_put((img_entry_t *)dsc->user_data);
+    xSemaphoreGive(s_lock);
+    dsc->decoded = NULL;
+    dsc->user_data = NULL;
+}
+
+void app_img_init(void)
+{
+    if (s_lock) {
+        return;
+    }
+    s_lock = xSemaphoreCreateMutex();
+    lv_image_decoder_t *dec = lv_image_decoder_create();
+    lv_image_decoder_set_info_cb(dec, img_info_cb);
+    lv_image_decoder_set_open_cb(dec, img_open_cb);
+    lv_image_decoder_set_close_cb(dec, img_close_cb);
+    ESP_LOGI(TAG, "packed image decoder, cache %u KB", (unsigned)CONFIG_JOFTMODE_IMG_CACHE_KB);
+}
+
+void app_img_cache_flush(void)
+{
+    if (!s_lock) {
+        return;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    for (int i = 0; i < IMG_MAX_ENTRIES; ++i) {
+        if (s_entries[i].src && s_entries[i].cached && s_entries[i].refs == 0) {
+            entry_free(&s_entries[i]);
+        }
+    }
+    xSemaphoreGive(s_lock);
+}
+
+void app_img_get_stats(app_img_stats_t *out, bool reset)
+{
+    if (!s_lock) {
+        memset(out, 0, sizeof(*out));
+        return;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    *out = s_stats;
+    if (reset) {
+        uint32_t cached = s_stats.cached_bytes;
+        memset(&s_stats, 0, sizeof(s_stats));
+        s_stats.cached_bytes = cached;
+    }
+    xSemaphoreGive(s_lock);
+}
+
+void app_img_log_stats(void)
+{
+    app_img_stats_t st;
+    app_img_get_stats(&st, true);
+    if (st.hits == 0 && st.misses == 0) {
+        return;
+    }
+    ESP_LOGI(TAG, "img: %u hits, %u decodes (%u uncached, avg %u us, max %u us), %u evictions, cache %u/%u KB",
+             (unsigned)st.hits, (unsigned)st.misses, (unsigned)st.uncached,
+             (unsigned)(st.misses ? st.decode_us / st.misses : 0), (unsigned)st.decode_max_us,
+             (unsigned)st.evictions, (unsigned)(st.cached_bytes / 1024),
+             (unsigned)CONFIG_JOFTMODE_IMG_CACHE_KB);
+}
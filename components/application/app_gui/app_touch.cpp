@@ -3,6 +3,8 @@
 #include "SensorLib.h"
 #include "touch/TouchClassCST816.h"
 #include "driver/i2c.h"
+#include "driver/gpio.h"
+#include "esp_attr.h"
 #include "esp_log.h"
 
 static const char *TAG = "AppTouch";
@@ -17,6 +19,10 @@ static const char *TAG = "AppTouch";
 TouchClassCST816 touch;   //触控芯片对象（来自 SensorLib，具体芯片兼容 CST8xx 系列）。
 int16_t touch_x[5], touch_y[5];
 
+static bool s_touch_ready = false;
+static app_touch_irq_cb_t s_irq_cb = NULL;
+static void *s_irq_ctx = NULL;
+
 
 // C entry: touch init
 void app_touch_init(void) {
@@ -35,9 +41,58 @@ void app_touch_init(void) {
     touch.setMaxCoordinates(466, 466);
     touch.setMirrorXY(false, false);
 
+    s_touch_ready = true;
     ESP_LOGI(TAG, "Touch initialized successfully");
 }
 
+// INT 脚：有触点时芯片拉低（按住期间按报点周期拉低），空闲时芯片自己睡眠
+static void IRAM_ATTR touch_int_isr(void *arg)
+{
+    (void)arg;
+    if (s_irq_cb) {
+        s_irq_cb(s_irq_ctx);
+    }
+}
+
+esp_err_t app_touch_set_irq_handler(app_touch_irq_cb_t cb, void *ctx)
+{
+    if (!s_touch_ready) {
+        return ESP_FAIL;
+    }
+    s_irq_cb = cb;
+    s_irq_ctx = ctx;
+
+    gpio_config_t io_conf = {};
+    io_conf.pin_bit_mask = 1ULL << TOUCH_INT;
+    io_conf.mode = GPIO_MODE_INPUT;
+    io_conf.pull_up_en = GPIO_PULLUP_ENABLE;
+    io_conf.pull_down_en = GPIO_PULLDOWN_DISABLE;
+    io_conf.intr_type = GPIO_INTR_NEGEDGE;
+    esp_err_t err = gpio_config(&io_conf);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    // ISR 服务可能已经被别的驱动（TE 脚）装过
+    err = gpio_install_isr_service(0);
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {
+        return err;
+    }
+    return gpio_isr_handler_add((gpio_num_t)TOUCH_INT, touch_int_isr, NULL);
+}
+
+void app_touch_irq_enable(bool enable)
+{
+    if (!s_irq_cb) {
+        return;
+    }
+    if (enable) {
+        gpio_intr_enable((gpio_num_t)TOUCH_INT);
+    } else {
+        gpio_intr_disable((gpio_num_t)TOUCH_INT);
+    }
+}
+
 // C entry: read touch point 读取 1 个触点坐标（调用 touch.getPoint()）。
 bool app_touch_read(int32_t *x, int32_t *y) {
     uint8_t touched = touch.getPoint(touch_x, touch_y, 1);
@@ -0,0 +1,287 @@
+// gui_prof.c —— GUI 帧时间 / 刷屏剖析，见 gui_prof.h
+// 每项两份累计：dump 份（min/avg/max + 直方图）每 JOFTMODE_GUI_PROF_DUMP_S 秒打印一次后清零，
+// live 份给叠加层，每秒刷新一次后清零。全在 GUI 任务里跑，不加锁
+#include "gui_prof.h"
+
+#if CONFIG_JOFTMODE_GUI_PROF
+
+#include <stdio.h>
+#include <string.h>
+
+#include "esp_log.h"
+#if CONFIG_JOFTMODE_GUI_PROF_SD
+#include "app_sdcard.h"
+#endif
+
+static const char *TAG = "gui_prof";
+
+#define PROF_HIST_BINS      20      // bin k 是 [2^(k-1), 2^k)，bin 0 是 0，最后一个 bin 收下更大的
+#define PROF_DUMP_US        ((int64_t)CONFIG_JOFTMODE_GUI_PROF_DUMP_S * 1000000)
+#define PROF_OVERLAY_MS     1000
+#define PROF_SD_FILE        "gui_prof.txt"
+
+typedef struct {
+    uint32_t n;
+    uint32_t min;
+    uint32_t max;
+    uint64_t sum;
+} prof_acc_t;
+
+typedef struct {
+    prof_acc_t dump;
+    prof_acc_t live;
+    uint32_t   hist[PROF_HIST_BINS];
+} prof_metric_t;
+
+static const char *const k_names[GUI_PROF_COUNT] = {
+    [GUI_PROF_FRAME_US]    = "frame_us",
+    [GUI_PROF_RENDER_US]   = "render_us",
+    [GUI_PROF_FLUSH_BYTES] = "flush_bytes",
+    [GUI_PROF_DMA_WAIT_US] = "dma_wait_us",
+    [GUI_PROF_TE_WAIT_US]  = "te_wait_us",
+    [GUI_PROF_INV_PX]      = "inv_px",
+    [GUI_PROF_LOOP_US]     = "loop_us",
+};
+
+static prof_metric_t s_metrics[GUI_PROF_COUNT];
+static int64_t  s_dump_since_us;
+static int64_t  s_live_since_us;
+
+// 当前帧 / 当前区域
+static int64_t  s_frame_start_us;
+static int64_t  s_mark_us;          // 上一块发完（或帧开始）的时刻
+static uint32_t s_wait_us;          // 那之后等 DMA / TE 的时间
+static uint32_t s_inv_px;
+
+// 叠加层
+static lv_obj_t   *s_label;
+static lv_timer_t *s_overlay_timer;
+static volatile bool s_overlay_req;
+static char s_dump_buf[1536];
+
+static void acc_add(prof_acc_t *a, uint32_t v)
+{
+    if (a->n == 0 || v < a->min) a->min = v;
+    if (v > a->max) a->max = v;
+    a->n++;
+    a->sum += v;
+}
+
+void gui_prof_add(gui_prof_metric_t m, uint32_t v)
+{
+    prof_metric_t *p = &s_metrics[m];
+    acc_add(&p->dump, v);
+    acc_add(&p->live, v);
+    int bin = v ? 32 - __builtin_clz(v) : 0;
+    p->hist[bin < PROF_HIST_BINS ? bin : PROF_HIST_BINS - 1]++;
+}
+
+static uint32_t acc_avg(const prof_acc_t *a)
+{
+    return a->n ? (uint32_t)(a->sum / a->n) : 0;
+}
+
+void gui_prof_flush_begin(void)
+{
+    int64_t now = esp_timer_get_time();
+    int64_t render = now - s_mark_us - s_wait_us;
+    gui_prof_add(GUI_PROF_RENDER_US, render > 0 ? (uint32_t)render : 0);
+}
+
+void gui_prof_flush_end(uint32_t bytes)
+{
+    gui_prof_add(GUI_PROF_FLUSH_BYTES, bytes);
+    s_mark_us = esp_timer_get_time();
+    s_wait_us = 0;
+}
+
+void gui_prof_dma_wait(uint32_t us)
+{
+    gui_prof_add(GUI_PROF_DMA_WAIT_US, us);
+    s_wait_us += us;
+}
+
+void gui_prof_te_wait(uint32_t us)
+{
+    gui_prof_add(GUI_PROF_TE_WAIT_US, us);
+    s_wait_us += us;
+}
+
+static void refr_cb(lv_event_t *e)
+{
+    int64_t now = esp_timer_get_time();
+    if (lv_event_get_code(e) == LV_EVENT_REFR_START) {
+        s_frame_start_us = now;
+        s_mark_us = now;
+        s_wait_us = 0;
+    } else {
+        gui_prof_add(GUI_PROF_FRAME_US, (uint32_t)(now - s_frame_start_us));
+        gui_prof_add(GUI_PROF_INV_PX, s_inv_px);
+        s_inv_px = 0;
+    }
+}
+
+static void invalidate_cb(lv_event_t *e)
+{
+    s_inv_px += lv_area_get_size(lv_event_get_invalidated_area(e));
+}
+
+// 直方图 bin 的下界，按 K / M 缩写
+static int bin_label(char *out, size_t cap, int bin)
+{
+    uint32_t lo = bin ? 1u << (bin - 1) : 0;
+    if (lo >= 1024 * 1024) return snprintf(out, cap, "%uM", (unsigned)(lo >> 20));
+    if (lo >= 1024) return snprintf(out, cap, "%uK", (unsigned)(lo >> 10));
+    return snprintf(out, cap, "%u", (unsigned)lo);
+}
+
+static void dump(int64_t now)
+{
+    int64_t span = now - s_dump_since_us;
+    uint32_t frames = s_metrics[GUI_PROF_FRAME_US].dump.n;
+    int len = snprintf(s_dump_buf, sizeof(s_dump_buf), "t=%u s, %u.%u s: %u.%u fps\n",
+                       (unsigned)(now / 1000000), (unsigned)(span / 1000000), (unsigned)(span / 100000 % 10),
+                       (unsigned)(frames * 1000000ULL / span), (unsigned)(frames * 10000000ULL / span % 10));
+
+    for (int m = 0; m < GUI_PROF_COUNT; ++m) {
+        prof_metric_t *p = &s_metrics[m];
+        if (len >= (int)sizeof(s_dump_buf)) {
+            break;
+        }
+        len += snprintf(s_dump_buf + len, sizeof(s_dump_buf) - len, "  %-12s n %u min %u avg %u max %u |",
+                        k_names[m], (unsigned)p->dump.n, (unsigned)p->dump.min,
+                        (unsigned)acc_avg(&p->dump), (unsigned)p->dump.max);
+        for (int b = 0; b < PROF_HIST_BINS && len < (int)sizeof(s_dump_buf); ++b) {
+            if (p->hist[b] == 0) {
+                continue;
+            }
+            char lo[8];
+            bin_label(lo, sizeof(lo), b);
+            len += snprintf(s_dump_buf + len, sizeof(s_dump_buf) - len, " %s%s:%u",
+                            (b == PROF_HIST_BINS - 1) ? ">=" : "", lo, (unsigned)p->hist[b]);
+        }
+        if (len < (int)sizeof(s_dump_buf)) {
+            len += snprintf(s_dump_buf + len, sizeof(s_dump_buf) - len, "\n");
+        }
+        memset(&p->dump, 0, sizeof(p->dump));
+        memset(p->hist, 0, sizeof(p->hist));
+    }
+    if (len >= (int)sizeof(s_dump_buf)) {
+        len = sizeof(s_dump_buf) - 1;
+    }
+
+    // 日志按行打，免得一条太长被截断
+    for (char *line = s_dump_buf, *nl; *line; line = nl + 1) {
+        nl = strchr(line, '\n');
+        if (!nl) {
+            ESP_LOGI(TAG, "%s", line);
+            break;
+        }
+        *nl = '\0';
+        ESP_LOGI(TAG, "%s", line);
+        *nl = '\n';
+    }
+#if CONFIG_JOFTMODE_GUI_PROF_SD
+    // 写卡会让 GUI 任务停几到几十毫秒，所以只在整段统计结束时写
+    esp_err_t err = app_sdcard_append_text(PROF_SD_FILE, s_dump_buf, (size_t)len);
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {
+        ESP_LOGW(TAG, "append " PROF_SD_FILE " failed: %s", esp_err_to_name(err));
+    }
+#endif
+    s_dump_since_us = now;
+}
+
+static void overlay_timer_cb(lv_timer_t *t)
+{
+    LV_UNUSED(t);
+    int64_t now = esp_timer_get_time();
+    int64_t span = now - s_live_since_us;
+    const prof_acc_t *frame = &s_metrics[GUI_PROF_FRAME_US].live;
+    const prof_acc_t *render = &s_metrics[GUI_PROF_RENDER_US].live;
+    const prof_acc_t *bytes = &s_metrics[GUI_PROF_FLUSH_BYTES].live;
+    // 每帧的等待和字节：各次之和除以帧数
+    uint32_t nf = frame->n ? frame->n : 1;
+    lv_label_set_text_fmt(s_label,
+                          "%u fps  frame %u/%u ms\n"
+                          "render %u us/area\n"
+                          "dma %u  te %u us/frame\n"
+                          "%u KB/frame  inv %u Kpx",
+                          (unsigned)(span > 0 ? frame->n * 1000000ULL / span : 0),
+                          (unsigned)(acc_avg(frame) / 1000), (unsigned)(frame->max / 1000),
+                          (unsigned)acc_avg(render),
+                          (unsigned)(s_metrics[GUI_PROF_DMA_WAIT_US].live.sum / nf),
+                          (unsigned)(s_metrics[GUI_PROF_TE_WAIT_US].live.sum / nf),
+                          (unsigned)(bytes->sum / nf / 1024),
+                          (unsigned)(s_metrics[GUI_PROF_INV_PX].live.sum / nf / 1000));
+    for (int m = 0; m < GUI_PROF_COUNT; ++m) {
+        memset(&s_metrics[m].live, 0, sizeof(s_metrics[m].live));
+    }
+    s_live_since_us = now;
+}
+
+// 叠加层放在 top 层，切屏也一直在；它自己每秒刷一次文字，也算进统计里（一小块区域）
+static void overlay_set(bool on)
+{
+    if (on && !s_label) {
+        s_label = lv_label_create(lv_layer_top());
+        lv_obj_set_style_bg_color(s_label, lv_color_black(), 0);
+        lv_obj_set_style_bg_opa(s_label, LV_OPA_70, 0);
+        lv_obj_set_style_text_color(s_label, lv_color_white(), 0);
+        lv_obj_set_style_pad_all(s_label, 4, 0);
+        lv_obj_set_style_text_align(s_label, LV_TEXT_ALIGN_CENTER, 0);
+        lv_obj_align(s_label, LV_ALIGN_TOP_MID, 0, 48);     // 圆屏顶端太窄，往下挪
+        lv_label_set_text(s_label, "");
+        s_overlay_timer = lv_timer_create(overlay_timer_cb, PROF_OVERLAY_MS, NULL);
+    }
+    if (!s_label) {
+        return;
+    }
+    if (on) {
+        lv_obj_remove_flag(s_label, LV_OBJ_FLAG_HIDDEN);
+        s_live_since_us = esp_timer_get_time();
+        for (int m = 0; m < GUI_PROF_COUNT; ++m) {
+            memset(&s_metrics[m].live, 0, sizeof(s_metrics[m].live));
+        }
+        lv_timer_resume(s_overlay_timer);
+    } else {
+        lv_obj_add_flag(s_label, LV_OBJ_FLAG_HIDDEN);
+        lv_timer_pause(s_overlay_timer);
+    }
+    ESP_LOGI(TAG, "overlay %s", on ? "on" : "off");
+}
+
+void gui_prof_overlay_toggle(void)
+{
+    s_overlay_req = true;
+}
+
+void gui_prof_poll(int64_t now)
+{
+    if (s_overlay_req) {
+        s_overlay_req = false;
+        overlay_set(!s_label || lv_obj_has_flag(s_label, LV_OBJ_FLAG_HIDDEN));
+    }
+    if (now - s_dump_since_us >= PROF_DUMP_US) {
+        dump(now);
+    }
+}
+
+void gui_prof_init(lv_display_t *disp)
+{
+    lv_display_add_event_cb(disp, refr_cb, LV_EVENT_REFR_START, NULL);
+    lv_display_add_event_cb(disp, refr_cb, LV_EVENT_REFR_READY, NULL);
+    lv_display_add_event_cb(disp, invalidate_cb, LV_EVENT_INVALIDATE_AREA, NULL);
+    s_dump_since_us = esp_timer_get_time();
+    s_live_since_us = s_dump_since_us;
+#if CONFIG_JOFTMODE_GUI_PROF_OVERLAY
+    overlay_set(true);
+#endif
+#if CONFIG_JOFTMODE_GUI_PROF_SD
+    ESP_LOGI(TAG, "profiling, dump every %d s to the log and /sdcard/" PROF_SD_FILE,
+             CONFIG_JOFTMODE_GUI_PROF_DUMP_S);
+#else
+    ESP_LOGI(TAG, "profiling, dump every %d s to the log", CONFIG_JOFTMODE_GUI_PROF_DUMP_S);
+#endif
+}
+
+#endif
@@ -0,0 +1,61 @@
+// gui_prof.h —— GUI 帧时间 / 刷屏剖析（JOFTMODE_GUI_PROF）
+// 各项按 min/avg/max 和对数直方图累计，定期打印（可同时追加到 SD 卡），也可在屏幕上叠加实时数字。
+// 只在 GUI 任务里调用（gui_prof_overlay_toggle 除外）。关掉时全是空的内联函数，调用处不用加 #if
+#pragma once
+
+#include <stdint.h>
+
+#include "lvgl.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+
+typedef enum {
+    GUI_PROF_FRAME_US = 0,      // 一帧：REFR_START（已对齐 TE）到 REFR_READY
+    GUI_PROF_RENDER_US,         // 每块区域的渲染：上一块发出后到这块进 flush_cb，扣掉等 DMA / TE
+    GUI_PROF_FLUSH_BYTES,       // 每块区域实际发出的字节（圆屏裁剪后）
+    GUI_PROF_DMA_WAIT_US,       // flush_wait_cb 里等上一块传完
+    GUI_PROF_TE_WAIT_US,        // 等 TE：帧对齐、按扫描线的保持，或不排程时每块的等待
+    GUI_PROF_INV_PX,            // 每帧失效的像素（圆屏裁剪后、LVGL 合并前）
+    GUI_PROF_LOOP_US,           // gui_task 每轮 lv_timer_handler 的耗时
+    GUI_PROF_COUNT
+} gui_prof_metric_t;
+
+#if CONFIG_JOFTMODE_GUI_PROF
+
+// display 建好、invalidate_cb 和 TE 的回调注册之后调用
+void gui_prof_init(lv_display_t *disp);
+
+void gui_prof_add(gui_prof_metric_t m, uint32_t v);
+
+// flush_cb 入口 / 发起传输后调用，bytes 是这块实际发出的字节
+void gui_prof_flush_begin(void);
+void gui_prof_flush_end(uint32_t bytes);
+
+// 等待时间：除了计入各自的项，还从这块区域的渲染时间里扣掉
+void gui_prof_dma_wait(uint32_t us);
+void gui_prof_te_wait(uint32_t us);
+
+// gui_task 每轮调用：到点打印 / 写 SD，处理叠加层开关
+void gui_prof_poll(int64_t now);
+
+// 任意任务可调：下次 gui_prof_poll 时切换叠加层（调用方负责叫醒 GUI 任务）
+void gui_prof_overlay_toggle(void);
+
+static inline int64_t gui_prof_now(void)
+{
+    return esp_timer_get_time();
+}
+
+#else
+
+static inline void gui_prof_init(lv_display_t *disp) { (void)disp; }
+static inline void gui_prof_add(gui_prof_metric_t m, uint32_t v) { (void)m; (void)v; }
+static inline void gui_prof_flush_begin(void) {}
+static inline void gui_prof_flush_end(uint32_t bytes) { (void)bytes; }
+static inline void gui_prof_dma_wait(uint32_t us) { (void)us; }
+static inline void gui_prof_te_wait(uint32_t us) { (void)us; }
+static inline void gui_prof_poll(int64_t now) { (void)now; }
+static inline void gui_prof_overlay_toggle(void) {}
+static inline int64_t gui_prof_now(void) { return 0; }
+
+#endif
@@ -8,3 +8,6 @@ esp_err_t app_gui_start(void);
 void app_gui_screen_on(void);
 void app_gui_screen_off(void);
 bool app_gui_screen_is_on(void);
+
+// 开关 GUI 剖析叠加层（JOFTMODE_GUI_PROF 关闭时为空操作）
+void app_gui_prof_overlay_toggle(void);
@@ -0,0 +1,35 @@
+#pragma once
+// 压缩图片解码：tools/img_pack.py 打包的图片（header.flags 带 LV_IMAGE_FLAGS_USER1）
+// 由这里的 LVGL 解码器解开，解出来的像素放 PSRAM 缓存，按总大小限额、最久没用的先丢
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    uint32_t hits;
+    uint32_t misses;          // 要解码的次数（含放不进缓存的）
+    uint32_t uncached;        // 放不进缓存、用完就丢的解码
+    uint32_t evictions;
+    uint32_t decode_us;       // 解码总耗时
+    uint32_t decode_max_us;
+    uint32_t cached_bytes;    // 当前缓存占用
+} app_img_stats_t;
+
+// lv_init() 之后调用：注册解码器（排在内置解码器前面）
+void app_img_init(void);
+
+// 丢掉所有没在用的解码结果（跑分测无缓存重画时用）
+void app_img_cache_flush(void);
+
+// 取统计；reset 为 true 时清零计数（缓存占用不清）
+void app_img_get_stats(app_img_stats_t *out, bool reset);
+
+// 打一行统计并清零计数
+void app_img_log_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -4,6 +4,8 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+#include "esp_err.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -11,6 +13,15 @@ extern "C" {
 // 初始化触控
 void app_touch_init(void);
 
+// 触控中断回调，在 ISR 里执行：只能做通知任务这类事
+typedef void (*app_touch_irq_cb_t)(void *ctx);
+
+// 把 INT 脚配成下降沿中断，按下/移动时调用 cb。触控芯片没找到时返回 ESP_FAIL
+esp_err_t app_touch_set_irq_handler(app_touch_irq_cb_t cb, void *ctx);
+
+// 熄屏时关掉中断，亮屏再打开
+void app_touch_irq_enable(bool enable);
+
 // 读取触控坐标，返回 true 表示有按下
 bool app_touch_read(int32_t *x, int32_t *y);
 
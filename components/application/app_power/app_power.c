@@ -11,6 +11,8 @@
 #define KEY_GPIO            ((gpio_num_t)CONFIG_JOFTMODE_POWER_KEY_GPIO)
 #define SCAN_INTERVAL_MS    20
 #define LONG_PRESS_MS       2000
+#define SHORT_PRESS_MIN_MS  40
+#define SHORT_PRESS_MAX_MS  500
 
 static TaskHandle_t s_power_task = NULL;
 static bool s_power_on = true;  // ��ʼΪ����״̬
@@ -52,6 +54,11 @@ static void key_task(void *arg)
             }
         } else {
             // �ɿ���λ�����봥�����
+            // 短按（不到 0.5 s）：开关 GUI 剖析叠加层（没开 JOFTMODE_GUI_PROF 时什么都不做）
+            if (pressed_prev && !long_triggered &&
+                pressed_ms >= SHORT_PRESS_MIN_MS && pressed_ms < SHORT_PRESS_MAX_MS) {
+                app_gui_prof_overlay_toggle();
+            }
             pressed_ms = 0;
             long_triggered = false;
         }
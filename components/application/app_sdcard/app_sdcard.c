@@ -1,11 +1,17 @@
 #include <errno.h>
+#include <inttypes.h>
+#include <stdarg.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/unistd.h>
 
+#include "esp_heap_caps.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 #include "freertos/task.h"
 #include "sdkconfig.h"
 
@@ -17,7 +23,12 @@
 
 #include "app_state.h"
 #include "app_sdcard.h"
+#include "log_backlog.h"
+#include "log_flash.h"
+#include "log_index.h"
+#include "log_journal.h"
 #if CONFIG_JOFTMODE_ENABLE_ML
+#include "ml_pkg.h"
 #include "ml_window.h"
 #endif
 
@@ -28,9 +39,29 @@
 #define SDCARD_PIN_SCLK     GPIO_NUM_16
 #define SDCARD_PIN_CS       GPIO_NUM_18
 #define SDCARD_BOOT_KHZ     400
-#define FLUSH_EVERY_LINES   100
-#define FSYNC_EVERY_FLUSH   5
 #define LOGGER_INTERVAL_MS  40
+#define LOGGER_TASK_CORE    ((CONFIG_JOFTMODE_SD_LOGGER_TASK_CORE < 0) ? tskNO_AFFINITY : CONFIG_JOFTMODE_SD_LOGGER_TASK_CORE)
+#define LOG_LINE_MAX        192
+// 每隔固定时间封块 + fflush + fsync：掉电最多丢这段时间的数据，与行数无关
+#define COMMIT_INTERVAL_US  ((int64_t)CONFIG_JOFTMODE_SD_COMMIT_INTERVAL_MS * 1000)
+#define LOG_FILE_EXT        "jlg"
+#define LOG_INDEX_MAX       9999
+// 卡检测：有卡时每秒查一次状态，没卡时每 2 秒尝试重新挂载
+#define CARD_POLL_MS        1000
+#define CARD_RETRY_MS       2000
+#define BACKLOG_BYTES       ((size_t)CONFIG_JOFTMODE_SD_BACKLOG_KB * 1024)
+// 补写 backlog 时每次持锁最多写这么多块，避免长时间卡住 logger
+#define DRAIN_CHUNK_BLOCKS  16
+// flash 段搬到 SD 时每次顺序读写的字节数
+#define MIGRATE_CHUNK       (16 * 1024)
+
+#if CONFIG_JOFTMODE_LOG_BACKEND_SD_ONLY
+#define BACKEND_DEFAULT     APP_SDCARD_BACKEND_SD_ONLY
+#elif CONFIG_JOFTMODE_LOG_BACKEND_FLASH_STAGING
+#define BACKEND_DEFAULT     APP_SDCARD_BACKEND_FLASH_STAGING
+#else
+#define BACKEND_DEFAULT     APP_SDCARD_BACKEND_FLASH_FALLBACK
+#endif
 
 static const char *TAG = "app_sdcard";
 
@@ -42,11 +73,28 @@ static char s_csv_path[64] = {0};
 static char s_csv_buf[4096];
 static bool s_ready = false;
 
+// s_csv、s_card 上的所有 IO 和 backlog 都在这把锁下进行
+static SemaphoreHandle_t s_io_lock = NULL;
+static StaticSemaphore_t s_io_lock_buffer;
+// 正在读日志文件的读者数（s_io_lock 下改）。log_index 的读者在块与块之间放锁，
+// 手里的 FILE 跨锁存活；有读者时 card 任务不卸载，否则 FILE 指向已卸载的 FATFS，fd 还可能被重挂后的新文件复用
+static uint32_t s_readers = 0;
+static uint32_t s_remounts = 0;
+static uint32_t s_write_errors = 0;
+static uint32_t s_records_logged = 0;
+static volatile app_sdcard_backend_t s_backend = BACKEND_DEFAULT;
+static uint8_t *s_migrate_buf = NULL;
+static log_index_acc_t s_index_acc;
+
 static TaskHandle_t s_logger_task = NULL;
+static TaskHandle_t s_card_task = NULL;
 static int64_t s_last_logged_imu_ts = 0;
+static int64_t s_last_commit_us = 0;
 
-static uint32_t s_lines_since_flush = 0;
-static uint32_t s_flush_since_sync = 0;
+static const char *s_csv_header =
+    "date,timestamp,timestamp_ms,latitude,longitude,speed_mps,course_deg,"
+    "acc_x,acc_y,acc_z,gyro_x,gyro_y,gyro_z,"
+    "ml_pred,ml_p_walk,ml_p_ebike,ml_activity\r\n";
 
 #if CONFIG_JOFTMODE_ENABLE_ML
 static ml_result_t s_last_ml;
@@ -77,13 +125,109 @@ static esp_vfs_fat_sdmmc_mount_config_t s_mountcfg = {
     .allocation_unit_size = 0
 };
 
-static inline void csv_sync_now(void)
+static int line_appendf(char *buf, size_t cap, int len, const char *fmt, ...)
+{
+    if (len < 0 || (size_t)len >= cap) {
+        return -1;
+    }
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(buf + len, cap - (size_t)len, fmt, ap);
+    va_end(ap);
+    if (n < 0 || (size_t)(len + n) >= cap) {
+        return -1;
+    }
+    return len + n;
+}
+
+static void close_log_file_locked(void)
+{
+    if (s_csv) {
+        fclose(s_csv);
+        s_csv = NULL;
+    }
+    log_index_file_close();
+}
+
+// 写失败一律按拔卡处理：关掉文件，后续块进 backlog，由 card 任务卸载并重挂（需持 s_io_lock）
+static void card_mark_lost_locked(const char *what)
+{
+    int e = errno;
+    ESP_LOGE(TAG, "%s failed: errno=%d (%s), treat card as removed", what, e, strerror(e));
+    s_write_errors++;
+    close_log_file_locked();
+}
+
+// 所有落到 SD 日志文件的块都走这里（payload 可能分两段），顺带维护 .idx
+static bool file_write_block_locked(const log_journal_hdr_t *hdr,
+                                    const uint8_t *p1, size_t n1,
+                                    const uint8_t *p2, size_t n2)
+{
+    if (fwrite(hdr, sizeof(*hdr), 1, s_csv) != 1 ||
+        (n1 && fwrite(p1, 1, n1, s_csv) != n1) ||
+        (n2 && fwrite(p2, 1, n2, s_csv) != n2)) {
+        card_mark_lost_locked("block write");
+        return false;
+    }
+    log_index_file_on_block(hdr, p1, n1, p2, n2, (uint32_t)ftell(s_csv));
+    return true;
+}
+
+// journal 的 sink（需持 s_io_lock）。块的顺序永远是 flash 段 → backlog → 新块，所以：
+//   SD   ：非 staging 模式，文件可写，且 flash、backlog 都已搬空
+//   flash：非 SD-only 模式，且 backlog 为空
+//   其余情况（或上面写失败）进 PSRAM backlog
+static bool journal_sink(const log_journal_hdr_t *hdr, const uint8_t *payload, uint16_t records, void *ctx)
+{
+    (void)ctx;
+    app_sdcard_backend_t backend = s_backend;
+    if (backend != APP_SDCARD_BACKEND_FLASH_STAGING && s_csv &&
+        log_backlog_is_empty() && log_flash_is_empty()) {
+        if (file_write_block_locked(hdr, payload, hdr->stored_len, NULL, 0)) {
+            s_records_logged += records;
+            return true;
+        }
+    }
+    if (backend != APP_SDCARD_BACKEND_SD_ONLY && log_flash_ready() && log_backlog_is_empty()) {
+        if (log_flash_write(hdr, sizeof(*hdr), payload, hdr->stored_len)) {
+            s_records_logged += records;
+            return true;
+        }
+    }
+    return log_backlog_push(hdr, sizeof(*hdr), payload, hdr->stored_len, records);
+}
+
+static bool file_sync_locked(void)
 {
     if (!s_csv) {
-        return;
+        return false;
     }
-    fflush(s_csv);
-    (void)fsync(fileno(s_csv));
+    if (fflush(s_csv) != 0 || ferror(s_csv)) {
+        card_mark_lost_locked("fflush");
+        return false;
+    }
+    if (fsync(fileno(s_csv)) != 0) {
+        card_mark_lost_locked("fsync");
+        return false;
+    }
+    if (!log_index_file_sync()) {
+        ESP_LOGW(TAG, "index sync failed");
+    }
+    return true;
+}
+
+static inline void csv_sync_now(void)
+{
+    xSemaphoreTake(s_io_lock, portMAX_DELAY);
+    log_journal_seal();
+    if (s_csv && log_backlog_is_empty()) {
+        (void)file_sync_locked();
+    }
+    if (!log_flash_sync()) {
+        ESP_LOGW(TAG, "flash segment sync failed");
+    }
+    xSemaphoreGive(s_io_lock);
+    s_last_commit_us = esp_timer_get_time();
 }
 
 static esp_err_t sdcard_init_mount_once(void)
@@ -122,65 +266,102 @@ static esp_err_t sdcard_init_mount_once(void)
             s_mounted = true;
             ESP_LOGW(TAG, "SD mounted at %s", MOUNT_POINT);
         } else {
-            ESP_LOGE(TAG, "mount failed: %s", esp_err_to_name(e));
+            ESP_LOGD(TAG, "mount failed: %s", esp_err_to_name(e));
             return e;
         }
     }
     return ESP_OK;
 }
 
-static void make_unique_csv_path(char *out, size_t outsz)
+static void sdcard_unmount(void)
 {
-    for (int i = 1; i <= 9999; ++i) {
-        snprintf(out, outsz, MOUNT_POINT "/log_%04d.csv", i);
+    if (!s_mounted) {
+        return;
+    }
+    esp_err_t e = esp_vfs_fat_sdcard_unmount(MOUNT_POINT, s_card);
+    if (e != ESP_OK) {
+        ESP_LOGW(TAG, "unmount: %s", esp_err_to_name(e));
+    }
+    s_card = NULL;
+    s_mounted = false;
+    ESP_LOGW(TAG, "SD unmounted");
+}
+
+static int make_unique_csv_path(char *out, size_t outsz)
+{
+    for (int i = 1; i <= LOG_INDEX_MAX; ++i) {
+        snprintf(out, outsz, MOUNT_POINT "/log_%04d." LOG_FILE_EXT, i);
         FILE *f = fopen(out, "r");
         if (!f) {
-            return;
+            return i;
         }
         fclose(f);
     }
-    snprintf(out, outsz, MOUNT_POINT "/log_overflow.csv");
+    snprintf(out, outsz, MOUNT_POINT "/log_overflow." LOG_FILE_EXT);
+    return LOG_INDEX_MAX + 1;
+}
+
+// 上次运行可能在写块途中掉电：截掉最后一个文件的残块，并让序号接着往下编
+static uint32_t recover_previous_log(int new_index)
+{
+    uint32_t next_seq = 0;
+    if (new_index <= 1) {
+        return next_seq;
+    }
+    char prev[64];
+    if (new_index > LOG_INDEX_MAX) {
+        snprintf(prev, sizeof(prev), MOUNT_POINT "/log_%04d." LOG_FILE_EXT, LOG_INDEX_MAX);
+    } else {
+        snprintf(prev, sizeof(prev), MOUNT_POINT "/log_%04d." LOG_FILE_EXT, new_index - 1);
+    }
+
+    int64_t t0 = esp_timer_get_time();
+    size_t dropped = 0;
+    esp_err_t err = log_journal_recover(prev, &next_seq, &dropped);
+    ESP_LOGW(TAG, "recover %s: %s, dropped=%u next_seq=%" PRIu32 " (%lld us)",
+             prev, esp_err_to_name(err), (unsigned)dropped, next_seq,
+             (long long)(esp_timer_get_time() - t0));
+    return next_seq;
 }
 
-static esp_err_t csv_open_create_header(void)
+// 每次挂载都开一个新文件：先写表头 META 块并落盘，成功后才交给 logger/card 任务使用。
+// continue_seq 只在开机时为真：此时 journal 还没出过块，序号接上一个文件
+static FILE *csv_open_create_header(bool continue_seq)
 {
     if (!s_mounted) {
         ESP_LOGE(TAG, "SD not mounted");
-        return ESP_FAIL;
+        return NULL;
+    }
+    int index = make_unique_csv_path(s_csv_path, sizeof(s_csv_path));
+    uint32_t next_seq = recover_previous_log(index);
+    if (continue_seq && next_seq > log_journal_next_seq()) {
+        log_journal_begin(next_seq, journal_sink, NULL);
     }
-    make_unique_csv_path(s_csv_path, sizeof(s_csv_path));
-    ESP_LOGW(TAG, "Create CSV: %s", s_csv_path);
+    ESP_LOGW(TAG, "Create log: %s", s_csv_path);
 
-    s_csv = fopen(s_csv_path, "w");
-    if (!s_csv) {
+    FILE *f = fopen(s_csv_path, "w");
+    if (!f) {
         int e = errno;
         ESP_LOGE(TAG, "fopen failed: errno=%d (%s)", e, strerror(e));
-        return ESP_FAIL;
+        return NULL;
     }
 
-    if (setvbuf(s_csv, s_csv_buf, _IOFBF, sizeof(s_csv_buf)) != 0) {
+    if (setvbuf(f, s_csv_buf, _IOFBF, sizeof(s_csv_buf)) != 0) {
         ESP_LOGW(TAG, "setvbuf failed, continue unbuffered");
     }
 
-    const char *header =
-        "date,timestamp,timestamp_ms,latitude,longitude,speed_mps,course_deg,"
-        "acc_x,acc_y,acc_z,gyro_x,gyro_y,gyro_z,"
-        "ml_pred,ml_p_walk,ml_p_ebike\r\n";
-
-    if (fprintf(s_csv, "%s", header) <= 0) {
+    bool ok = log_journal_write_meta(f, s_csv_header, strlen(s_csv_header));
+    ok = ok && fflush(f) == 0 && fsync(fileno(f)) == 0 && !ferror(f);
+    if (!ok) {
         int e = errno;
         ESP_LOGE(TAG, "write header failed: errno=%d (%s)", e, strerror(e));
-        fclose(s_csv);
-        s_csv = NULL;
-        return ESP_FAIL;
+        fclose(f);
+        return NULL;
     }
+    (void)log_index_file_open(s_csv_path, (uint32_t)ftell(f));
 
-    csv_sync_now();
-    s_lines_since_flush = 0;
-    s_flush_since_sync = 0;
-    s_ready = true;
     ESP_LOGW(TAG, "CSV header OK & SYNCED");
-    return ESP_OK;
+    return f;
 }
 
 static void copy_token(char *dst, size_t dst_sz, const char *src)
@@ -212,7 +393,7 @@ static void update_cached_gps(const GNSS_Data *data)
 
 static void append_csv_row(const app_state_imu_sample_t *imu_sample, bool use_gps)
 {
-    if (!(s_ready && s_csv) || !imu_sample) {
+    if (!s_ready || !imu_sample) {
         return;
     }
 
@@ -234,45 +415,57 @@ static void append_csv_row(const app_state_imu_sample_t *imu_sample, bool use_gp
         crs = s_last_course;
     }
 
+    char line[LOG_LINE_MAX];
+    int n = 0;
     if (use_gps && s_have_last_gps_snapshot) {
-        fprintf(s_csv, "%s,%s,%lld,%.6lf,%.6lf,%.6f,%.6f,",
-                date_str, time_str, ts_ms, lat, lon, spd, crs);
+        n = line_appendf(line, sizeof(line), n, "%s,%s,%lld,%.6lf,%.6lf,%.6f,%.6f,",
+                         date_str, time_str, ts_ms, lat, lon, spd, crs);
     } else {
-        fprintf(s_csv, "%s,%s,%lld,,,,,", date_str, time_str, ts_ms);
+        n = line_appendf(line, sizeof(line), n, "%s,%s,%lld,,,,,", date_str, time_str, ts_ms);
     }
 
-    fprintf(s_csv, "%d,%d,%d,%d,%d,%d",
-            imu_sample->acc_x, imu_sample->acc_y, imu_sample->acc_z,
-            imu_sample->gyr_x, imu_sample->gyr_y, imu_sample->gyr_z);
+    n = line_appendf(line, sizeof(line), n, "%d,%d,%d,%d,%d,%d",
+                     imu_sample->acc_x, imu_sample->acc_y, imu_sample->acc_z,
+                     imu_sample->gyr_x, imu_sample->gyr_y, imu_sample->gyr_z);
 
 #if CONFIG_JOFTMODE_ENABLE_ML
     ml_result_t r;
     bool have_ml = ml_get_latest_result(&r);
     if (have_ml) {
-        const char *label = (r.pred == 0) ? "walk" : "ebike";
-        fprintf(s_csv, ",%s,%.3f,%.3f\r\n", label, r.p_walk, r.p_ebike);
+        const char *label = (r.gate == ML_GATE_STILL) ? "still" : ((r.pred == 0) ? "walk" : "ebike");
+        n = line_appendf(line, sizeof(line), n, ",%s,%.3f,%.3f,%s\r\n", label, r.p_walk, r.p_ebike,
+                         ml_activity_name(r.activity));
         s_last_ml = r;
         s_last_ml_valid = true;
     } else {
-        fprintf(s_csv, ",,,\r\n");
+        n = line_appendf(line, sizeof(line), n, ",,,,\r\n");
     }
 #else
-    fprintf(s_csv, ",,,\r\n");
+    n = line_appendf(line, sizeof(line), n, ",,,,\r\n");
 #endif
 
-    if (++s_lines_since_flush >= FLUSH_EVERY_LINES) {
-        s_lines_since_flush = 0;
-        fflush(s_csv);
-        if (++s_flush_since_sync >= FSYNC_EVERY_FLUSH) {
-            s_flush_since_sync = 0;
-            (void)fsync(fileno(s_csv));
-        }
+    if (n < 0) {
+        ESP_LOGW(TAG, "row too long, dropped");
+        return;
+    }
+    // 区间到点：先把上一个区间的摘要作为 INDEX 块发出去，这一行归入新区间
+    uint32_t t_ms = (uint32_t)ts_ms;
+    xSemaphoreTake(s_io_lock, portMAX_DELAY);
+    if (log_index_acc_due(&s_index_acc, t_ms)) {
+        app_sdcard_index_entry_t entry;
+        log_index_acc_finish(&s_index_acc, &entry);
+        log_journal_append_index(&entry, sizeof(entry));
     }
+    log_journal_append(line, (size_t)n);
+    log_index_acc_add(&s_index_acc, t_ms,
+                      imu_sample->acc_x, imu_sample->acc_y, imu_sample->acc_z,
+                      use_gps && s_have_last_gps_snapshot, spd, time_str);
+    xSemaphoreGive(s_io_lock);
 }
 
 static void logger_step(void)
 {
-    if (!(s_ready && s_csv)) {
+    if (!s_ready) {
         return;
     }
 
@@ -296,14 +489,20 @@ static void logger_step(void)
 #if CONFIG_JOFTMODE_ENABLE_ML
     float speed = have_gps ? gps_snapshot.speed : s_last_spd;
     float course = have_gps ? gps_snapshot.course : s_last_course;
+    int32_t fix_ms = ml_gnss_time_ms(have_gps ? gps_snapshot.timestamp : s_last_time);
     ml_window_push_sample_raw(
+        imu.timestamp_us,
         imu.acc_x, imu.acc_y, imu.acc_z,
         imu.gyr_x, imu.gyr_y, imu.gyr_z,
-        gps_valid, speed, course
+        gps_valid, speed, course, fix_ms
     );
 #endif
 
     append_csv_row(&imu, gps_valid);
+
+    if (esp_timer_get_time() - s_last_commit_us >= COMMIT_INTERVAL_US) {
+        csv_sync_now();
+    }
 }
 
 static void sdcard_logger_task(void *arg)
@@ -315,6 +514,201 @@ static void sdcard_logger_task(void *arg)
     }
 }
 
+// 把 flash 里已关闭的段顺序拷到 SD 当前文件，fsync 后再删段。段里只有完整的块，
+// 逐块搬（INDEX 块要登记偏移），每次持锁搬约 MIGRATE_CHUNK 字节；搬到一半卡没了，该段留着下次整段重搬
+static void migrate_flash(void)
+{
+    if (!s_migrate_buf) {
+        return;
+    }
+    char path[48];
+    char cur[48];
+
+    xSemaphoreTake(s_io_lock, portMAX_DELAY);
+    // 非 staging 模式卡回来了，或 backlog 在等 flash 搬空：当前段也要关掉一起搬
+    if (!log_flash_is_empty() &&
+        (s_backend != APP_SDCARD_BACKEND_FLASH_STAGING || !log_backlog_is_empty())) {
+        log_flash_rotate();
+    }
+    xSemaphoreGive(s_io_lock);
+
+    while (1) {
+        xSemaphoreTake(s_io_lock, portMAX_DELAY);
+        bool have = s_csv && log_flash_oldest_closed(path, sizeof(path));
+        xSemaphoreGive(s_io_lock);
+        if (!have) {
+            return;
+        }
+
+        int64_t t0 = esp_timer_get_time();
+        size_t total = 0;
+        FILE *seg = fopen(path, "rb");
+        bool ok = (seg != NULL);
+        bool done = false;
+        while (ok && !done) {
+            xSemaphoreTake(s_io_lock, portMAX_DELAY);
+            // 两次持锁之间 logger 可能因 flash 满淘汰了这个段
+            if (!s_csv || !log_flash_oldest_closed(cur, sizeof(cur)) || strcmp(cur, path) != 0) {
+                ok = false;
+            }
+            size_t moved = 0;
+            while (ok && moved < MIGRATE_CHUNK) {
+                log_journal_hdr_t hdr;
+                if (fread(&hdr, sizeof(hdr), 1, seg) != 1) {
+                    done = true;
+                    break;
+                }
+                if (!log_journal_hdr_ok(&hdr) ||
+                    fread(s_migrate_buf, 1, hdr.stored_len, seg) != hdr.stored_len) {
+                    ESP_LOGW(TAG, "%s: bad block at %u, rest of segment skipped", path, (unsigned)total);
+                    done = true;
+                    break;
+                }
+                ok = file_write_block_locked(&hdr, s_migrate_buf, hdr.stored_len, NULL, 0);
+                moved += sizeof(hdr) + hdr.stored_len;
+            }
+            total += moved;
+            xSemaphoreGive(s_io_lock);
+            if (!done) {
+                vTaskDelay(1);
+            }
+        }
+        if (seg) {
+            fclose(seg);
+        } else {
+            ESP_LOGE(TAG, "open %s failed, segment skipped", path);
+        }
+
+        xSemaphoreTake(s_io_lock, portMAX_DELAY);
+        if (!seg || (ok && file_sync_locked())) {
+            log_flash_remove_oldest();
+        }
+        xSemaphoreGive(s_io_lock);
+        if (seg && !ok) {
+            return;
+        }
+        ESP_LOGI(TAG, "migrated %s (%u bytes, %lld us)", path, (unsigned)total,
+                 (long long)(esp_timer_get_time() - t0));
+    }
+}
+
+// 把 backlog 按块补写进当前文件，分批持锁；写完全部后再 fsync（写失败时文件已被关闭）
+static void drain_backlog(void)
+{
+    bool drained = false;
+    while (!drained) {
+        xSemaphoreTake(s_io_lock, portMAX_DELAY);
+        for (int i = 0; i < DRAIN_CHUNK_BLOCKS && s_csv; ++i) {
+            const uint8_t *p1, *p2;
+            size_t n1, n2;
+            uint16_t records = 0;
+            if (!log_backlog_peek(&p1, &n1, &p2, &n2, &records)) {
+                drained = true;
+                break;
+            }
+            // 条目 = 块头 + payload，回绕时可能从块头中间断开
+            log_journal_hdr_t hdr;
+            size_t k = (n1 < sizeof(hdr)) ? n1 : sizeof(hdr);
+            memcpy(&hdr, p1, k);
+            if (k < sizeof(hdr)) {
+                memcpy((uint8_t *)&hdr + k, p2, sizeof(hdr) - k);
+            }
+            bool ok = (n1 >= sizeof(hdr))
+                      ? file_write_block_locked(&hdr, p1 + sizeof(hdr), n1 - sizeof(hdr), p2, n2)
+                      : file_write_block_locked(&hdr, p2 + (sizeof(hdr) - n1), n2 - (sizeof(hdr) - n1), NULL, 0);
+            if (!ok) {
+                break;
+            }
+            log_backlog_pop();
+            s_records_logged += records;
+        }
+        if (!s_csv) {
+            xSemaphoreGive(s_io_lock);
+            return;
+        }
+        if (drained) {
+            (void)file_sync_locked();
+        }
+        xSemaphoreGive(s_io_lock);
+        if (!drained) {
+            vTaskDelay(1);
+        }
+    }
+}
+
+static void publish_logger_stats(void)
+{
+    app_state_logger_stats_t st;
+    xSemaphoreTake(s_io_lock, portMAX_DELAY);
+    st.card_present = (s_csv != NULL);
+    st.remounts = s_remounts;
+    st.write_errors = s_write_errors;
+    st.backlog_bytes = (uint32_t)log_backlog_used();
+    st.backlog_capacity = (uint32_t)log_backlog_capacity();
+    st.backlog_blocks = log_backlog_blocks();
+    st.dropped_blocks = log_backlog_dropped_blocks();
+    st.dropped_records = log_backlog_dropped_records();
+    st.records_logged = s_records_logged;
+    st.backend = (uint8_t)s_backend;
+    st.flash_bytes = (uint32_t)log_flash_used();
+    st.flash_capacity = (uint32_t)log_flash_capacity();
+    st.flash_dropped_segments = log_flash_dropped_segments();
+    xSemaphoreGive(s_io_lock);
+    app_state_set_logger_stats(&st);
+}
+
+static void sdcard_card_task(void *arg)
+{
+    int64_t next_retry_us = 0;
+    bool was_present = (s_csv != NULL);
+    while (1) {
+        // 有卡：查状态；状态失败或之前写失败（s_csv 已关）都卸载，等重挂
+        xSemaphoreTake(s_io_lock, portMAX_DELAY);
+        if (s_mounted) {
+            if (s_csv && sdmmc_get_status(s_card) != ESP_OK) {
+                ESP_LOGW(TAG, "card status check failed, card removed?");
+                close_log_file_locked();
+            }
+            if (!s_csv && s_readers == 0) {
+                sdcard_unmount();
+            }
+        }
+        xSemaphoreGive(s_io_lock);
+
+        if (was_present && !s_mounted) {
+            ESP_LOGW(TAG, "SD lost, buffering to PSRAM backlog");
+            was_present = false;
+        }
+
+        // 没卡：按间隔重试挂载。新文件在锁外准备好（s_csv 还是 NULL，sink 只往 backlog 里放）
+        if (!s_mounted && esp_timer_get_time() >= next_retry_us) {
+            next_retry_us = esp_timer_get_time() + (int64_t)CARD_RETRY_MS * 1000;
+            if (sdcard_init_mount_once() == ESP_OK) {
+                FILE *f = csv_open_create_header(false);
+                if (f) {
+                    xSemaphoreTake(s_io_lock, portMAX_DELAY);
+                    s_csv = f;
+                    s_remounts++;
+                    xSemaphoreGive(s_io_lock);
+                    was_present = true;
+                    ESP_LOGW(TAG, "SD back, flushing %u byte backlog", (unsigned)log_backlog_used());
+                }
+                // 建文件失败：留着挂载，下一轮在锁下按 s_readers 卸载（挂上之后读者可能已经打开了文件）
+            }
+        }
+
+        if (s_csv) {
+            migrate_flash();
+        }
+        if (s_csv && log_flash_is_empty() && !log_backlog_is_empty()) {
+            drain_backlog();
+        }
+
+        publish_logger_stats();
+        vTaskDelay(pdMS_TO_TICKS(CARD_POLL_MS));
+    }
+}
+
 void app_sdcard_start(void)
 {
     static bool done = false;
@@ -324,15 +718,43 @@ void app_sdcard_start(void)
     done = true;
 
     ESP_LOGW(TAG, "init...");
-    if (sdcard_init_mount_once() != ESP_OK) {
-        return;
+    if (s_io_lock == NULL) {
+        s_io_lock = xSemaphoreCreateMutexStatic(&s_io_lock_buffer);
     }
-    if (csv_open_create_header() != ESP_OK) {
-        return;
+    (void)log_backlog_init(BACKLOG_BYTES);
+    s_migrate_buf = heap_caps_malloc(MIGRATE_CHUNK, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!s_migrate_buf) {
+        s_migrate_buf = malloc(MIGRATE_CHUNK);
     }
 
+    // 序号接着 flash 段或上一个 SD 文件里较大的那个往下编；
+    // 没卡也照常启动 logger，按当前后端写进 flash 或 backlog
+    uint32_t first_seq = 0;
+    (void)log_flash_init(&first_seq);
+    log_journal_begin(first_seq, journal_sink, NULL);
+    if (sdcard_init_mount_once() == ESP_OK) {
+#if CONFIG_JOFTMODE_ML_PKG_SD_UPDATE
+        esp_err_t perr = ml_pkg_update_from_file(MOUNT_POINT "/" ML_PKG_UPDATE_FILE);
+        if (perr != ESP_OK && perr != ESP_ERR_NOT_FOUND) {
+            ESP_LOGE(TAG, "model package update failed: %s", esp_err_to_name(perr));
+        }
+#endif
+        s_csv = csv_open_create_header(true);
+        if (!s_csv) {
+            sdcard_unmount();
+        }
+    } else {
+        ESP_LOGW(TAG, "no SD card at boot, logging to backlog until one is inserted");
+    }
+    s_last_commit_us = esp_timer_get_time();
+    s_ready = true;
+
     if (s_logger_task == NULL) {
-        xTaskCreate(sdcard_logger_task, "sd_logger", 4096, NULL, 8, &s_logger_task);
+        xTaskCreatePinnedToCore(sdcard_logger_task, "sd_logger", 4096, NULL, 8, &s_logger_task,
+                                LOGGER_TASK_CORE);
+    }
+    if (s_card_task == NULL) {
+        xTaskCreate(sdcard_card_task, "sd_card", 4096, NULL, 3, &s_card_task);
     }
 }
 
@@ -341,6 +763,127 @@ bool app_sdcard_is_ready(void)
     return s_ready && (s_csv != NULL);
 }
 
+void app_sdcard_set_backend(app_sdcard_backend_t backend)
+{
+    if (backend > APP_SDCARD_BACKEND_FLASH_STAGING) {
+        return;
+    }
+    if (s_io_lock) {
+        xSemaphoreTake(s_io_lock, portMAX_DELAY);
+    }
+    if (backend != s_backend) {
+        ESP_LOGW(TAG, "log backend %d -> %d", (int)s_backend, (int)backend);
+    }
+    s_backend = backend;
+    if (s_io_lock) {
+        xSemaphoreGive(s_io_lock);
+    }
+}
+
+app_sdcard_backend_t app_sdcard_get_backend(void)
+{
+    return s_backend;
+}
+
+// path 为 NULL 时指当前文件：先把未封的块和 stdio 缓冲推到卡上，读者才看得到最新数据。
+// 成功时登记为读者，读完必须调 reader_done()
+static esp_err_t resolve_read_path(const char *path, char *out, size_t outsz)
+{
+    if (!s_io_lock) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    esp_err_t err = ESP_ERR_NOT_FOUND;
+    xSemaphoreTake(s_io_lock, portMAX_DELAY);
+    if (path) {
+        snprintf(out, outsz, "%s", path);
+        err = ESP_OK;
+    } else if (s_csv) {
+        log_journal_seal();
+        if (log_backlog_is_empty() && fflush(s_csv) == 0) {
+            log_index_file_sync();
+        }
+        snprintf(out, outsz, "%s", s_csv_path);
+        err = ESP_OK;
+    }
+    if (err == ESP_OK) {
+        s_readers++;
+    }
+    xSemaphoreGive(s_io_lock);
+    return err;
+}
+
+static void reader_done(void)
+{
+    xSemaphoreTake(s_io_lock, portMAX_DELAY);
+    s_readers--;
+    xSemaphoreGive(s_io_lock);
+}
+
+esp_err_t app_sdcard_read_range(const char *path, int64_t from_ms, int64_t to_ms,
+                                app_sdcard_row_cb_t cb, void *ctx)
+{
+    char p[64];
+    esp_err_t err = resolve_read_path(path, p, sizeof(p));
+    if (err != ESP_OK) {
+        return err;
+    }
+    err = log_index_read_range(p, from_ms, to_ms, cb, ctx, s_io_lock);
+    reader_done();
+    return err;
+}
+
+esp_err_t app_sdcard_read_index(const char *path, app_sdcard_index_cb_t cb, void *ctx)
+{
+    char p[64];
+    esp_err_t err = resolve_read_path(path, p, sizeof(p));
+    if (err != ESP_OK) {
+        return err;
+    }
+    err = log_index_read_entries(p, cb, ctx, s_io_lock);
+    reader_done();
+    return err;
+}
+
+esp_err_t app_sdcard_append_text(const char *name, const char *text, size_t len)
+{
+    if (!s_io_lock || !name || !text) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    char path[64];
+    snprintf(path, sizeof(path), MOUNT_POINT "/%s", name);
+    esp_err_t err = ESP_ERR_INVALID_STATE;
+    xSemaphoreTake(s_io_lock, portMAX_DELAY);
+    // 看 s_csv 而不是 s_mounted：card 任务重试挂载 / 卸载时不持锁改 s_mounted，但只在 s_csv 为 NULL 时卸载，
+    // 而 s_csv 只在锁下变，持锁看到它非空，这段时间里卡就不会被卸掉
+    if (s_csv) {
+        FILE *f = fopen(path, "a");
+        if (!f) {
+            err = ESP_FAIL;
+        } else {
+            err = (fwrite(text, 1, len, f) == len) ? ESP_OK : ESP_FAIL;
+            if (fclose(f) != 0) {
+                err = ESP_FAIL;
+            }
+        }
+    }
+    xSemaphoreGive(s_io_lock);
+    return err;
+}
+
+bool app_sdcard_get_compress_stats(app_sdcard_compress_stats_t *out)
+{
+#if CONFIG_JOFTMODE_SD_COMPRESS
+    if (!out) {
+        return false;
+    }
+    log_journal_get_compress_stats(out);
+    return true;
+#else
+    (void)out;
+    return false;
+#endif
+}
+
 #if CONFIG_JOFTMODE_ENABLE_ML
 bool app_ml_get_latest(ml_result_t *out)
 {
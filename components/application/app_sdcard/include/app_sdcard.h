@@ -1,6 +1,11 @@
 #ifndef APP_SDCARD_H
 #define APP_SDCARD_H
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
 #include "sdkconfig.h"
 
 #if CONFIG_JOFTMODE_ENABLE_ML
@@ -11,8 +16,64 @@
 extern "C" {
 #endif
 
+typedef struct {
+    uint32_t blocks;             // 已写出的压缩块数
+    uint64_t raw_bytes;          // 压缩前的 CSV 字节数
+    uint64_t stored_bytes;       // 实际落盘字节数（含块头）
+    uint32_t last_ratio_x100;    // 最近一块的压缩比 ×100
+    uint32_t last_compress_us;   // 最近一块的压缩耗时
+    uint32_t max_compress_us;
+    uint64_t total_compress_us;
+} app_sdcard_compress_stats_t;
+
+// 时间索引条目：每 JOFTMODE_SD_INDEX_INTERVAL_S 秒一条，同时写进日志流（INDEX 块）和 .idx 旁路文件。
+// 时间同 CSV 的 timestamp_ms 列（开机后毫秒）；速度单位 cm/s，|acc| 为原始 LSB
+#define APP_SDCARD_INDEX_NONE   0xFFFF
+typedef struct __attribute__((packed)) {
+    uint32_t t_start_ms;      // 区间第一行的 timestamp_ms
+    uint32_t t_end_ms;        // 区间最后一行的 timestamp_ms
+    uint32_t data_offset;     // 区间第一个数据块在日志文件里的偏移（只在 .idx 里有效）
+    uint32_t next_offset;     // 本条 INDEX 块之后的偏移，即下一区间数据的起点（只在 .idx 里有效）
+    int32_t  utc_sod;         // 区间内第一次有效定位的 UTC 当日秒数，-1 表示无定位
+    uint16_t records;
+    uint16_t gps_records;     // 其中有效定位的行数
+    uint16_t acc_min;
+    uint16_t acc_max;
+    uint16_t acc_mean;
+    uint16_t spd_min;         // 无定位时为 APP_SDCARD_INDEX_NONE
+    uint16_t spd_max;
+    uint16_t spd_mean;
+} app_sdcard_index_entry_t;
+
+// 返回 false 停止遍历
+typedef bool (*app_sdcard_row_cb_t)(const char *row, size_t len, void *ctx);
+typedef bool (*app_sdcard_index_cb_t)(const app_sdcard_index_entry_t *entry, void *ctx);
+
+// 日志落在哪里：运行时可切换，开机默认值见 JOFTMODE_LOG_BACKEND
+typedef enum {
+    APP_SDCARD_BACKEND_SD_ONLY = 0,      // 只写 SD，没卡时暂存在 PSRAM backlog
+    APP_SDCARD_BACKEND_FLASH_FALLBACK,   // 有卡写 SD，没卡写内部 flash，卡回来后搬过去
+    APP_SDCARD_BACKEND_FLASH_STAGING,    // 始终先写内部 flash，整段搬到 SD
+} app_sdcard_backend_t;
+
 void app_sdcard_start(void);
 bool app_sdcard_is_ready(void);
+void app_sdcard_set_backend(app_sdcard_backend_t backend);
+app_sdcard_backend_t app_sdcard_get_backend(void);
+
+/**
+ * 按时间范围读日志：先查 .idx 定位到区间所在的块，只解这些块，逐行回调（不含表头，行尾带 \r\n）。
+ * @param path  日志文件路径，NULL 表示当前正在写的文件
+ * @param from_ms/to_ms  闭区间，单位同 timestamp_ms 列
+ */
+esp_err_t app_sdcard_read_range(const char *path, int64_t from_ms, int64_t to_ms,
+                                app_sdcard_row_cb_t cb, void *ctx);
+// 遍历 .idx 里的区间摘要（画历史曲线用，不读日志本体）
+esp_err_t app_sdcard_read_index(const char *path, app_sdcard_index_cb_t cb, void *ctx);
+// 往卡根目录的 name 文件末尾追加文本（诊断输出用，比如 GUI 剖析）。卡不在（日志文件没开着）返回 ESP_ERR_INVALID_STATE
+esp_err_t app_sdcard_append_text(const char *name, const char *text, size_t len);
+// 仅在 CONFIG_JOFTMODE_SD_COMPRESS 打开时返回 true
+bool app_sdcard_get_compress_stats(app_sdcard_compress_stats_t *out);
 #if CONFIG_JOFTMODE_ENABLE_ML
 bool app_ml_get_latest(ml_result_t *out);
 #endif
@@ -0,0 +1,32 @@
+// LZ4 块压缩 / 解压：SD 日志的压缩级，app_img 解压打包图片也用这一套
+#ifndef LOG_LZ4_H
+#define LOG_LZ4_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// 12 位哈希表要 8 KB；取 11 位，整个压缩级（哈希表 + 原始块 / 输出块）控制在 16 KB 以内
+#define LOG_LZ4_HASH_LOG     11
+#define LOG_LZ4_TABLE_SIZE   (1u << LOG_LZ4_HASH_LOG)
+
+// n 字节不可压缩输入的最坏输出长度（LZ4 块格式）
+#define LOG_LZ4_BOUND(n)     ((n) + ((n) / 255) + 16)
+
+/**
+ * 压缩一个独立的 LZ4 块（标准块格式，不带帧头）。
+ * 每次调用都从空字典开始，所以每块都能单独解开。
+ * @param table  LOG_LZ4_TABLE_SIZE 项的哈希表临时区（多次调用可复用）
+ * @return 写入 dst 的字节数；dst_cap 不够或 src_len > 64 KB 时返回 -1
+ */
+int log_lz4_compress(const uint8_t *src, size_t src_len,
+                     uint8_t *dst, size_t dst_cap,
+                     uint16_t *table);
+
+/**
+ * 解开一个 log_lz4_compress 压出的 LZ4 块（带越界检查，供设备上回读用）。
+ * @return 写入 dst 的字节数；输入格式不对或 dst 放不下时返回 -1
+ */
+int log_lz4_decompress(const uint8_t *src, size_t src_len,
+                       uint8_t *dst, size_t dst_cap);
+
+#endif /* LOG_LZ4_H */
@@ -0,0 +1,169 @@
+#include <string.h>
+
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+
+#include "log_backlog.h"
+
+typedef struct __attribute__((packed)) {
+    uint16_t len;       // 条目 payload 字节数（hdr + 块数据）
+    uint16_t records;   // 块内 CSV 行数，丢弃时计数用
+} entry_hdr_t;
+
+static const char *TAG = "log_backlog";
+
+static uint8_t *s_buf = NULL;
+static size_t s_cap = 0;
+static size_t s_head = 0;     // 最旧条目起点
+static size_t s_used = 0;
+static uint32_t s_blocks = 0;
+static uint32_t s_dropped_blocks = 0;
+static uint32_t s_dropped_records = 0;
+
+static void ring_write(size_t pos, const void *src, size_t n)
+{
+    size_t first = s_cap - pos;
+    if (first > n) {
+        first = n;
+    }
+    memcpy(s_buf + pos, src, first);
+    memcpy(s_buf, (const uint8_t *)src + first, n - first);
+}
+
+static void ring_read(size_t pos, void *dst, size_t n)
+{
+    size_t first = s_cap - pos;
+    if (first > n) {
+        first = n;
+    }
+    memcpy(dst, s_buf + pos, first);
+    memcpy((uint8_t *)dst + first, s_buf, n - first);
+}
+
+esp_err_t log_backlog_init(size_t capacity)
+{
+    if (s_buf) {
+        return ESP_OK;
+    }
+    s_buf = heap_caps_malloc(capacity, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!s_buf) {
+        ESP_LOGE(TAG, "no PSRAM for %u byte backlog, records will be dropped while the card is out",
+                 (unsigned)capacity);
+        return ESP_ERR_NO_MEM;
+    }
+    s_cap = capacity;
+    s_head = 0;
+    s_used = 0;
+    ESP_LOGI(TAG, "backlog %u KB in PSRAM", (unsigned)(capacity / 1024));
+    return ESP_OK;
+}
+
+static void drop_oldest(void)
+{
+    entry_hdr_t e;
+    ring_read(s_head, &e, sizeof(e));
+    size_t total = sizeof(e) + e.len;
+    s_head = (s_head + total) % s_cap;
+    s_used -= total;
+    s_blocks--;
+    s_dropped_blocks++;
+    s_dropped_records += e.records;
+}
+
+bool log_backlog_push(const void *hdr, size_t hdr_len,
+                      const void *payload, size_t payload_len,
+                      uint16_t records)
+{
+    size_t len = hdr_len + payload_len;
+    size_t total = sizeof(entry_hdr_t) + len;
+    if (!s_buf || len > UINT16_MAX || total > s_cap) {
+        s_dropped_blocks++;
+        s_dropped_records += records;
+        return false;
+    }
+    while (s_cap - s_used < total) {
+        drop_oldest();
+    }
+
+    entry_hdr_t e = { .len = (uint16_t)len, .records = records };
+    size_t pos = (s_head + s_used) % s_cap;
+    ring_write(pos, &e, sizeof(e));
+    pos = (pos + sizeof(e)) % s_cap;
+    ring_write(pos, hdr, hdr_len);
+    pos = (pos + hdr_len) % s_cap;
+    ring_write(pos, payload, payload_len);
+
+    s_used += total;
+    s_blocks++;
+    return true;
+}
+
+bool log_backlog_peek(const uint8_t **p1, size_t *n1,
+                      const uint8_t **p2, size_t *n2, uint16_t *records)
+{
+    if (!s_buf || s_used == 0) {
+        return false;
+    }
+    entry_hdr_t e;
+    ring_read(s_head, &e, sizeof(e));
+    size_t pos = (s_head + sizeof(e)) % s_cap;
+    size_t first = s_cap - pos;
+    if (records) {
+        *records = e.records;
+    }
+    if (first >= e.len) {
+        *p1 = s_buf + pos;
+        *n1 = e.len;
+        *p2 = NULL;
+        *n2 = 0;
+    } else {
+        *p1 = s_buf + pos;
+        *n1 = first;
+        *p2 = s_buf;
+        *n2 = e.len - first;
+    }
+    return true;
+}
+
+void log_backlog_pop(void)
+{
+    if (!s_buf || s_used == 0) {
+        return;
+    }
+    entry_hdr_t e;
+    ring_read(s_head, &e, sizeof(e));
+    size_t total = sizeof(e) + e.len;
+    s_head = (s_head + total) % s_cap;
+    s_used -= total;
+    s_blocks--;
+}
+
+bool log_backlog_is_empty(void)
+{
+    return s_used == 0;
+}
+
+size_t log_backlog_used(void)
+{
+    return s_used;
+}
+
+size_t log_backlog_capacity(void)
+{
+    return s_cap;
+}
+
+uint32_t log_backlog_blocks(void)
+{
+    return s_blocks;
+}
+
+uint32_t log_backlog_dropped_blocks(void)
+{
+    return s_dropped_blocks;
+}
+
+uint32_t log_backlog_dropped_records(void)
+{
+    return s_dropped_records;
+}
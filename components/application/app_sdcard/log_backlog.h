@@ -0,0 +1,33 @@
+#ifndef LOG_BACKLOG_H
+#define LOG_BACKLOG_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+// 卡不在/重挂载期间暂存已编码的 journal 块（PSRAM 环形缓冲）。
+// 满了丢最旧的块，并累计丢弃的块数/记录行数。调用方负责加锁。
+
+esp_err_t log_backlog_init(size_t capacity);
+
+// 整块入队（hdr + payload 两段拼成一个条目），records 为块内 CSV 行数
+bool log_backlog_push(const void *hdr, size_t hdr_len,
+                      const void *payload, size_t payload_len,
+                      uint16_t records);
+
+// 取最旧条目的只读视图（可能因回绕被拆成两段，p2 可为 NULL）及其记录行数
+bool log_backlog_peek(const uint8_t **p1, size_t *n1,
+                      const uint8_t **p2, size_t *n2, uint16_t *records);
+// 丢掉最旧条目（peek 写盘成功后调用）
+void log_backlog_pop(void);
+
+bool log_backlog_is_empty(void);
+size_t log_backlog_used(void);
+size_t log_backlog_capacity(void);
+uint32_t log_backlog_blocks(void);
+uint32_t log_backlog_dropped_blocks(void);
+uint32_t log_backlog_dropped_records(void);
+
+#endif /* LOG_BACKLOG_H */
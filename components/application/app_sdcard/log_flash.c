@@ -0,0 +1,228 @@
+#include <dirent.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/unistd.h>
+
+#include "esp_littlefs.h"
+#include "esp_log.h"
+
+#include "log_flash.h"
+#include "log_journal.h"
+
+// LittleFS 需要留空闲块做磨损均衡和写时复制，只用分区的 3/4
+#define FLASH_USABLE_NUM    3
+#define FLASH_USABLE_DEN    4
+
+static const char *TAG = "log_flash";
+
+static bool s_ready = false;
+static size_t s_cap = 0;
+static size_t s_used = 0;
+static uint32_t s_first_id = 0;     // 最旧段
+static uint32_t s_next_id = 0;      // 下一个新段
+static FILE *s_active = NULL;       // 当前段（id = s_next_id - 1）
+static size_t s_active_len = 0;
+static uint32_t s_dropped_segments = 0;
+
+static void seg_path(uint32_t id, char *out, size_t outsz)
+{
+    snprintf(out, outsz, LOG_FLASH_BASE_PATH "/seg_%08" PRIu32 ".jlg", id);
+}
+
+static size_t seg_size(uint32_t id)
+{
+    char path[48];
+    struct stat st;
+    seg_path(id, path, sizeof(path));
+    if (stat(path, &st) != 0) {
+        return 0;
+    }
+    return (size_t)st.st_size;
+}
+
+static bool scan_segments(void)
+{
+    DIR *dir = opendir(LOG_FLASH_BASE_PATH);
+    if (!dir) {
+        return false;
+    }
+    bool any = false;
+    uint32_t lo = UINT32_MAX, hi = 0;
+    struct dirent *de;
+    while ((de = readdir(dir)) != NULL) {
+        unsigned long id;
+        if (sscanf(de->d_name, "seg_%8lu.jlg", &id) != 1) {
+            continue;
+        }
+        any = true;
+        if (id < lo) {
+            lo = (uint32_t)id;
+        }
+        if (id > hi) {
+            hi = (uint32_t)id;
+        }
+    }
+    closedir(dir);
+
+    if (any) {
+        s_first_id = lo;
+        s_next_id = hi + 1;
+    } else {
+        s_first_id = s_next_id = 0;
+    }
+    return any;
+}
+
+esp_err_t log_flash_init(uint32_t *out_next_seq)
+{
+    if (s_ready) {
+        return ESP_OK;
+    }
+    esp_vfs_littlefs_conf_t conf = {
+        .base_path = LOG_FLASH_BASE_PATH,
+        .partition_label = LOG_FLASH_PARTITION,
+        .format_if_mount_failed = true,
+        .dont_mount = false,
+    };
+    esp_err_t err = esp_vfs_littlefs_register(&conf);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "littlefs mount failed: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    size_t total = 0, used = 0;
+    esp_littlefs_info(LOG_FLASH_PARTITION, &total, &used);
+    s_cap = total / FLASH_USABLE_DEN * FLASH_USABLE_NUM;
+
+    if (scan_segments()) {
+        // 只有最后一段可能在写块途中掉电
+        char path[48];
+        seg_path(s_next_id - 1, path, sizeof(path));
+        (void)log_journal_recover(path, out_next_seq, NULL);
+        // 段号可能不连续（中途被删过），缺的按空段处理
+        for (uint32_t id = s_first_id; id < s_next_id; ++id) {
+            s_used += seg_size(id);
+        }
+    }
+    s_ready = true;
+    ESP_LOGW(TAG, "flash log: %u segments, %u/%u KB pending",
+             (unsigned)(s_next_id - s_first_id), (unsigned)(s_used / 1024), (unsigned)(s_cap / 1024));
+    return ESP_OK;
+}
+
+bool log_flash_ready(void)
+{
+    return s_ready;
+}
+
+void log_flash_rotate(void)
+{
+    if (s_active) {
+        fclose(s_active);
+        s_active = NULL;
+        s_active_len = 0;
+    }
+}
+
+static void drop_oldest_segment(void)
+{
+    char path[48];
+    seg_path(s_first_id, path, sizeof(path));
+    size_t n = seg_size(s_first_id);
+    unlink(path);
+    s_used = (s_used > n) ? s_used - n : 0;
+    s_first_id++;
+}
+
+bool log_flash_write(const void *hdr, size_t hdr_len, const void *payload, size_t payload_len)
+{
+    if (!s_ready) {
+        return false;
+    }
+    size_t n = hdr_len + payload_len;
+    if (s_active && s_active_len + n > LOG_FLASH_SEG_MAX) {
+        log_flash_rotate();
+    }
+    // 淘汰最旧的已关闭段，直到放得下
+    while (s_used + n > s_cap && s_first_id < s_next_id - (s_active ? 1 : 0)) {
+        drop_oldest_segment();
+        s_dropped_segments++;
+    }
+    if (s_used + n > s_cap) {
+        return false;
+    }
+
+    if (!s_active) {
+        char path[48];
+        seg_path(s_next_id, path, sizeof(path));
+        s_active = fopen(path, "wb");
+        if (!s_active) {
+            int e = errno;
+            ESP_LOGE(TAG, "open %s failed: errno=%d (%s)", path, e, strerror(e));
+            return false;
+        }
+        s_next_id++;
+        s_active_len = 0;
+    }
+
+    if (fwrite(hdr, 1, hdr_len, s_active) != hdr_len ||
+        fwrite(payload, 1, payload_len, s_active) != payload_len) {
+        int e = errno;
+        ESP_LOGE(TAG, "segment write failed: errno=%d (%s)", e, strerror(e));
+        log_flash_rotate();
+        return false;
+    }
+    s_active_len += n;
+    s_used += n;
+    return true;
+}
+
+bool log_flash_sync(void)
+{
+    if (!s_active) {
+        return true;
+    }
+    return fflush(s_active) == 0 && fsync(fileno(s_active)) == 0;
+}
+
+bool log_flash_is_empty(void)
+{
+    return !s_ready || s_used == 0;
+}
+
+bool log_flash_oldest_closed(char *path, size_t path_sz)
+{
+    uint32_t closed_end = s_next_id - (s_active ? 1 : 0);
+    if (!s_ready || s_first_id >= closed_end) {
+        return false;
+    }
+    seg_path(s_first_id, path, path_sz);
+    return true;
+}
+
+void log_flash_remove_oldest(void)
+{
+    uint32_t closed_end = s_next_id - (s_active ? 1 : 0);
+    if (s_ready && s_first_id < closed_end) {
+        drop_oldest_segment();
+    }
+}
+
+size_t log_flash_used(void)
+{
+    return s_used;
+}
+
+size_t log_flash_capacity(void)
+{
+    return s_cap;
+}
+
+uint32_t log_flash_dropped_segments(void)
+{
+    return s_dropped_segments;
+}
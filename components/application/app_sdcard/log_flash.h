@@ -0,0 +1,39 @@
+#ifndef LOG_FLASH_H
+#define LOG_FLASH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+// 内部 flash 上的 journal 块环：LittleFS（自带磨损均衡）里的一串段文件 seg_XXXXXXXX.jlg，
+// 每段只含完整的数据块，可原样拼到 SD 日志文件后面。满了删最旧的段。调用方负责加锁。
+#define LOG_FLASH_BASE_PATH     "/flash"
+#define LOG_FLASH_PARTITION     "storage"
+#define LOG_FLASH_SEG_MAX       (32 * 1024)
+
+/**
+ * 挂载分区并扫描已有的段，截掉上次掉电留下的残块。
+ * @param out_next_seq 若 flash 里有数据块，返回下一块的序号（否则不修改）
+ */
+esp_err_t log_flash_init(uint32_t *out_next_seq);
+bool log_flash_ready(void);
+
+// 追加一个完整块（hdr + payload）；当前段写满后自动换段，空间不够时淘汰最旧的段
+bool log_flash_write(const void *hdr, size_t hdr_len, const void *payload, size_t payload_len);
+bool log_flash_sync(void);
+// 关闭当前段（非空时），让它可以被搬到 SD
+void log_flash_rotate(void);
+
+bool log_flash_is_empty(void);
+// 最旧的已关闭段；没有时返回 false
+bool log_flash_oldest_closed(char *path, size_t path_sz);
+// 删除最旧的已关闭段（搬运完成后调用）
+void log_flash_remove_oldest(void);
+
+size_t log_flash_used(void);
+size_t log_flash_capacity(void);
+uint32_t log_flash_dropped_segments(void);
+
+#endif /* LOG_FLASH_H */
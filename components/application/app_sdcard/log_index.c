@@ -0,0 +1,439 @@
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/unistd.h>
+
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "sdkconfig.h"
+
+#include "log_index.h"
+#include "log_lz4.h"
+
+#define INDEX_MAGIC0    'J'
+#define INDEX_MAGIC1    'I'
+#define INDEX_MAGIC2    'X'
+#define INDEX_VERSION   1
+
+typedef struct __attribute__((packed)) {
+    uint8_t  magic[3];
+    uint8_t  version;
+    uint16_t entry_size;     // sizeof(app_sdcard_index_entry_t)，以后加字段时旧读者按它跳
+    uint16_t interval_s;
+} index_file_hdr_t;
+
+static const char *TAG = "log_index";
+
+static FILE *s_idx = NULL;
+static uint32_t s_data_start = 0;
+
+// ---------------- logger 侧 ----------------
+
+// "hhmmss.ss" -> 当日秒数
+static int32_t parse_utc_sod(const char *utc)
+{
+    if (!utc || strlen(utc) < 6) {
+        return -1;
+    }
+    for (int i = 0; i < 6; ++i) {
+        if (utc[i] < '0' || utc[i] > '9') {
+            return -1;
+        }
+    }
+    int hh = (utc[0] - '0') * 10 + (utc[1] - '0');
+    int mm = (utc[2] - '0') * 10 + (utc[3] - '0');
+    int ss = (utc[4] - '0') * 10 + (utc[5] - '0');
+    return hh * 3600 + mm * 60 + ss;
+}
+
+void log_index_acc_add(log_index_acc_t *acc, uint32_t t_ms,
+                       int16_t ax, int16_t ay, int16_t az,
+                       bool gps_valid, float speed_mps, const char *utc_time)
+{
+    if (!acc->active) {
+        memset(acc, 0, sizeof(*acc));
+        acc->active = true;
+        acc->t_start_ms = t_ms;
+        acc->utc_sod = -1;
+        acc->acc_min = UINT32_MAX;
+        acc->spd_min = UINT32_MAX;
+    }
+    acc->t_end_ms = t_ms;
+    acc->records++;
+
+    float mag = sqrtf((float)ax * ax + (float)ay * ay + (float)az * az);
+    uint32_t m = (uint32_t)(mag + 0.5f);
+    if (m < acc->acc_min) {
+        acc->acc_min = m;
+    }
+    if (m > acc->acc_max) {
+        acc->acc_max = m;
+    }
+    acc->acc_sum += m;
+
+    if (gps_valid) {
+        float cms = speed_mps * 100.0f;
+        uint32_t v = (cms <= 0.0f) ? 0 : (cms >= 65534.0f) ? 65534 : (uint32_t)(cms + 0.5f);
+        if (v < acc->spd_min) {
+            acc->spd_min = v;
+        }
+        if (v > acc->spd_max) {
+            acc->spd_max = v;
+        }
+        acc->spd_sum += v;
+        acc->gps_records++;
+        if (acc->utc_sod < 0) {
+            acc->utc_sod = parse_utc_sod(utc_time);
+        }
+    }
+}
+
+bool log_index_acc_due(const log_index_acc_t *acc, uint32_t t_ms)
+{
+    return acc->active && (uint32_t)(t_ms - acc->t_start_ms) >= LOG_INDEX_INTERVAL_MS;
+}
+
+void log_index_acc_finish(log_index_acc_t *acc, app_sdcard_index_entry_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    out->t_start_ms = acc->t_start_ms;
+    out->t_end_ms = acc->t_end_ms;
+    out->utc_sod = acc->utc_sod;
+    out->records = (uint16_t)((acc->records > UINT16_MAX) ? UINT16_MAX : acc->records);
+    out->gps_records = (uint16_t)((acc->gps_records > UINT16_MAX) ? UINT16_MAX : acc->gps_records);
+    if (acc->records) {
+        out->acc_min = (uint16_t)((acc->acc_min > UINT16_MAX) ? UINT16_MAX : acc->acc_min);
+        out->acc_max = (uint16_t)((acc->acc_max > UINT16_MAX) ? UINT16_MAX : acc->acc_max);
+        out->acc_mean = (uint16_t)(acc->acc_sum / acc->records);
+    }
+    if (acc->gps_records) {
+        out->spd_min = (uint16_t)acc->spd_min;
+        out->spd_max = (uint16_t)acc->spd_max;
+        out->spd_mean = (uint16_t)(acc->spd_sum / acc->gps_records);
+    } else {
+        out->spd_min = out->spd_max = out->spd_mean = APP_SDCARD_INDEX_NONE;
+    }
+    acc->active = false;
+}
+
+// ---------------- .idx 旁路文件 ----------------
+
+static void index_path_for(const char *log_path, char *out, size_t outsz)
+{
+    snprintf(out, outsz, "%s", log_path);
+    char *dot = strrchr(out, '.');
+    char *slash = strrchr(out, '/');
+    if (dot && (!slash || dot > slash)) {
+        *dot = '\0';
+    }
+    size_t len = strlen(out);
+    snprintf(out + len, outsz - len, "." LOG_INDEX_FILE_EXT);
+}
+
+esp_err_t log_index_file_open(const char *log_path, uint32_t data_start)
+{
+    log_index_file_close();
+    char path[72];
+    index_path_for(log_path, path, sizeof(path));
+    s_idx = fopen(path, "wb");
+    if (!s_idx) {
+        int e = errno;
+        ESP_LOGW(TAG, "open %s failed: errno=%d (%s), range reads will scan", path, e, strerror(e));
+        return ESP_FAIL;
+    }
+    index_file_hdr_t hdr = {
+        .magic = {INDEX_MAGIC0, INDEX_MAGIC1, INDEX_MAGIC2},
+        .version = INDEX_VERSION,
+        .entry_size = sizeof(app_sdcard_index_entry_t),
+        .interval_s = CONFIG_JOFTMODE_SD_INDEX_INTERVAL_S,
+    };
+    if (fwrite(&hdr, sizeof(hdr), 1, s_idx) != 1) {
+        log_index_file_close();
+        return ESP_FAIL;
+    }
+    s_data_start = data_start;
+    return ESP_OK;
+}
+
+void log_index_file_close(void)
+{
+    if (s_idx) {
+        fclose(s_idx);
+        s_idx = NULL;
+    }
+}
+
+void log_index_file_on_block(const log_journal_hdr_t *hdr,
+                             const uint8_t *p1, size_t n1,
+                             const uint8_t *p2, size_t n2,
+                             uint32_t end_offset)
+{
+    if (!(hdr->flags & LOG_JOURNAL_FLAG_INDEX)) {
+        return;
+    }
+    app_sdcard_index_entry_t e;
+    if (n1 + n2 < sizeof(e)) {
+        return;
+    }
+    size_t k = (n1 < sizeof(e)) ? n1 : sizeof(e);
+    memcpy(&e, p1, k);
+    if (k < sizeof(e)) {
+        memcpy((uint8_t *)&e + k, p2, sizeof(e) - k);
+    }
+
+    e.data_offset = s_data_start;
+    e.next_offset = end_offset;
+    s_data_start = end_offset;
+    if (s_idx && fwrite(&e, sizeof(e), 1, s_idx) != 1) {
+        ESP_LOGW(TAG, "index write failed, closing side file");
+        log_index_file_close();
+    }
+}
+
+bool log_index_file_sync(void)
+{
+    if (!s_idx) {
+        return true;
+    }
+    return fflush(s_idx) == 0 && fsync(fileno(s_idx)) == 0;
+}
+
+// ---------------- 读取侧 ----------------
+
+static inline void io_take(SemaphoreHandle_t lock)
+{
+    if (lock) {
+        xSemaphoreTake(lock, portMAX_DELAY);
+    }
+}
+
+static inline void io_give(SemaphoreHandle_t lock)
+{
+    if (lock) {
+        xSemaphoreGive(lock);
+    }
+}
+
+static FILE *index_open_read(const char *log_path, index_file_hdr_t *hdr)
+{
+    char path[72];
+    index_path_for(log_path, path, sizeof(path));
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return NULL;
+    }
+    if (fread(hdr, sizeof(*hdr), 1, f) != 1 ||
+        hdr->magic[0] != INDEX_MAGIC0 || hdr->magic[1] != INDEX_MAGIC1 || hdr->magic[2] != INDEX_MAGIC2 ||
+        hdr->entry_size < sizeof(app_sdcard_index_entry_t)) {
+        fclose(f);
+        return NULL;
+    }
+    return f;
+}
+
+// 读下一条；掉电留下的半条当作结尾
+static bool index_next(FILE *f, const index_file_hdr_t *hdr, app_sdcard_index_entry_t *e)
+{
+    if (fread(e, sizeof(*e), 1, f) != 1) {
+        return false;
+    }
+    if (hdr->entry_size > sizeof(*e)) {
+        fseek(f, hdr->entry_size - sizeof(*e), SEEK_CUR);
+    }
+    return true;
+}
+
+esp_err_t log_index_read_entries(const char *log_path, app_sdcard_index_cb_t cb, void *ctx,
+                                 SemaphoreHandle_t io_lock)
+{
+    if (!log_path || !cb) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    index_file_hdr_t hdr;
+    io_take(io_lock);
+    FILE *f = index_open_read(log_path, &hdr);
+    io_give(io_lock);
+    if (!f) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    esp_err_t err = ESP_OK;
+    while (1) {
+        app_sdcard_index_entry_t e;
+        io_take(io_lock);
+        bool have = index_next(f, &hdr, &e);
+        // 读着读着拔卡：报错，别当成读完了
+        bool io_err = !have && ferror(f);
+        io_give(io_lock);
+        if (io_err) {
+            err = ESP_FAIL;
+        }
+        if (!have || !cb(&e, ctx)) {
+            break;
+        }
+    }
+    io_take(io_lock);
+    fclose(f);
+    io_give(io_lock);
+    return err;
+}
+
+// 由 .idx 算出要扫的字节范围 [start, end)；end == 0 表示到文件尾。没有 .idx 就全扫
+static void index_find_span(const char *log_path, int64_t from_ms, int64_t to_ms,
+                            uint32_t *start, uint32_t *end, SemaphoreHandle_t io_lock)
+{
+    *start = 0;
+    *end = 0;
+    index_file_hdr_t hdr;
+    io_take(io_lock);
+    FILE *f = index_open_read(log_path, &hdr);
+    if (!f) {
+        io_give(io_lock);
+        return;
+    }
+
+    bool found = false;
+    bool last_is_final = false;
+    uint32_t tail = 0;      // 最后一个 INDEX 块之后：还没有条目的区间从这里开始
+    app_sdcard_index_entry_t e;
+    while (index_next(f, &hdr, &e)) {
+        tail = e.next_offset;
+        last_is_final = false;
+        // 跨开机的 flash 段可能让时间不单调，所以整表扫一遍
+        if ((int64_t)e.t_end_ms >= from_ms && (int64_t)e.t_start_ms <= to_ms) {
+            if (!found) {
+                *start = e.data_offset;
+                found = true;
+            }
+            *end = e.next_offset;
+            last_is_final = true;
+        }
+    }
+    fclose(f);
+    io_give(io_lock);
+
+    if (!found) {
+        *start = tail;
+        *end = 0;
+    } else if (last_is_final) {
+        *end = 0;       // 末尾那个还没写条目的区间也可能落在范围里
+    }
+}
+
+// timestamp_ms 是第 3 列
+static bool row_timestamp(const char *row, size_t len, int64_t *out)
+{
+    const char *p = row;
+    const char *end = row + len;
+    for (int commas = 0; commas < 2; ++p) {
+        if (p >= end) {
+            return false;
+        }
+        if (*p == ',') {
+            commas++;
+        }
+    }
+    char *stop = NULL;
+    long long v = strtoll(p, &stop, 10);
+    if (stop == p || stop > end) {
+        return false;
+    }
+    *out = v;
+    return true;
+}
+
+esp_err_t log_index_read_range(const char *log_path, int64_t from_ms, int64_t to_ms,
+                               app_sdcard_row_cb_t cb, void *ctx, SemaphoreHandle_t io_lock)
+{
+    if (!log_path || !cb || to_ms < from_ms) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    uint32_t start, end;
+    index_find_span(log_path, from_ms, to_ms, &start, &end, io_lock);
+
+    const size_t stored_cap = LOG_LZ4_BOUND(LOG_JOURNAL_RAW_MAX);
+    uint8_t *stored = heap_caps_malloc(stored_cap + LOG_JOURNAL_RAW_MAX, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!stored) {
+        stored = malloc(stored_cap + LOG_JOURNAL_RAW_MAX);
+    }
+    if (!stored) {
+        return ESP_ERR_NO_MEM;
+    }
+    uint8_t *raw = stored + stored_cap;
+
+    io_take(io_lock);
+    FILE *f = fopen(log_path, "rb");
+    bool seek_ok = f && fseek(f, (long)start, SEEK_SET) == 0;
+    io_give(io_lock);
+    if (!seek_ok) {
+        if (f) {
+            fclose(f);
+        }
+        free(stored);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    esp_err_t err = ESP_OK;
+    bool stop = false;
+    long pos = (long)start;
+    while (!stop && (end == 0 || pos < (long)end)) {
+        log_journal_hdr_t hdr;
+        io_take(io_lock);
+        bool have = fread(&hdr, sizeof(hdr), 1, f) == 1;
+        bool body_ok = have && log_journal_hdr_ok(&hdr) &&
+                       fread(stored, 1, hdr.stored_len, f) == hdr.stored_len;
+        bool io_err = ferror(f) != 0;
+        io_give(io_lock);
+        if (io_err) {
+            ESP_LOGW(TAG, "%s: read error @%ld, card removed?", log_path, pos);
+            err = ESP_FAIL;
+            break;
+        }
+        if (!have) {
+            break;
+        }
+        if (!body_ok || !log_journal_crc_ok(&hdr, stored)) {
+            ESP_LOGW(TAG, "%s: bad block @%ld, stop", log_path, pos);
+            err = ESP_ERR_INVALID_CRC;
+            break;
+        }
+        pos += (long)(sizeof(hdr) + hdr.stored_len);
+        if (hdr.flags & LOG_JOURNAL_FLAG_NOSEQ) {
+            continue;
+        }
+
+        const uint8_t *rows = stored;
+        size_t rows_len = hdr.stored_len;
+        if (hdr.flags & LOG_JOURNAL_FLAG_LZ4) {
+            int n = log_lz4_decompress(stored, hdr.stored_len, raw, LOG_JOURNAL_RAW_MAX);
+            if (n != hdr.raw_len) {
+                err = ESP_ERR_INVALID_CRC;
+                break;
+            }
+            rows = raw;
+            rows_len = (size_t)n;
+        }
+
+        const char *p = (const char *)rows;
+        const char *pend = p + rows_len;
+        while (p < pend) {
+            const char *nl = memchr(p, '\n', (size_t)(pend - p));
+            size_t len = nl ? (size_t)(nl - p) + 1 : (size_t)(pend - p);
+            int64_t ts;
+            if (row_timestamp(p, len, &ts) && ts >= from_ms && ts <= to_ms) {
+                if (!cb(p, len, ctx)) {
+                    stop = true;
+                    break;
+                }
+            }
+            p += len;
+        }
+    }
+
+    io_take(io_lock);
+    fclose(f);
+    io_give(io_lock);
+    free(stored);
+    return err;
+}
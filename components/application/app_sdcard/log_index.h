@@ -0,0 +1,60 @@
+#ifndef LOG_INDEX_H
+#define LOG_INDEX_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include "app_sdcard.h"
+#include "log_journal.h"
+
+// 稀疏时间索引。logger 每个区间结束时把摘要作为 INDEX 块写进日志流，
+// 块落到 SD 文件时再往同名 .idx 旁路文件追加一条带字节偏移的条目，读取时据此 seek。
+#define LOG_INDEX_INTERVAL_MS   ((uint32_t)CONFIG_JOFTMODE_SD_INDEX_INTERVAL_S * 1000u)
+#define LOG_INDEX_FILE_EXT      "idx"
+
+// ---- logger 侧：按区间累计 ----
+typedef struct {
+    bool active;
+    uint32_t t_start_ms;
+    uint32_t t_end_ms;
+    int32_t utc_sod;
+    uint32_t records;
+    uint32_t gps_records;
+    uint32_t acc_min;
+    uint32_t acc_max;
+    uint64_t acc_sum;
+    uint32_t spd_min;
+    uint32_t spd_max;
+    uint64_t spd_sum;
+} log_index_acc_t;
+
+void log_index_acc_add(log_index_acc_t *acc, uint32_t t_ms,
+                       int16_t ax, int16_t ay, int16_t az,
+                       bool gps_valid, float speed_mps, const char *utc_time);
+// 当前区间已满 LOG_INDEX_INTERVAL_MS（t_ms 这一行应归入下一个区间）
+bool log_index_acc_due(const log_index_acc_t *acc, uint32_t t_ms);
+// 生成条目并清空累计
+void log_index_acc_finish(log_index_acc_t *acc, app_sdcard_index_entry_t *out);
+
+// ---- SD 落盘侧：维护 .idx 旁路文件（调用方持锁） ----
+esp_err_t log_index_file_open(const char *log_path, uint32_t data_start);
+void log_index_file_close(void);
+// 每个块写进日志文件之后调用；payload 可能分两段。end_offset 为该块之后的文件偏移
+void log_index_file_on_block(const log_journal_hdr_t *hdr,
+                             const uint8_t *p1, size_t n1,
+                             const uint8_t *p2, size_t n2,
+                             uint32_t end_offset);
+bool log_index_file_sync(void);
+
+// ---- 读取侧（io_lock 可为 NULL；每读一块持一次锁，FILE 跨锁存活，调用方须保证读完前不卸载） ----
+esp_err_t log_index_read_entries(const char *log_path, app_sdcard_index_cb_t cb, void *ctx,
+                                 SemaphoreHandle_t io_lock);
+esp_err_t log_index_read_range(const char *log_path, int64_t from_ms, int64_t to_ms,
+                               app_sdcard_row_cb_t cb, void *ctx, SemaphoreHandle_t io_lock);
+
+#endif /* LOG_INDEX_H */
@@ -0,0 +1,302 @@
+#include <errno.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/unistd.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+
+#include "log_journal.h"
+#if CONFIG_JOFTMODE_SD_COMPRESS
+#include "log_lz4.h"
+#endif
+
+#define COMPRESS_REPORT_EVERY_BLOCKS 64
+
+#if CONFIG_JOFTMODE_SD_COMPRESS
+#define BLOCK_STORED_MAX    LOG_LZ4_BOUND(LOG_JOURNAL_RAW_MAX)
+#else
+#define BLOCK_STORED_MAX    LOG_JOURNAL_RAW_MAX
+#endif
+// 残块最多一个，所以最后一个完整块一定落在文件尾部两块的范围内
+#define RECOVER_WINDOW      (2 * (sizeof(log_journal_hdr_t) + BLOCK_STORED_MAX))
+
+static const char *TAG = "log_journal";
+
+static log_journal_sink_t s_sink = NULL;
+static void *s_sink_ctx = NULL;
+static uint32_t s_seq = 0;
+static uint8_t s_raw[LOG_JOURNAL_RAW_MAX];
+static size_t s_raw_len = 0;
+static uint16_t s_raw_records = 0;
+#if CONFIG_JOFTMODE_SD_COMPRESS
+static uint8_t s_lz4_out[LOG_LZ4_BOUND(LOG_JOURNAL_RAW_MAX)];
+static uint16_t s_lz4_table[LOG_LZ4_TABLE_SIZE];
+#endif
+static app_sdcard_compress_stats_t s_cstats;
+
+static uint32_t crc32_update(uint32_t crc, const uint8_t *p, size_t n)
+{
+    static const uint32_t tbl[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+    };
+    crc = ~crc;
+    while (n--) {
+        crc ^= *p++;
+        crc = (crc >> 4) ^ tbl[crc & 0x0F];
+        crc = (crc >> 4) ^ tbl[crc & 0x0F];
+    }
+    return ~crc;
+}
+
+static uint32_t block_crc(const log_journal_hdr_t *hdr, const uint8_t *payload)
+{
+    uint32_t crc = crc32_update(0, (const uint8_t *)hdr, offsetof(log_journal_hdr_t, crc32));
+    return crc32_update(crc, payload, hdr->stored_len);
+}
+
+bool log_journal_hdr_ok(const log_journal_hdr_t *hdr)
+{
+    return hdr->magic[0] == LOG_JOURNAL_MAGIC0 && hdr->magic[1] == LOG_JOURNAL_MAGIC1 &&
+           hdr->version == LOG_JOURNAL_VERSION && hdr->raw_len != 0 &&
+           hdr->raw_len <= LOG_JOURNAL_RAW_MAX && hdr->stored_len <= BLOCK_STORED_MAX;
+}
+
+bool log_journal_crc_ok(const log_journal_hdr_t *hdr, const uint8_t *payload)
+{
+    return block_crc(hdr, payload) == hdr->crc32;
+}
+
+void log_journal_begin(uint32_t first_seq, log_journal_sink_t sink, void *ctx)
+{
+    s_sink = sink;
+    s_sink_ctx = ctx;
+    s_seq = first_seq;
+    s_raw_len = 0;
+    s_raw_records = 0;
+    memset(&s_cstats, 0, sizeof(s_cstats));
+}
+
+uint32_t log_journal_next_seq(void)
+{
+    return s_seq;
+}
+
+bool log_journal_seal(void)
+{
+    if (!s_sink || s_raw_len == 0) {
+        return true;
+    }
+
+    log_journal_hdr_t hdr = {
+        .magic = {LOG_JOURNAL_MAGIC0, LOG_JOURNAL_MAGIC1},
+        .version = LOG_JOURNAL_VERSION,
+        .flags = 0,
+        .seq = s_seq,
+        .raw_len = (uint16_t)s_raw_len,
+        .stored_len = (uint16_t)s_raw_len,
+    };
+    const uint8_t *payload = s_raw;
+
+#if CONFIG_JOFTMODE_SD_COMPRESS
+    int64_t t0 = esp_timer_get_time();
+    int n = log_lz4_compress(s_raw, s_raw_len, s_lz4_out, sizeof(s_lz4_out), s_lz4_table);
+    uint32_t cost_us = (uint32_t)(esp_timer_get_time() - t0);
+    if (n > 0 && (size_t)n < s_raw_len) {
+        hdr.flags = LOG_JOURNAL_FLAG_LZ4;
+        hdr.stored_len = (uint16_t)n;
+        payload = s_lz4_out;
+    }
+#endif
+    hdr.crc32 = block_crc(&hdr, payload);
+
+    bool ok = s_sink(&hdr, payload, s_raw_records, s_sink_ctx);
+    if (!ok) {
+        ESP_LOGW(TAG, "block %" PRIu32 " (%u records) not stored", s_seq, (unsigned)s_raw_records);
+    }
+    s_seq++;
+    s_raw_len = 0;
+    s_raw_records = 0;
+
+    s_cstats.blocks++;
+    s_cstats.raw_bytes += hdr.raw_len;
+    s_cstats.stored_bytes += sizeof(hdr) + hdr.stored_len;
+    s_cstats.last_ratio_x100 = (uint32_t)((hdr.raw_len * 100u) / (sizeof(hdr) + hdr.stored_len));
+#if CONFIG_JOFTMODE_SD_COMPRESS
+    s_cstats.last_compress_us = cost_us;
+    if (cost_us > s_cstats.max_compress_us) {
+        s_cstats.max_compress_us = cost_us;
+    }
+    s_cstats.total_compress_us += cost_us;
+
+    if ((s_cstats.blocks % COMPRESS_REPORT_EVERY_BLOCKS) == 0) {
+        ESP_LOGI(TAG, "lz4 blocks=%" PRIu32 " ratio=%.2f (last %.2f) cpu avg=%" PRIu32 "us max=%" PRIu32 "us",
+                 s_cstats.blocks,
+                 (double)s_cstats.raw_bytes / (double)s_cstats.stored_bytes,
+                 s_cstats.last_ratio_x100 / 100.0,
+                 (uint32_t)(s_cstats.total_compress_us / s_cstats.blocks),
+                 s_cstats.max_compress_us);
+    }
+#endif
+    return ok;
+}
+
+bool log_journal_append(const void *data, size_t len)
+{
+    if (!s_sink || !data || len > sizeof(s_raw)) {
+        return false;
+    }
+    bool ok = true;
+    if (s_raw_len + len > sizeof(s_raw)) {
+        ok = log_journal_seal();
+    }
+    memcpy(s_raw + s_raw_len, data, len);
+    s_raw_len += len;
+    s_raw_records++;
+    return ok;
+}
+
+static void make_noseq_hdr(log_journal_hdr_t *hdr, uint8_t flags, const void *data, size_t len)
+{
+    *hdr = (log_journal_hdr_t){
+        .magic = {LOG_JOURNAL_MAGIC0, LOG_JOURNAL_MAGIC1},
+        .version = LOG_JOURNAL_VERSION,
+        .flags = flags,
+        .seq = s_seq,
+        .raw_len = (uint16_t)len,
+        .stored_len = (uint16_t)len,
+    };
+    hdr->crc32 = block_crc(hdr, data);
+}
+
+bool log_journal_append_index(const void *data, size_t len)
+{
+    if (!s_sink || !data || len == 0 || len > LOG_JOURNAL_RAW_MAX) {
+        return false;
+    }
+    bool ok = log_journal_seal();
+    log_journal_hdr_t hdr;
+    make_noseq_hdr(&hdr, LOG_JOURNAL_FLAG_INDEX, data, len);
+    return s_sink(&hdr, data, 0, s_sink_ctx) && ok;
+}
+
+bool log_journal_write_meta(FILE *f, const void *data, size_t len)
+{
+    if (!f || !data || len == 0 || len > LOG_JOURNAL_RAW_MAX) {
+        return false;
+    }
+    log_journal_hdr_t hdr;
+    make_noseq_hdr(&hdr, LOG_JOURNAL_FLAG_META, data, len);
+    bool ok = fwrite(&hdr, sizeof(hdr), 1, f) == 1 &&
+              fwrite(data, 1, len, f) == len;
+    if (!ok) {
+        int e = errno;
+        ESP_LOGE(TAG, "meta block write failed: errno=%d (%s)", e, strerror(e));
+    }
+    return ok;
+}
+
+void log_journal_get_compress_stats(app_sdcard_compress_stats_t *out)
+{
+    if (out) {
+        *out = s_cstats;
+    }
+}
+
+// 在 buf[pos] 处尝试解析一个完整、CRC 正确的块；成功返回块总长度，否则 0
+static size_t block_valid_at(const uint8_t *buf, size_t buf_len, size_t pos, uint32_t *out_next_seq)
+{
+    if (pos + sizeof(log_journal_hdr_t) > buf_len) {
+        return 0;
+    }
+    log_journal_hdr_t hdr;
+    memcpy(&hdr, buf + pos, sizeof(hdr));
+    if (!log_journal_hdr_ok(&hdr)) {
+        return 0;
+    }
+    size_t total = sizeof(hdr) + hdr.stored_len;
+    if (pos + total > buf_len) {
+        return 0;
+    }
+    if (!log_journal_crc_ok(&hdr, buf + pos + sizeof(hdr))) {
+        return 0;
+    }
+    *out_next_seq = (hdr.flags & LOG_JOURNAL_FLAG_NOSEQ) ? hdr.seq : hdr.seq + 1;
+    return total;
+}
+
+esp_err_t log_journal_recover(const char *path, uint32_t *out_next_seq, size_t *out_dropped)
+{
+    if (out_dropped) {
+        *out_dropped = 0;
+    }
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (fseek(f, 0, SEEK_END) != 0) {
+        fclose(f);
+        return ESP_FAIL;
+    }
+    long size = ftell(f);
+    if (size <= 0) {
+        fclose(f);
+        return ESP_OK;
+    }
+
+    size_t window = ((size_t)size < RECOVER_WINDOW) ? (size_t)size : RECOVER_WINDOW;
+    size_t base = (size_t)size - window;
+    uint8_t *buf = malloc(window);
+    if (!buf) {
+        fclose(f);
+        return ESP_ERR_NO_MEM;
+    }
+    bool read_ok = fseek(f, (long)base, SEEK_SET) == 0 && fread(buf, 1, window, f) == window;
+    fclose(f);
+    if (!read_ok) {
+        free(buf);
+        return ESP_FAIL;
+    }
+
+    // 从尾部往前找：第一个命中的完整块就是最后一个有效块
+    size_t valid_end = 0;
+    bool found = false;
+    uint32_t next_seq = 0;
+    if (window >= sizeof(log_journal_hdr_t)) {
+        for (size_t pos = window - sizeof(log_journal_hdr_t) + 1; pos-- > 0;) {
+            size_t len = block_valid_at(buf, window, pos, &next_seq);
+            if (len) {
+                valid_end = base + pos + len;
+                found = true;
+                break;
+            }
+        }
+    }
+    free(buf);
+
+    if (!found) {
+        if (base != 0) {
+            ESP_LOGW(TAG, "%s: no valid block in last %u bytes, left untouched", path, (unsigned)window);
+            return ESP_ERR_INVALID_STATE;
+        }
+        valid_end = 0;   // 整个文件都是残块（例如只写了半个头）
+    } else if (out_next_seq) {
+        *out_next_seq = next_seq;
+    }
+
+    if (valid_end < (size_t)size) {
+        if (truncate(path, (off_t)valid_end) != 0) {
+            int e = errno;
+            ESP_LOGE(TAG, "truncate %s failed: errno=%d (%s)", path, e, strerror(e));
+            return ESP_FAIL;
+        }
+        if (out_dropped) {
+            *out_dropped = (size_t)size - valid_end;
+        }
+        ESP_LOGW(TAG, "%s: dropped %u byte torn tail", path, (unsigned)((size_t)size - valid_end));
+    }
+    return ESP_OK;
+}
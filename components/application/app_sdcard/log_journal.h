@@ -0,0 +1,64 @@
+#ifndef LOG_JOURNAL_H
+#define LOG_JOURNAL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "esp_err.h"
+
+#include "app_sdcard.h"
+
+// 日志文件 = 连续的 journal 块。每块独立可解（LZ4 字典不跨块），带全局递增序号和 CRC32。
+// 掉电时最多留下一个写了一半的尾块，开机扫描尾部即可截掉。主机侧解码见 tools/log_decode.py。
+#define LOG_JOURNAL_MAGIC0      'J'
+#define LOG_JOURNAL_MAGIC1      'B'
+#define LOG_JOURNAL_VERSION     2
+#define LOG_JOURNAL_FLAG_LZ4    0x01
+#define LOG_JOURNAL_FLAG_META   0x02
+#define LOG_JOURNAL_FLAG_INDEX  0x04
+// 不占序号的块：seq 字段记的是下一个数据块的序号
+#define LOG_JOURNAL_FLAG_NOSEQ  (LOG_JOURNAL_FLAG_META | LOG_JOURNAL_FLAG_INDEX)
+#define LOG_JOURNAL_RAW_MAX     4096
+
+typedef struct __attribute__((packed)) {
+    uint8_t  magic[2];
+    uint8_t  version;
+    uint8_t  flags;       // bit0: payload 为 LZ4 块；否则原样存储。bit1: 元数据块（CSV 表头）。bit2: 时间索引条目
+    uint32_t seq;         // 全局递增（跨文件延续），主机侧可发现缺块；META 块不占序号，记下一个数据块的序号
+    uint16_t raw_len;     // 解压后字节数
+    uint16_t stored_len;  // 紧随其后的 payload 字节数
+    uint32_t crc32;       // IEEE CRC32（同 zlib），覆盖上面 12 字节 + payload
+} log_journal_hdr_t;
+
+// 封好的块交给 sink（写文件或暂存到 backlog）；records 为块内记录条数
+typedef bool (*log_journal_sink_t)(const log_journal_hdr_t *hdr, const uint8_t *payload,
+                                   uint16_t records, void *ctx);
+
+// 清空待写块并设置输出；first_seq 为下一块的序号
+void log_journal_begin(uint32_t first_seq, log_journal_sink_t sink, void *ctx);
+// 追加一条记录（不会被拆到两个块里），块满时自动封块
+bool log_journal_append(const void *data, size_t len);
+// 把当前未满的块立即封块交给 sink（不做 fflush/fsync）
+bool log_journal_seal(void);
+uint32_t log_journal_next_seq(void);
+// 直接往 f 写一个 META 块（不压缩、不占序号），用于每个新文件开头的表头
+bool log_journal_write_meta(FILE *f, const void *data, size_t len);
+// 先封掉当前数据块，再经 sink 发出一个 INDEX 块（不压缩、不占序号）。
+// 这样相邻两个 INDEX 块之间正好是一个索引区间的全部数据块
+bool log_journal_append_index(const void *data, size_t len);
+void log_journal_get_compress_stats(app_sdcard_compress_stats_t *out);
+
+// 读取侧校验：块头字段是否合法 / payload 的 CRC 是否匹配
+bool log_journal_hdr_ok(const log_journal_hdr_t *hdr);
+bool log_journal_crc_ok(const log_journal_hdr_t *hdr, const uint8_t *payload);
+
+/**
+ * 开机恢复：从文件尾向前找最后一个 CRC 正确的完整块，截掉其后的残块。
+ * @param out_next_seq 若找到有效块，返回下一个数据块的序号（否则不修改）
+ * @param out_dropped  被截掉的字节数
+ */
+esp_err_t log_journal_recover(const char *path, uint32_t *out_next_seq, size_t *out_dropped);
+
+#endif /* LOG_JOURNAL_H */
@@ -0,0 +1,191 @@
+#include <string.h>
+
+#include "log_lz4.h"
+
+#define LZ4_MINMATCH      4
+#define LZ4_LASTLITERALS  5    // 块尾至少 5 字节必须是字面量
+#define LZ4_MFLIMIT       12   // 最后一个 match 必须在块尾 12 字节之前开始
+#define LZ4_MAX_OFFSET    65535
+
+static inline uint32_t read32(const uint8_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t hash4(uint32_t v)
+{
+    return (v * 2654435761u) >> (32 - LOG_LZ4_HASH_LOG);
+}
+
+static uint8_t *put_length(uint8_t *op, size_t len)
+{
+    while (len >= 255) {
+        *op++ = 255;
+        len -= 255;
+    }
+    *op++ = (uint8_t)len;
+    return op;
+}
+
+// 写出一个 sequence：token + 字面量 + (offset + match 长度)。match_len == 0 表示块尾的纯字面量。
+static uint8_t *emit_sequence(uint8_t *op, const uint8_t *oend,
+                              const uint8_t *lit, size_t lit_len,
+                              size_t offset, size_t match_len)
+{
+    size_t ml = match_len ? match_len - LZ4_MINMATCH : 0;
+    size_t need = 1 + lit_len + (lit_len / 255) + 1;
+    if (match_len) {
+        need += 2 + (ml / 255) + 1;
+    }
+    if ((size_t)(oend - op) < need) {
+        return NULL;
+    }
+
+    uint8_t *token = op++;
+    *token = (uint8_t)(((lit_len >= 15) ? 15 : lit_len) << 4);
+    if (lit_len >= 15) {
+        op = put_length(op, lit_len - 15);
+    }
+    memcpy(op, lit, lit_len);
+    op += lit_len;
+
+    if (match_len) {
+        *token |= (uint8_t)((ml >= 15) ? 15 : ml);
+        *op++ = (uint8_t)(offset & 0xFF);
+        *op++ = (uint8_t)(offset >> 8);
+        if (ml >= 15) {
+            op = put_length(op, ml - 15);
+        }
+    }
+    return op;
+}
+
+int log_lz4_compress(const uint8_t *src, size_t src_len,
+                     uint8_t *dst, size_t dst_cap,
+                     uint16_t *table)
+{
+    if (!src || !dst || !table || src_len > LZ4_MAX_OFFSET) {
+        return -1;
+    }
+
+    const uint8_t *ip = src;
+    const uint8_t *anchor = src;
+    const uint8_t *iend = src + src_len;
+    uint8_t *op = dst;
+    const uint8_t *oend = dst + dst_cap;
+
+    memset(table, 0, LOG_LZ4_TABLE_SIZE * sizeof(table[0]));
+
+    if (src_len > LZ4_MFLIMIT) {
+        const uint8_t *mflimit = iend - LZ4_MFLIMIT;
+        const uint8_t *matchlimit = iend - LZ4_LASTLITERALS;
+
+        ip++;
+        while (ip <= mflimit) {
+            uint32_t seq = read32(ip);
+            uint32_t h = hash4(seq);
+            const uint8_t *ref = src + table[h];
+            table[h] = (uint16_t)(ip - src);
+
+            if (ref >= ip || (size_t)(ip - ref) > LZ4_MAX_OFFSET || read32(ref) != seq) {
+                ip++;
+                continue;
+            }
+
+            // 向后扩展（吃掉与前面字面量重叠的部分），再向前扩展到 matchlimit
+            while (ip > anchor && ref > src && ip[-1] == ref[-1]) {
+                ip--;
+                ref--;
+            }
+            const uint8_t *mp = ip + LZ4_MINMATCH;
+            const uint8_t *rp = ref + LZ4_MINMATCH;
+            while (mp < matchlimit && *mp == *rp) {
+                mp++;
+                rp++;
+            }
+
+            op = emit_sequence(op, oend, anchor, (size_t)(ip - anchor),
+                               (size_t)(ip - ref), (size_t)(mp - ip));
+            if (!op) {
+                return -1;
+            }
+            ip = mp;
+            anchor = ip;
+
+            // 补一个 match 内部位置的 hash，提高下一次命中率
+            if (ip - 2 > src) {
+                table[hash4(read32(ip - 2))] = (uint16_t)(ip - 2 - src);
+            }
+        }
+    }
+
+    op = emit_sequence(op, oend, anchor, (size_t)(iend - anchor), 0, 0);
+    if (!op) {
+        return -1;
+    }
+    return (int)(op - dst);
+}
+
+static int read_length(const uint8_t **ip, const uint8_t *iend, size_t *len)
+{
+    uint8_t b;
+    do {
+        if (*ip >= iend) {
+            return -1;
+        }
+        b = *(*ip)++;
+        *len += b;
+    } while (b == 255);
+    return 0;
+}
+
+int log_lz4_decompress(const uint8_t *src, size_t src_len,
+                       uint8_t *dst, size_t dst_cap)
+{
+    const uint8_t *ip = src;
+    const uint8_t *iend = src + src_len;
+    uint8_t *op = dst;
+    uint8_t *oend = dst + dst_cap;
+
+    while (ip < iend) {
+        uint8_t token = *ip++;
+        size_t lit = token >> 4;
+        if (lit == 15 && read_length(&ip, iend, &lit) != 0) {
+            return -1;
+        }
+        if (lit > (size_t)(iend - ip) || lit > (size_t)(oend - op)) {
+            return -1;
+        }
+        memcpy(op, ip, lit);
+        op += lit;
+        ip += lit;
+        if (ip >= iend) {
+            break;      // 最后一个 sequence 只有字面量
+        }
+
+        if (iend - ip < 2) {
+            return -1;
+        }
+        size_t offset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > (size_t)(op - dst)) {
+            return -1;
+        }
+        size_t ml = token & 0x0F;
+        if (ml == 15 && read_length(&ip, iend, &ml) != 0) {
+            return -1;
+        }
+        ml += LZ4_MINMATCH;
+        if (ml > (size_t)(oend - op)) {
+            return -1;
+        }
+        // match 可能和输出重叠（offset < ml），只能逐字节拷
+        const uint8_t *match = op - offset;
+        while (ml--) {
+            *op++ = *match++;
+        }
+    }
+    return (int)(op - dst);
+}
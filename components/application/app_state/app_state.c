@@ -11,6 +11,10 @@ static app_state_imu_sample_t s_latest_imu;
 static bool s_have_imu = false;
 static GNSS_Data s_latest_gps;
 static bool s_have_gps = false;
+static app_state_logger_stats_t s_logger_stats;
+static bool s_have_logger_stats = false;
+static app_state_activity_segment_t s_activity_seg;
+static uint32_t s_activity_seq = 0;
 
 void app_state_init(void)
 {
@@ -92,3 +96,75 @@ bool app_state_get_latest_gps(GNSS_Data *out_data)
     }
     return have_data;
 }
+
+void app_state_set_logger_stats(const app_state_logger_stats_t *stats)
+{
+    if (!stats) {
+        return;
+    }
+    if (s_state_lock == NULL) {
+        app_state_init();
+    }
+    if (s_state_lock) {
+        xSemaphoreTake(s_state_lock, portMAX_DELAY);
+        s_logger_stats = *stats;
+        s_have_logger_stats = true;
+        xSemaphoreGive(s_state_lock);
+    }
+}
+
+bool app_state_get_logger_stats(app_state_logger_stats_t *out_stats)
+{
+    if (!out_stats) {
+        return false;
+    }
+    if (s_state_lock == NULL) {
+        app_state_init();
+    }
+    bool have_stats = false;
+    if (s_state_lock) {
+        xSemaphoreTake(s_state_lock, portMAX_DELAY);
+        if (s_have_logger_stats) {
+            *out_stats = s_logger_stats;
+            have_stats = true;
+        }
+        xSemaphoreGive(s_state_lock);
+    }
+    return have_stats;
+}
+
+void app_state_push_activity_segment(const app_state_activity_segment_t *seg)
+{
+    if (!seg) {
+        return;
+    }
+    if (s_state_lock == NULL) {
+        app_state_init();
+    }
+    if (s_state_lock) {
+        xSemaphoreTake(s_state_lock, portMAX_DELAY);
+        s_activity_seg = *seg;
+        s_activity_seg.seq = ++s_activity_seq;
+        xSemaphoreGive(s_state_lock);
+    }
+}
+
+bool app_state_get_activity_segment(app_state_activity_segment_t *out_seg)
+{
+    if (!out_seg) {
+        return false;
+    }
+    if (s_state_lock == NULL) {
+        app_state_init();
+    }
+    bool have_seg = false;
+    if (s_state_lock) {
+        xSemaphoreTake(s_state_lock, portMAX_DELAY);
+        if (s_activity_seq > 0) {
+            *out_seg = s_activity_seg;
+            have_seg = true;
+        }
+        xSemaphoreGive(s_state_lock);
+    }
+    return have_seg;
+}
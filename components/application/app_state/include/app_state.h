@@ -20,6 +20,31 @@ typedef struct {
     int64_t timestamp_us;
 } app_state_imu_sample_t;
 
+typedef struct {
+    bool card_present;          // 当前有卡且日志文件可写
+    uint32_t remounts;          // 启动后重新挂载成功的次数
+    uint32_t write_errors;      // 写/同步失败（按拔卡处理）的次数
+    uint32_t backlog_bytes;     // PSRAM 暂存中的字节数
+    uint32_t backlog_capacity;
+    uint32_t backlog_blocks;
+    uint32_t dropped_blocks;    // 暂存溢出丢弃的块
+    uint32_t dropped_records;   // 对应丢弃的 CSV 行数
+    uint32_t records_logged;    // 已落盘（SD 或内部 flash）的 CSV 行数
+    uint8_t backend;            // app_sdcard_backend_t
+    uint32_t flash_bytes;       // 内部 flash 上待搬到 SD 的字节数
+    uint32_t flash_capacity;
+    uint32_t flash_dropped_segments;
+} app_state_logger_stats_t;
+
+// 最近结束的一段活动（ML 平滑后），seq 每段加一，读者据此判断有没有新段
+typedef struct {
+    uint32_t seq;
+    uint32_t start_ms;          // 开机后毫秒
+    uint32_t end_ms;
+    uint8_t label;              // ml_activity_t
+    float confidence;           // 段内平均置信度
+} app_state_activity_segment_t;
+
 void app_state_init(void);
 
 void app_state_set_imu_sample(const app_state_imu_sample_t *sample);
@@ -28,6 +53,13 @@ bool app_state_get_latest_imu(app_state_imu_sample_t *out_sample);
 void app_state_set_gps_data(const GNSS_Data *data);
 bool app_state_get_latest_gps(GNSS_Data *out_data);
 
+void app_state_set_logger_stats(const app_state_logger_stats_t *stats);
+bool app_state_get_logger_stats(app_state_logger_stats_t *out_stats);
+
+// seq 由 app_state 分配
+void app_state_push_activity_segment(const app_state_activity_segment_t *seg);
+bool app_state_get_activity_segment(app_state_activity_segment_t *out_seg);
+
 #ifdef __cplusplus
 }
 #endif
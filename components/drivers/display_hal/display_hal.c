@@ -1,9 +1,12 @@
 // components/display/display_hal.c
 #include "display_hal.h"
 
+#include <math.h>
 #include <string.h>
+#include "sdkconfig.h"
 #include "esp_log.h"
 #include "esp_check.h"
+#include "esp_timer.h"
 #include "driver/gpio.h"
 #include "driver/spi_master.h"
 #include "driver/i2c.h"
@@ -22,8 +25,14 @@ static const char *TAG = "display_hal";
 #define LCD_H_RES         466
 #define LCD_V_RES         466
 
-// ====== 像素格式（SH8601 选 RGB888）======
+// ====== 像素格式（Kconfig 选 RGB565 / RGB888，COLMOD 跟着变）======
+#if CONFIG_JOFTMODE_DISPLAY_RGB565
+#define LCD_BIT_PER_PIXEL 16
+#define LCD_COLMOD        0x55
+#else
 #define LCD_BIT_PER_PIXEL 24
+#define LCD_COLMOD        0x77
+#endif
 
 // ====== QSPI 引脚（确保与 SD 卡不冲突）======
 #define LCD_HOST          SPI3_HOST
@@ -42,9 +51,19 @@ static const char *TAG = "display_hal";
 // QSPI clock for panel IO (Hz). Try 60MHz first, back off if unstable.
 #define LCD_QSPI_PCLK_HZ  (60 * 1000 * 1000)
 
+// TE：标称 60 Hz；两次 TE 间隔不在这个范围里（漏了边沿、刚开屏）就不拿来更新周期
+#define LCD_TE_PERIOD_US      16667
+#define LCD_TE_PERIOD_MIN_US  8000
+#define LCD_TE_PERIOD_MAX_US  40000
+#define LCD_TE_STALE_US       100000
+
+// 圆屏：每行可见的列范围（像素和直径 466 的圆有交集就算），init 时算好
+static uint16_t s_row_x1[LCD_V_RES];
+static uint16_t s_row_x2[LCD_V_RES];
+
 
 // ====== SH8601 初始化命令表 ======
-// 0x77: 像素格式；0x55 => RGB888（与 bits_per_pixel=24 对应），给 SH8601 面板的初始化命令表，包括像素格式、显示区域、开屏指令等。
+// 0x3A: 像素格式；0x55 => RGB565，0x77 => RGB888（与 LCD_BIT_PER_PIXEL 对应），给 SH8601 面板的初始化命令表，包括像素格式、显示区域、开屏指令等。
 static const sh8601_lcd_init_cmd_t lcd_init_cmds[] = {
     {0xFE, (uint8_t[]){0x20}, 1, 0},
     {0xF4, (uint8_t[]){0x5A}, 1, 0},
@@ -54,7 +73,7 @@ static const sh8601_lcd_init_cmd_t lcd_init_cmds[] = {
     {0x1C, (uint8_t[]){0xA0}, 1, 0},
     {0xFE, (uint8_t[]){0x00}, 1, 0},
     {0xC4, (uint8_t[]){0x80}, 1, 0},
-    {0x3A, (uint8_t[]){0x77}, 1, 0},
+    {0x3A, (uint8_t[]){LCD_COLMOD}, 1, 0},
     {0x36, (uint8_t[]){0x08}, 1, 0},
     {0x35, (uint8_t[]){0x00}, 1, 0},
     {0x53, (uint8_t[]){0x20}, 1, 0},
@@ -67,23 +86,39 @@ static const sh8601_lcd_init_cmd_t lcd_init_cmds[] = {
 };
 
 // ---- 传输完成回调（中断上下文）---- DMA 传输完成中断回调，释放 trans_done 信号量，告诉上层“本次传输结束”。
-static bool on_color_trans_done(esp_lcd_panel_io_handle_t io,
+// SPI 中断默认放 IRAM（CONFIG_SPI_MASTER_ISR_IN_IRAM），flash 缓存关闭时也会进来，这里和 on_trans_done 都要在 IRAM
+static bool IRAM_ATTR on_color_trans_done(esp_lcd_panel_io_handle_t io,
                                 esp_lcd_panel_io_event_data_t *edata,
                                 void *user_ctx)
 {
     display_hal_t *hal = (display_hal_t *)user_ctx;
     BaseType_t hp_woken = pdFALSE;
+    bool cb_woken = false;
+    if (hal && hal->on_trans_done) {
+        cb_woken = hal->on_trans_done(hal->trans_done_ctx);
+    }
     if (hal && hal->trans_done) {
         xSemaphoreGiveFromISR(hal->trans_done, &hp_woken);
     }
-    return hp_woken == pdTRUE;
+    return cb_woken || hp_woken == pdTRUE;
 }
 // TE 引脚中断服务函数，释放 te_sema，用于“等到屏幕刷新时机再画”。
+// 同时记下时间戳、平滑刷新周期（1/8 权重），上层据此估算面板当前扫到哪一行
 static void IRAM_ATTR on_te_isr(void *arg)
 {
     display_hal_t *hal = (display_hal_t *)arg;
     BaseType_t hp_woken = pdFALSE;
-    if (hal && hal->te_sema) {
+    if (!hal) {
+        return;
+    }
+    int64_t now = esp_timer_get_time();
+    int64_t dt = now - hal->te_last_us;
+    if (hal->te_count > 0 && dt >= LCD_TE_PERIOD_MIN_US && dt <= LCD_TE_PERIOD_MAX_US) {
+        hal->te_period_us = (uint32_t)((int64_t)hal->te_period_us + (dt - (int64_t)hal->te_period_us) / 8);
+    }
+    hal->te_last_us = now;
+    hal->te_count++;
+    if (hal->te_sema) {
         xSemaphoreGiveFromISR(hal->te_sema, &hp_woken);
     }
     if (hp_woken == pdTRUE) {
@@ -91,6 +126,34 @@ static void IRAM_ATTR on_te_isr(void *arg)
     }
 }
 
+static void init_row_spans(void)
+{
+    const float r = LCD_H_RES / 2.0f;
+    for (int y = 0; y < LCD_V_RES; ++y) {
+        float dy = fabsf(y + 0.5f - LCD_V_RES / 2.0f) - 0.5f;   // 该行离圆心最近的那条边
+        float half = sqrtf(r * r - dy * dy);
+        int x1 = (int)floorf(r - half);
+        int x2 = (int)ceilf(r + half) - 1;
+        s_row_x1[y] = (uint16_t)(x1 < 0 ? 0 : x1);
+        s_row_x2[y] = (uint16_t)(x2 > LCD_H_RES - 1 ? LCD_H_RES - 1 : x2);
+    }
+}
+
+bool display_hal_visible_span(int y1, int y2, int *x1, int *x2)
+{
+    if (y1 < 0) y1 = 0;
+    if (y2 > LCD_V_RES - 1) y2 = LCD_V_RES - 1;
+    if (y1 > y2) return false;
+    // 行越靠近中线越宽，区间里最宽的是离中线最近的那一行
+    int mid = LCD_V_RES / 2;
+    int y = (y2 < mid) ? y2 : (y1 > mid ? y1 : mid);
+    int a = s_row_x1[y];
+    int b = s_row_x2[y];
+    if (x1) *x1 = a & ~1;   // SH8601 要求列起点偶数、宽度偶数
+    if (x2) *x2 = b | 1;
+    return true;
+}
+
 esp_err_t display_hal_init(display_hal_t *out)//完整硬件初始化流程
 {
     ESP_RETURN_ON_FALSE(out, ESP_ERR_INVALID_ARG, TAG, "out is NULL");
@@ -157,6 +220,10 @@ esp_err_t display_hal_init(display_hal_t *out)//完整硬件初始化流程
     out->panel   = panel;
     out->hor_res = LCD_H_RES;
     out->ver_res = LCD_V_RES;
+    out->bits_per_pixel = LCD_BIT_PER_PIXEL;
+    out->qspi_bytes_per_ms = LCD_QSPI_PCLK_HZ / 2 / 1000;     // 4 线，2 个时钟一字节
+    out->te_period_us = LCD_TE_PERIOD_US;
+    init_row_spans();
 
 
 
@@ -207,10 +274,37 @@ esp_err_t display_hal_init(display_hal_t *out)//完整硬件初始化流程
     }
 #endif
 
-    ESP_LOGI(TAG, "Display OK, %dx%d", out->hor_res, out->ver_res);
+    ESP_LOGI(TAG, "Display OK, %dx%d, %d bpp", out->hor_res, out->ver_res, out->bits_per_pixel);
     return ESP_OK;
 }
 
+void display_hal_set_trans_done_cb(display_hal_t *hal, display_hal_trans_done_cb_t cb, void *ctx)
+{
+    if (!hal) return;
+    hal->trans_done_ctx = ctx;
+    hal->on_trans_done = cb;
+}
+
+bool display_hal_te_timing(const display_hal_t *hal, int64_t *last_us, uint32_t *period_us, uint32_t *count)
+{
+    if (!hal || hal->te_count == 0) return false;
+    // 64 位时间戳不是原子读：前后计数一致才算读到同一次 TE 的数据
+    uint32_t n;
+    int64_t last;
+    uint32_t period;
+    do {
+        n = hal->te_count;
+        last = hal->te_last_us;
+        period = hal->te_period_us;
+    } while (n != hal->te_count);
+
+    if (esp_timer_get_time() - last > LCD_TE_STALE_US) return false;
+    if (last_us) *last_us = last;
+    if (period_us) *period_us = period;
+    if (count) *count = n;
+    return true;
+}
+
 // ---- 阻塞等待一次 DMA 完成（配合 on_color_trans_done）----
 static esp_err_t wait_flush(display_hal_t *hal, uint32_t timeout_ms)
 {
@@ -227,11 +321,16 @@ esp_err_t display_hal_test_once(display_hal_t *hal)
     if (!hal || !hal->panel) return ESP_ERR_INVALID_STATE;
 
     // 1) 整屏纯色（深绿）
-    static uint8_t line[LCD_H_RES * 3]; // RGB888
+    static uint8_t line[LCD_H_RES * (LCD_BIT_PER_PIXEL / 8)];
     for (int x = 0; x < LCD_H_RES; ++x) {
+#if LCD_BIT_PER_PIXEL == 16
+        line[2*x+0] = 0x03; // RGB565 0x0300（G=0x60），高字节在前
+        line[2*x+1] = 0x00;
+#else
         line[3*x+0] = 0x00; // R
         line[3*x+1] = 0x60; // G
         line[3*x+2] = 0x00; // B
+#endif
     }
     for (int y = 0; y < LCD_V_RES; ++y) {
         esp_err_t e = esp_lcd_panel_draw_bitmap(hal->panel, 0, y, LCD_H_RES, y+1, line);
@@ -1,4 +1,5 @@
 #pragma once
+#include <stdbool.h>
 #include <stdint.h>
 #include "esp_err.h"
 #include "esp_lcd_panel_ops.h"
@@ -6,19 +7,41 @@
 #include "freertos/semphr.h"
 
 
+// DMA 传输完成时额外调用（中断上下文，不要阻塞；要用 IRAM_ATTR，只碰 IRAM / DRAM 里的东西）。
+// 返回 true 表示唤醒了更高优先级的任务
+typedef bool (*display_hal_trans_done_cb_t)(void *ctx);
+
 typedef struct {
     esp_lcd_panel_handle_t     panel;      // 由 esp_lcd_new_panel_sh8601() 产生 LCD 面板句柄（esp_lcd 面板驱动对象）。
     esp_lcd_panel_io_handle_t  io;         // IO 句柄（new_panel_io_spi 后得到） ， QSPI IO 句柄（用来跟屏幕通信）。
     SemaphoreHandle_t          trans_done; // DMA 传输完成信号量 ， DMA 传输完成信号（用于同步刷新完成）。
     SemaphoreHandle_t          te_sema;    // TE semaphore TE 同步信号（屏的撕裂同步中断）。
+    display_hal_trans_done_cb_t on_trans_done; // 可选，见 display_hal_set_trans_done_cb
+    void                      *trans_done_ctx;
+
+    // TE 时序（中断里更新）：最近一次 TE 的时间、平滑后的刷新周期、TE 计数
+    volatile int64_t           te_last_us;
+    volatile uint32_t          te_period_us;
+    volatile uint32_t          te_count;
 
     uint16_t                   hor_res;//屏幕分辨率
     uint16_t                   ver_res;//屏幕分辨率
+    uint8_t                    bits_per_pixel; // 16（RGB565）或 24（RGB888），见 JOFTMODE_DISPLAY_COLOR
+    uint32_t                   qspi_bytes_per_ms; // QSPI 线速率（不含命令开销），估算传输时间用
 } display_hal_t;
 
 // 初始化 SH8601（QSPI），点亮屏并返回 panel 句柄与分辨率
 esp_err_t display_hal_init(display_hal_t *out);
 
+// 设置传输完成回调（init 之后、开始刷屏之前调用）；trans_done 信号量照常释放
+void display_hal_set_trans_done_cb(display_hal_t *hal, display_hal_trans_done_cb_t cb, void *ctx);
+
+// 圆屏第 y1..y2 行（含）可见像素的列范围（含），已按 2 像素对齐。行号越界返回 false
+bool display_hal_visible_span(int y1, int y2, int *x1, int *x2);
+
+// 读一份一致的 TE 时序。还没收到过 TE、或最近一次 TE 已过去超过 100 ms（熄屏、TE 没接）返回 false
+bool display_hal_te_timing(const display_hal_t *hal, int64_t *last_us, uint32_t *period_us, uint32_t *count);
+
 // Optional: draw a simple test pattern (full-screen fill + 5 white lines)
 esp_err_t display_hal_test_once(display_hal_t *hal);
 
@@ -0,0 +1,74 @@
+// components/ml/include/ml_pkg.h
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 模型包：头 + tflite，放在 "model" 分区里，用 esp_partition_mmap 直接映射（不拷贝）。
+// 由 tools/mkmodelpkg.py 生成，parttool.py 烧写，或开机时从 SD 卡上的 model.pkg 更新
+#define ML_PKG_MAGIC        "JMPK"
+#define ML_PKG_FORMAT       1
+#define ML_PKG_PARTITION    "model"
+#define ML_PKG_SUBTYPE      0x40
+#define ML_PKG_UPDATE_FILE  "model.pkg"
+
+#define ML_PKG_MAX_CH       16
+#define ML_PKG_MAX_LABELS   8
+#define ML_PKG_LABEL_LEN    16
+
+// 小端，字段都是自然对齐的（无填充，292 字节），布局与 mkmodelpkg.py 一致
+typedef struct {
+    char     magic[4];
+    uint16_t format;
+    uint16_t header_size;
+    uint32_t total_size;        // 头 + 模型
+    uint32_t crc32;             // 覆盖 version 起到 total_size 为止
+    uint32_t version;
+    uint32_t model_offset;      // 16 字节对齐
+    uint32_t model_size;
+    uint16_t window;            // 帧数 T
+    uint16_t channels;          // 通道数 C
+    uint16_t hop;               // 0 = 用 Kconfig 的 JOFTMODE_ML_HOP_FRAMES
+    uint16_t n_labels;
+    float    mu[ML_PKG_MAX_CH];
+    float    sigma[ML_PKG_MAX_CH];
+    char     labels[ML_PKG_MAX_LABELS][ML_PKG_LABEL_LEN];
+} ml_pkg_header_t;
+
+typedef struct {
+    uint32_t       version;
+    const uint8_t* model;       // 指向映射后的 flash
+    uint32_t       model_size;
+    uint16_t       window;
+    uint16_t       channels;
+    uint16_t       hop;
+    uint16_t       n_labels;
+    const float*   mu;
+    const float*   sigma;
+    const char   (*labels)[ML_PKG_LABEL_LEN];
+    bool           from_partition;
+} ml_pkg_t;
+
+/**
+ * 映射并校验 "model" 分区里的模型包。
+ * @return ESP_ERR_NOT_FOUND 没有分区；ESP_ERR_INVALID_VERSION/INVALID_SIZE/INVALID_CRC 包无效
+ */
+esp_err_t ml_pkg_load(ml_pkg_t* out);
+
+// 按名字找标签下标，没有返回 -1
+int ml_pkg_label_index(const ml_pkg_t* pkg, const char* name);
+
+/**
+ * 把文件里的模型包写进分区（先整包校验，头最后写，掉电只会留下无效包）。
+ * 与分区里已有的包 version 和 CRC 都相同时不写。分区已被映射（模型在用）时返回 ESP_ERR_INVALID_STATE，
+ * 所以要在 ml_init 之前调用。
+ */
+esp_err_t ml_pkg_update_from_file(const char* path);
+
+#ifdef __cplusplus
+}
+#endif
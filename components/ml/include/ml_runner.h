@@ -1,5 +1,6 @@
 #pragma once
 #include <stdbool.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -7,8 +8,26 @@ extern "C" {
 
 
 bool ml_init(void);  
+// 模型包里建议的 hop（0 = 没指定）和版本号（内置模型为 0），ml_init 成功后有效
+int ml_model_hop(void);
+uint32_t ml_model_version(void);
+// tensor arena：实际用量 / 预留大小 / 是否在 PSRAM
+bool ml_get_arena_info(uint32_t* used, uint32_t* reserved, bool* in_psram);
+// 打印 / 清零按算子统计的耗时（JOFTMODE_ML_PROFILE 关闭时为空操作）
+void ml_profile_dump(void);
+void ml_profile_reset(void);
 bool ml_infer(const float window_75x8[75][8],
               int* out_pred, float* out_p_walk, float* out_p_ebike);
+
+// 每通道量化系数：q = clamp(round(x*sA + sB), -128, 127)，ml_init 成功后有效
+bool ml_get_input_quant(float out_sA[8], float out_sB[8]);
+// 已量化窗口（75x8 int8，时间从旧到新）直接拷进输入张量推理
+bool ml_infer_q(const int8_t window_q[75 * 8],
+                int* out_pred, float* out_p_walk, float* out_p_ebike);
+// 同 ml_infer_q，end_frame 为窗口最后一帧的绝对帧号（逐窗口递增），
+// 开了 JOFTMODE_ML_STREAMING 时复用与上一个窗口重叠部分的卷积结果
+bool ml_infer_stream(const int8_t window_q[75 * 8], uint32_t end_frame,
+                     int* out_pred, float* out_p_walk, float* out_p_ebike);
               
 
 #ifdef __cplusplus
@@ -0,0 +1,55 @@
+// components/ml/include/ml_smooth.h
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "ml_window.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 两状态（walk/ebike）HMM 前向滤波 + 段去抖。每个窗口结果 O(1)，不分配内存
+typedef struct {
+    float         p_stay[2];        // 每个结果保持原状态的概率：[walk], [ebike]
+    uint32_t      min_seg_ms;
+    float         post_ebike;       // 前向滤波后验 P(ebike)
+    ml_activity_t inst;             // 逐结果的 walk/ebike（后验带回差）
+    bool          started;
+    // 当前段
+    ml_activity_t cur;
+    uint32_t      cur_start_ms;
+    uint32_t      cur_last_ms;
+    float         cur_conf_sum;
+    uint32_t      cur_n;
+    // 候选的新标签：持续 min_seg_ms 才切段，切点回溯到候选开始的时刻
+    ml_activity_t pend;
+    uint32_t      pend_start_ms;
+    float         pend_conf_sum;    // 按候选标签算的置信度
+    float         pend_cur_sum;     // 同一批结果按当前标签算的置信度（候选作废时并回当前段）
+    uint32_t      pend_n;
+    bool          back;             // 候选期间又回到了当前标签
+    uint32_t      back_since_ms;
+} ml_smooth_t;
+
+/**
+ * @param w2e_permille  每个结果 walk→ebike 的转移概率（‰），越小越不容易切换
+ * @param e2w_permille  ebike→walk
+ * @param min_seg_ms    新标签至少持续这么久才结束当前段
+ */
+void ml_smooth_init(ml_smooth_t* s, uint32_t w2e_permille, uint32_t e2w_permille, uint32_t min_seg_ms);
+
+/**
+ * 输入一个窗口结果（门控结果也算），更新平滑后验和段。
+ * @param out_label / out_conf  平滑、去抖后的当前标签及其后验（可为 NULL）
+ * @return true 表示有一段刚结束，内容在 out_seg
+ */
+bool ml_smooth_update(ml_smooth_t* s, const ml_result_t* r, uint32_t t_ms,
+                      ml_activity_t* out_label, float* out_conf, ml_segment_t* out_seg);
+
+// 还没结束的当前段，没有返回 false
+bool ml_smooth_current(const ml_smooth_t* s, ml_segment_t* out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,25 +1,99 @@
 // components/ml/include/ml_window.h
 #pragma once
 #include <stdbool.h>
+#include <stdint.h>
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+// 结果来源：模型推理，或是窗口统计量直接判定、没跑模型（见 JOFTMODE_ML_GATE）
+typedef enum {
+    ML_GATE_NONE = 0,   // 模型推理
+    ML_GATE_STILL,      // 静止：加速度 / 陀螺仪几乎没有波动
+    ML_GATE_SLOW,       // GPS 速度整窗都低，排除电动车
+} ml_gate_t;
+
+// 平滑、去抖后的活动标签（见 ml_smooth.h）
+typedef enum {
+    ML_ACT_UNKNOWN = 0,
+    ML_ACT_WALK,
+    ML_ACT_EBIKE,
+    ML_ACT_STILL,
+} ml_activity_t;
+
+const char* ml_activity_name(ml_activity_t a);
+
+typedef struct {
+    uint32_t      start_ms;     // 时间同 esp_timer（开机后毫秒）
+    uint32_t      end_ms;
+    ml_activity_t label;
+    float         confidence;   // 段内该标签平滑后验的均值
+    uint32_t      results;      // 段内的窗口结果数
+} ml_segment_t;
+
 typedef struct {
-    int   pred;     // 0=walk, 1=ebike
+    int   pred;     // 0=walk, 1=ebike（门控结果固定为 walk，p_walk=1），单窗口的原始判定
     float p_walk;
     float p_ebike;
+    ml_gate_t gate;
+    ml_activity_t activity;     // 平滑后的当前活动
+    float confidence;           // activity 的平滑后验
 } ml_result_t;
 
+// 一段活动结束时调用（在发布结果的线程里：ML 任务或 logger），不要阻塞
+typedef void (*ml_segment_cb_t)(const ml_segment_t* seg);
+
+typedef struct {
+    uint32_t windows;           // 送去推理的窗口数（每 hop 帧一个）
+    uint32_t skipped_windows;   // 推理没跟上、被更新窗口顶掉的
+    uint32_t inferences;        // 成功完成的推理
+    uint32_t failures;
+    uint32_t last_latency_us;   // 单次 ml_infer 耗时
+    uint32_t max_latency_us;
+    uint64_t total_latency_us;
+    uint32_t last_prep_us;      // 取窗口（int8 环 memcpy）的耗时，不含 Invoke
+    uint32_t max_prep_us;
+    uint64_t total_prep_us;     // 除以 windows 得平均
+    uint32_t gated_windows;     // 被门控直接判定、没送推理的窗口（也计入 windows）
+    uint64_t gate_saved_us;     // 按当时的平均推理耗时估算省下的时间
+    // 重采样：输入样本的间隔抖动，和输出到 25 Hz 网格上的帧
+    uint32_t in_samples;        // 送进来的样本
+    uint32_t in_dup;            // 时间戳没前进、丢掉的
+    uint32_t in_gaps;           // 间隔超过 JOFTMODE_ML_RESAMPLE_MAX_GAP_MS、窗口重新攒的
+    uint32_t in_intervals;      // 参与下面统计的正常间隔数
+    uint32_t in_dt_min_us;
+    uint32_t in_dt_max_us;
+    uint64_t in_jitter_us;      // Σ|dt − 40 ms|，除以 in_intervals 得平均抖动
+    uint32_t frames;            // 插值输出的帧
+} ml_stats_t;
+
 bool ml_window_init(void);
+// 清空窗口、门控、平滑状态和最近结果（不动模型和统计），换一段不连续的数据时用。
+// 调用方保证期间没有 push
+void ml_window_reset(void);
 
-void ml_window_push_sample_raw(int ax, int ay, int az,
+/**
+ * 送一个 IMU 样本。内部按 t_us 插值到 25 Hz 网格上再进窗口，调用节奏不用对齐。
+ * @param t_us    样本的采集时间（esp_timer 微秒），不是调用时刻；和上一个相同的样本会被丢掉
+ * @param fix_ms  这次 GPS 定位的 UTC 时刻（当天毫秒，见 ml_gnss_time_ms），未知给 -1。
+ *                转向角速度按相邻两次定位的时刻差求导
+ */
+void ml_window_push_sample_raw(int64_t t_us,
+                               int ax, int ay, int az,
                                int gx, int gy, int gz,
                                bool has_gps,
                                float speed_mps,
-                               float course_deg_now);
+                               float course_deg_now,
+                               int32_t fix_ms);
+
+// NMEA 的 hhmmss.ss 转成当天毫秒，格式不对返回 -1
+int32_t ml_gnss_time_ms(const char* hhmmss);
 
 bool ml_get_latest_result(ml_result_t* out);
+void ml_window_set_segment_cb(ml_segment_cb_t cb);
+// 还没结束的当前活动段
+bool ml_get_current_segment(ml_segment_t* out);
+bool ml_get_stats(ml_stats_t* out);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,239 @@
+// components/ml/ml_pkg.c —— 模型包：分区映射、校验、从文件更新
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+
+#include "ml_pkg.h"
+
+#define PKG_IO_CHUNK    4096
+#define PKG_SECTOR      4096    // flash 擦除粒度
+#define PKG_CRC_START   offsetof(ml_pkg_header_t, version)
+
+_Static_assert(sizeof(ml_pkg_header_t) == 292, "ml_pkg_header_t layout must match tools/mkmodelpkg.py");
+
+static const char *TAG = "ml_pkg";
+
+static esp_partition_mmap_handle_t s_map;
+static bool s_mapped = false;
+
+static const esp_partition_t *find_partition(void)
+{
+    return esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ML_PKG_SUBTYPE, ML_PKG_PARTITION);
+}
+
+static esp_err_t header_check(const ml_pkg_header_t *h, size_t part_size)
+{
+    if (memcmp(h->magic, ML_PKG_MAGIC, 4) != 0) {
+        return ESP_ERR_NOT_FOUND;   // 分区是空的（全 0xFF）或没写完
+    }
+    if (h->format != ML_PKG_FORMAT || h->header_size < sizeof(ml_pkg_header_t)) {
+        ESP_LOGE(TAG, "unsupported package format %u (header %u)", h->format, h->header_size);
+        return ESP_ERR_INVALID_VERSION;
+    }
+    if (h->total_size > part_size || h->model_offset < h->header_size || (h->model_offset & 15) != 0 ||
+        h->model_size == 0 || h->model_offset + h->model_size > h->total_size) {
+        ESP_LOGE(TAG, "bad package layout: total=%" PRIu32 " model=%" PRIu32 "+%" PRIu32 " partition=%u",
+                 h->total_size, h->model_offset, h->model_size, (unsigned)part_size);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (h->window == 0 || h->channels == 0 || h->channels > ML_PKG_MAX_CH ||
+        h->n_labels == 0 || h->n_labels > ML_PKG_MAX_LABELS) {
+        ESP_LOGE(TAG, "bad package shape: T=%u C=%u labels=%u", h->window, h->channels, h->n_labels);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    for (int c = 0; c < h->channels; ++c) {
+        if (!(h->sigma[c] > 0.0f)) {
+            ESP_LOGE(TAG, "sigma[%d] must be > 0", c);
+            return ESP_ERR_INVALID_SIZE;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t ml_pkg_load(ml_pkg_t *out)
+{
+    if (!out) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    const esp_partition_t *part = find_partition();
+    if (!part) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    ml_pkg_header_t hdr;
+    esp_err_t err = esp_partition_read(part, 0, &hdr, sizeof(hdr));
+    if (err != ESP_OK) {
+        return err;
+    }
+    err = header_check(&hdr, part->size);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    if (s_mapped) {
+        esp_partition_munmap(s_map);
+        s_mapped = false;
+    }
+    const void *base = NULL;
+    err = esp_partition_mmap(part, 0, hdr.total_size, ESP_PARTITION_MMAP_DATA, &base, &s_map);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "mmap failed: %s", esp_err_to_name(err));
+        return err;
+    }
+    s_mapped = true;
+
+    const uint8_t *p = (const uint8_t *)base;
+    uint32_t crc = esp_rom_crc32_le(0, p + PKG_CRC_START, hdr.total_size - PKG_CRC_START);
+    if (crc != hdr.crc32) {
+        ESP_LOGE(TAG, "package CRC mismatch: %08" PRIx32 " != %08" PRIx32, crc, hdr.crc32);
+        esp_partition_munmap(s_map);
+        s_mapped = false;
+        return ESP_ERR_INVALID_CRC;
+    }
+
+    const ml_pkg_header_t *h = (const ml_pkg_header_t *)p;
+    out->version = h->version;
+    out->model = p + h->model_offset;
+    out->model_size = h->model_size;
+    out->window = h->window;
+    out->channels = h->channels;
+    out->hop = h->hop;
+    out->n_labels = h->n_labels;
+    out->mu = h->mu;
+    out->sigma = h->sigma;
+    out->labels = h->labels;
+    out->from_partition = true;
+    ESP_LOGI(TAG, "model package v%" PRIu32 ": %" PRIu32 " byte model, T=%u C=%u hop=%u",
+             h->version, h->model_size, h->window, h->channels, h->hop);
+    return ESP_OK;
+}
+
+int ml_pkg_label_index(const ml_pkg_t *pkg, const char *name)
+{
+    if (!pkg || !name) {
+        return -1;
+    }
+    for (int i = 0; i < pkg->n_labels; ++i) {
+        if (strncmp(pkg->labels[i], name, ML_PKG_LABEL_LEN) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// 文件从 start 起 n 字节的 CRC
+static bool file_crc(FILE *f, uint8_t *buf, uint32_t start, uint32_t n, uint32_t *out)
+{
+    if (fseek(f, (long)start, SEEK_SET) != 0) {
+        return false;
+    }
+    uint32_t crc = 0;
+    while (n > 0) {
+        size_t k = n < PKG_IO_CHUNK ? n : PKG_IO_CHUNK;
+        if (fread(buf, 1, k, f) != k) {
+            return false;
+        }
+        crc = esp_rom_crc32_le(crc, buf, k);
+        n -= k;
+    }
+    *out = crc;
+    return true;
+}
+
+static bool partition_crc(const esp_partition_t *part, uint8_t *buf, uint32_t start, uint32_t n, uint32_t *out)
+{
+    uint32_t crc = 0;
+    while (n > 0) {
+        size_t k = n < PKG_IO_CHUNK ? n : PKG_IO_CHUNK;
+        if (esp_partition_read(part, start, buf, k) != ESP_OK) {
+            return false;
+        }
+        crc = esp_rom_crc32_le(crc, buf, k);
+        start += k;
+        n -= k;
+    }
+    *out = crc;
+    return true;
+}
+
+static esp_err_t install_from_file(const esp_partition_t *part, FILE *f, uint8_t *buf, const char *path)
+{
+    ml_pkg_header_t hdr;
+    uint32_t crc = 0;
+    if (fread(&hdr, 1, sizeof(hdr), f) != sizeof(hdr)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    esp_err_t err = header_check(&hdr, part->size);
+    if (err != ESP_OK) {
+        return (err == ESP_ERR_NOT_FOUND) ? ESP_ERR_INVALID_VERSION : err;   // 文件不是模型包
+    }
+    if (!file_crc(f, buf, PKG_CRC_START, hdr.total_size - PKG_CRC_START, &crc) || crc != hdr.crc32) {
+        ESP_LOGE(TAG, "%s: CRC mismatch or short file", path);
+        return ESP_ERR_INVALID_CRC;
+    }
+
+    // 和分区里的一样就不写（省 flash 擦写）
+    ml_pkg_header_t cur;
+    if (esp_partition_read(part, 0, &cur, sizeof(cur)) == ESP_OK && header_check(&cur, part->size) == ESP_OK &&
+        cur.version == hdr.version && cur.crc32 == hdr.crc32) {
+        ESP_LOGI(TAG, "package v%" PRIu32 " already installed", hdr.version);
+        return ESP_OK;
+    }
+
+    uint32_t erase = (hdr.total_size + PKG_SECTOR - 1) / PKG_SECTOR * PKG_SECTOR;
+    err = esp_partition_erase_range(part, 0, erase);
+    if (err != ESP_OK) {
+        return err;
+    }
+    // magic 留到最后写：中途掉电的分区读出来是空包
+    if (fseek(f, 0, SEEK_SET) != 0) {
+        return ESP_FAIL;
+    }
+    for (uint32_t off = 0; off < hdr.total_size;) {
+        size_t k = hdr.total_size - off < PKG_IO_CHUNK ? hdr.total_size - off : PKG_IO_CHUNK;
+        if (fread(buf, 1, k, f) != k) {
+            return ESP_FAIL;
+        }
+        size_t skip = (off == 0) ? sizeof(hdr.magic) : 0;
+        err = esp_partition_write(part, off + skip, buf + skip, k - skip);
+        if (err != ESP_OK) {
+            return err;
+        }
+        off += k;
+    }
+    if (!partition_crc(part, buf, PKG_CRC_START, hdr.total_size - PKG_CRC_START, &crc) || crc != hdr.crc32) {
+        ESP_LOGE(TAG, "verify after write failed");
+        return ESP_ERR_INVALID_CRC;
+    }
+    err = esp_partition_write(part, 0, hdr.magic, sizeof(hdr.magic));
+    if (err == ESP_OK) {
+        ESP_LOGW(TAG, "installed model package v%" PRIu32 " (%" PRIu32 " bytes) from %s",
+                 hdr.version, hdr.total_size, path);
+    }
+    return err;
+}
+
+esp_err_t ml_pkg_update_from_file(const char *path)
+{
+    if (s_mapped) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    const esp_partition_t *part = find_partition();
+    if (!part) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    uint8_t *buf = malloc(PKG_IO_CHUNK);
+    esp_err_t err = buf ? install_from_file(part, f, buf, path) : ESP_ERR_NO_MEM;
+    free(buf);
+    fclose(f);
+    return err;
+}
@@ -5,25 +5,50 @@
 #include <cstddef>
 #include <cmath>
 #include <inttypes.h>  // 修正 ESP_LOG* 的 PRI 宏
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include <new>
+#include "esp_heap_caps.h"
+#include "sdkconfig.h"
 
 // 用可变解析器 + 手动注册需要的算子
 #include "tensorflow/lite/micro/micro_mutable_op_resolver.h"
 #include "tensorflow/lite/micro/kernels/micro_ops.h"
 #include "tensorflow/lite/micro/micro_interpreter.h"
 #include "tensorflow/lite/schema/schema_generated.h"
+#include "esp_timer.h"
+#if CONFIG_JOFTMODE_ML_PROFILE
+#include "tensorflow/lite/micro/micro_profiler_interface.h"
+#include "esp_cpu.h"
+#include "esp_rom_sys.h"
+#include "freertos/FreeRTOS.h"
+#endif
+#if CONFIG_JOFTMODE_ML_STREAMING
+#include "tensorflow/lite/kernels/internal/quantization_util.h"
+#include "tensorflow/lite/schema/schema_utils.h"
+#include "ml_stream.h"
+#endif
 
-// 由 tools/bin2cc.py 生成（model_data.cc）
-extern const unsigned char g_model[];   // 只声明数组，不声明长度，避免链接问题
+#include "ml_pkg.h"
+#include "ml_runner.h"
+
+#if CONFIG_JOFTMODE_ML_BUILTIN_MODEL
+// 由 tools/bin2cc.py 生成（model_data.cc），分区里没有有效模型包时用
+#include "model/model_data.h"
+#endif
 
 namespace {
 
 constexpr const char* TAG = "ml_runner";
 
-// ===== 输入形状（deploy_params.json）=====
+// ===== 输入形状：窗口缓冲是按它静态分配的，模型包必须一致 =====
 constexpr int kT = 75;   // 时间长度（帧数）
 constexpr int kC = 8;    // 通道数
 
-// ===== 训练时的标准化参数（deploy_params.json）=====
+#if CONFIG_JOFTMODE_ML_BUILTIN_MODEL
+// ===== 内置模型的标准化参数（deploy_params.json）=====
 // 顺序：acc_x, acc_y, acc_z, gyro_x, gyro_y, gyro_z, speed_mps, turn_rate_deg_s
 static const float kMu[kC] = {
     1593.7335205078125f, 2013.6827392578125f,  832.3717041015625f,
@@ -36,8 +61,13 @@ static const float kSigma[kC] = {
        2.258960008621216f,   44.726905822753906f
 };
 
-// 标签映射：{"walk":0, "ebike":1}
-enum : int { LABEL_WALK = 0, LABEL_EBIKE = 1 };
+static const char kLabels[][ML_PKG_LABEL_LEN] = {"walk", "ebike"};
+#endif
+
+// 标签下标按名字从模型包里查
+static int s_label_walk  = 0;
+static int s_label_ebike = 1;
+static ml_pkg_t s_pkg;
 
 // —— TFLM 对象 —— //
 static tflite::MicroMutableOpResolver<8> s_resolver;  // 8 个足够
@@ -45,8 +75,138 @@ static const tflite::Model*      s_model        = nullptr;
 static tflite::MicroInterpreter* s_interpreter  = nullptr;
 static bool                      s_ready        = false;   // 分配成功后才置 true
 
-// Arena：先给 160KB（不够可以再加）
-alignas(16) static uint8_t s_tensor_arena[160 * 1024];
+// Arena：从堆上按 Kconfig 的位置分配。先按 JOFTMODE_ML_ARENA_KB 试建，
+// 开了 AUTOSIZE 再按 arena_used_bytes() 缩到实际用量 + 余量
+// JOFTMODE_ML_ARENA_KB 依赖 JOFTMODE_ENABLE_ML，没开 ML 时不存在，但本组件照样编译
+#ifdef CONFIG_JOFTMODE_ML_ARENA_KB
+#define ML_ARENA_KB         CONFIG_JOFTMODE_ML_ARENA_KB
+#else
+#define ML_ARENA_KB         64
+#endif
+#define ML_ARENA_BYTES      ((size_t)ML_ARENA_KB * 1024)
+#define ML_ARENA_MARGIN     1024
+#define ML_ARENA_BENCH_RUNS 50
+#if CONFIG_JOFTMODE_ML_ARENA_PSRAM
+#define ML_ARENA_CAPS       (MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT)
+#else
+#define ML_ARENA_CAPS       (MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT)
+#endif
+
+static uint8_t* s_arena      = nullptr;
+static size_t   s_arena_size = 0;
+static uint32_t s_arena_caps = 0;
+static size_t   s_arena_used = 0;
+static bool     s_ops_added  = false;
+alignas(tflite::MicroInterpreter) static uint8_t s_interp_mem[sizeof(tflite::MicroInterpreter)];
+
+#if CONFIG_JOFTMODE_ML_PROFILE
+// 按算子名累计 CPU 周期。TFLM 每个算子 Invoke 前后各调一次 Begin/End（tag 是算子名常量）；
+// 流式路径不经过解释器，用 "ML_STREAM" 记一整次
+class OpProfiler : public tflite::MicroProfilerInterface {
+public:
+    uint32_t BeginEvent(const char* tag) override
+    {
+        if (depth_ >= kMaxDepth) return kMaxDepth;
+        open_[depth_].slot = find_slot(tag);
+        open_[depth_].start = esp_cpu_get_cycle_count();
+        return (uint32_t)depth_++;
+    }
+
+    void EndEvent(uint32_t handle) override
+    {
+        if (handle >= (uint32_t)depth_) return;
+        uint32_t dt = (uint32_t)esp_cpu_get_cycle_count() - open_[handle].start;
+        int i = open_[handle].slot;
+        depth_ = (int)handle;
+        if (i < 0) return;
+        taskENTER_CRITICAL(&mux_);
+        slots_[i].calls++;
+        slots_[i].cycles += dt;
+        if (dt > slots_[i].max) slots_[i].max = dt;
+        taskEXIT_CRITICAL(&mux_);
+    }
+
+    void Reset()
+    {
+        taskENTER_CRITICAL(&mux_);
+        n_ = 0;
+        runs_ = 0;
+        taskEXIT_CRITICAL(&mux_);
+    }
+
+    // 返回本次之后累计的推理次数
+    uint32_t CountRun()
+    {
+        taskENTER_CRITICAL(&mux_);
+        uint32_t r = ++runs_;
+        taskEXIT_CRITICAL(&mux_);
+        return r;
+    }
+
+    void Dump(size_t arena_used, size_t arena_size, bool psram)
+    {
+        Slot snap[kMaxTags];
+        int n;
+        uint32_t runs;
+        taskENTER_CRITICAL(&mux_);
+        n = n_;
+        runs = runs_;
+        memcpy(snap, slots_, sizeof(Slot) * (size_t)n);
+        taskEXIT_CRITICAL(&mux_);
+
+        uint64_t total = 0;
+        for (int i = 0; i < n; ++i) total += snap[i].cycles;
+        const uint32_t per_us = esp_rom_get_cpu_ticks_per_us();
+        ESP_LOGI(TAG, "profile: %" PRIu32 " runs, arena %u/%u bytes (%s)",
+                 runs, (unsigned)arena_used, (unsigned)arena_size, psram ? "PSRAM" : "SRAM");
+        for (int i = 0; i < n; ++i) {
+            uint32_t avg = snap[i].calls ? (uint32_t)(snap[i].cycles / snap[i].calls) : 0;
+            ESP_LOGI(TAG, "  %-16s %8" PRIu32 " calls  avg %8" PRIu32 " cyc %7.1f us  max %8" PRIu32 " cyc  %5.1f%%",
+                     snap[i].tag, snap[i].calls, avg, (double)avg / per_us, snap[i].max,
+                     total ? 100.0 * (double)snap[i].cycles / (double)total : 0.0);
+        }
+    }
+
+private:
+    static constexpr int kMaxTags  = 16;
+    static constexpr int kMaxDepth = 4;
+    struct Slot {
+        const char* tag;
+        uint32_t calls;
+        uint64_t cycles;
+        uint32_t max;
+    };
+    struct Open {
+        int slot;
+        uint32_t start;
+    };
+
+    int find_slot(const char* tag)
+    {
+        for (int i = 0; i < n_; ++i) {
+            if (slots_[i].tag == tag || strcmp(slots_[i].tag, tag) == 0) return i;
+        }
+        if (n_ == kMaxTags) return -1;
+        taskENTER_CRITICAL(&mux_);
+        slots_[n_] = {tag, 0, 0, 0};
+        int i = n_++;
+        taskEXIT_CRITICAL(&mux_);
+        return i;
+    }
+
+    Slot slots_[kMaxTags] = {};
+    int n_ = 0;
+    uint32_t runs_ = 0;
+    Open open_[kMaxDepth] = {};
+    int depth_ = 0;
+    portMUX_TYPE mux_ = portMUX_INITIALIZER_UNLOCKED;
+};
+
+static OpProfiler s_profiler;
+#define ML_PROFILER (&s_profiler)
+#else
+#define ML_PROFILER nullptr
+#endif
 
 // 预计算：q = round(x * sA + sB)
 static float sA[kC];
@@ -56,8 +216,86 @@ static float sB[kC];
 static float s_out_scale = 0.0f;
 static int   s_out_zero  = 0;
 
+#if CONFIG_JOFTMODE_ML_STREAMING
+static bool s_stream_ok = false;    // 模型结构匹配且自检通过
+static bool stream_prepare(void);
+#endif
+
 } // namespace
 
+static void destroy_interpreter(void)
+{
+    if (s_interpreter) {
+        s_interpreter->~MicroInterpreter();
+        s_interpreter = nullptr;
+    }
+    heap_caps_free(s_arena);
+    s_arena = nullptr;
+    s_arena_size = 0;
+}
+
+// 在指定位置分配 size 字节的 arena 并建解释器；PSRAM 分配不到时退回内部 RAM
+static bool build_interpreter(size_t size, uint32_t caps)
+{
+    destroy_interpreter();
+    s_arena = (uint8_t*)heap_caps_aligned_alloc(16, size, caps);
+    if (!s_arena && (caps & MALLOC_CAP_SPIRAM)) {
+        ESP_LOGW(TAG, "no PSRAM for arena, using internal RAM");
+        caps = MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
+        s_arena = (uint8_t*)heap_caps_aligned_alloc(16, size, caps);
+    }
+    if (!s_arena) {
+        ESP_LOGE(TAG, "arena alloc failed (%u bytes)", (unsigned)size);
+        return false;
+    }
+    s_arena_size = size;
+    s_arena_caps = caps;
+
+    s_interpreter = new (s_interp_mem) tflite::MicroInterpreter(
+        s_model, s_resolver, s_arena, size, /*resource_variables=*/nullptr, ML_PROFILER);
+    if (s_interpreter->AllocateTensors() != kTfLiteOk) {
+        ESP_LOGE(TAG, "AllocateTensors failed (arena=%u bytes)", (unsigned)size);
+        destroy_interpreter();
+        return false;
+    }
+#if CONFIG_JOFTMODE_ML_PROFILE
+    s_profiler.Reset();     // 不算 Init/Prepare
+#endif
+    return true;
+}
+
+#if CONFIG_JOFTMODE_ML_ARENA_BENCH
+// 同一个输入分别把 arena 放在内部 RAM 和 PSRAM 里跑，比较单次 Invoke 耗时
+static void arena_bench(size_t size)
+{
+    static const struct { uint32_t caps; const char* name; } kPlaces[] = {
+        {MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT, "SRAM"},
+        {MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT,   "PSRAM"},
+    };
+    for (const auto& pl : kPlaces) {
+        if (heap_caps_get_largest_free_block(pl.caps) < size) {
+            ESP_LOGI(TAG, "arena bench: %s skipped (no %u byte block)", pl.name, (unsigned)size);
+            continue;
+        }
+        if (!build_interpreter(size, pl.caps) || s_arena_caps != pl.caps) {
+            continue;
+        }
+        TfLiteTensor* in = s_interpreter->input(0);
+        for (int i = 0; i < kT * kC; ++i) {
+            in->data.int8[i] = (int8_t)((i * 37) & 0x7f);
+        }
+        s_interpreter->Invoke();    // 首次调用不计（cache 预热）
+        int64_t t0 = esp_timer_get_time();
+        for (int i = 0; i < ML_ARENA_BENCH_RUNS; ++i) {
+            s_interpreter->Invoke();
+        }
+        int64_t dt = esp_timer_get_time() - t0;
+        ESP_LOGI(TAG, "arena bench: %s %u bytes -> %" PRId64 " us/invoke",
+                 pl.name, (unsigned)size, dt / ML_ARENA_BENCH_RUNS);
+    }
+}
+#endif
+
 extern "C" bool ml_init(void)
 /**
  * 初始化 TFLM，并根据输入量化参数 + 训练时 μ/σ，预计算每个通道的量化系数 sA/sB。
@@ -65,7 +303,37 @@ extern "C" bool ml_init(void)
 {
     s_ready = false;
 
-    s_model = tflite::GetModel(g_model);
+    esp_err_t perr = ml_pkg_load(&s_pkg);
+    if (perr != ESP_OK) {
+#if CONFIG_JOFTMODE_ML_BUILTIN_MODEL
+        ESP_LOGW(TAG, "no model package (%s), using built-in model", esp_err_to_name(perr));
+        s_pkg = {};
+        s_pkg.model = g_model;
+        s_pkg.model_size = g_model_len;
+        s_pkg.window = kT;
+        s_pkg.channels = kC;
+        s_pkg.n_labels = 2;
+        s_pkg.mu = kMu;
+        s_pkg.sigma = kSigma;
+        s_pkg.labels = kLabels;
+#else
+        ESP_LOGE(TAG, "no model package: %s", esp_err_to_name(perr));
+        return false;
+#endif
+    }
+    if (s_pkg.window != kT || s_pkg.channels != kC) {
+        ESP_LOGE(TAG, "package window %ux%u, firmware expects %dx%d",
+                 s_pkg.window, s_pkg.channels, kT, kC);
+        return false;
+    }
+    s_label_walk  = ml_pkg_label_index(&s_pkg, "walk");
+    s_label_ebike = ml_pkg_label_index(&s_pkg, "ebike");
+    if (s_label_walk < 0 || s_label_ebike < 0) {
+        ESP_LOGE(TAG, "package labels must include \"walk\" and \"ebike\"");
+        return false;
+    }
+
+    s_model = tflite::GetModel(s_pkg.model);
     if (!s_model) {
         ESP_LOGE(TAG, "GetModel failed");
         return false;
@@ -76,22 +344,37 @@ extern "C" bool ml_init(void)
         return false;
     }
 
-    // 手动注册模型会用到的算子
-    s_resolver.AddConv2D();         // Conv1D 常由 Conv2D(kx1) 表达
-    s_resolver.AddFullyConnected(); // Dense
-    s_resolver.AddReshape();        // 形状调整
-    s_resolver.AddMean();           // GlobalAveragePooling1D -> ReduceMean
-    s_resolver.AddSoftmax();        // 输出层
-    s_resolver.AddExpandDims();     // 
-
-    static tflite::MicroInterpreter static_interpreter(
-        s_model, s_resolver, s_tensor_arena, sizeof(s_tensor_arena), /*error_reporter=*/nullptr);
-    s_interpreter = &static_interpreter;
+    // 手动注册模型会用到的算子（只注册一次，重复 Add 会报错）
+    if (!s_ops_added) {
+        s_resolver.AddConv2D();         // Conv1D 常由 Conv2D(kx1) 表达
+        s_resolver.AddFullyConnected(); // Dense
+        s_resolver.AddReshape();        // 形状调整
+        s_resolver.AddMean();           // GlobalAveragePooling1D -> ReduceMean
+        s_resolver.AddSoftmax();        // 输出层
+        s_resolver.AddExpandDims();     // 
+        s_ops_added = true;
+    }
 
-    if (s_interpreter->AllocateTensors() != kTfLiteOk) {
-        ESP_LOGE(TAG, "AllocateTensors failed (arena=%u bytes)", (unsigned)sizeof(s_tensor_arena));
+    if (!build_interpreter(ML_ARENA_BYTES, ML_ARENA_CAPS)) {
         return false;
     }
+    s_arena_used = s_interpreter->arena_used_bytes();
+    size_t fit = (s_arena_used + ML_ARENA_MARGIN + 15) & ~(size_t)15;
+    size_t final_size = ML_ARENA_BYTES;
+#if CONFIG_JOFTMODE_ML_ARENA_AUTOSIZE
+    if (fit < final_size) final_size = fit;
+#endif
+#if CONFIG_JOFTMODE_ML_ARENA_BENCH
+    arena_bench(fit);
+    destroy_interpreter();      // 按配置的位置重建
+#endif
+    if (s_arena_size != final_size && !build_interpreter(final_size, ML_ARENA_CAPS)) {
+        return false;
+    }
+    ESP_LOGI(TAG, "arena: %u used, %u reserved in %s (JOFTMODE_ML_ARENA_KB=%d, %u KB would fit)",
+             (unsigned)s_arena_used, (unsigned)s_arena_size,
+             (s_arena_caps & MALLOC_CAP_SPIRAM) ? "PSRAM" : "SRAM",
+             ML_ARENA_KB, (unsigned)((fit + 1023) / 1024));
 
     TfLiteTensor* in  = s_interpreter->input(0);
     TfLiteTensor* out = s_interpreter->output(0);
@@ -99,6 +382,11 @@ extern "C" bool ml_init(void)
         ESP_LOGE(TAG, "input/output tensor is null");
         return false;
     }
+    if (in->type != kTfLiteInt8 || in->dims->size != 3 || in->dims->data[1] != kT || in->dims->data[2] != kC ||
+        out->type != kTfLiteInt8 || out->dims->data[out->dims->size - 1] != s_pkg.n_labels) {
+        ESP_LOGE(TAG, "model tensors do not match package (T=%d C=%d labels=%u)", kT, kC, s_pkg.n_labels);
+        return false;
+    }
 
     // 读取输入/输出张量的量化参数
     const float in_scale      = in->params.scale;
@@ -108,17 +396,94 @@ extern "C" bool ml_init(void)
 
     // 预计算：q = round( x*(1/(σ*in_scale)) + (in_zero - μ/(σ*in_scale)) )
     for (int ch = 0; ch < kC; ++ch) {
-        float inv = 1.0f / (kSigma[ch] * in_scale);
+        float inv = 1.0f / (s_pkg.sigma[ch] * in_scale);
         sA[ch] = inv;
-        sB[ch] = in_zero_point - kMu[ch] * inv;
+        sB[ch] = in_zero_point - s_pkg.mu[ch] * inv;
     }
 
     s_ready = true;
     ESP_LOGI(TAG, "TFLM ready. in_scale=%.7f in_zp=%d  out_scale=%.7f out_zp=%d",
              in_scale, in_zero_point, s_out_scale, s_out_zero);
+#if CONFIG_JOFTMODE_ML_STREAMING
+    s_stream_ok = stream_prepare();
+#endif
+    ml_profile_reset();     // 自检 / bench 的推理不算
     return true;
 }
 
+extern "C" bool ml_get_arena_info(uint32_t* used, uint32_t* reserved, bool* in_psram)
+{
+    if (!s_ready) return false;
+    if (used)     *used     = (uint32_t)s_arena_used;
+    if (reserved) *reserved = (uint32_t)s_arena_size;
+    if (in_psram) *in_psram = (s_arena_caps & MALLOC_CAP_SPIRAM) != 0;
+    return true;
+}
+
+extern "C" int ml_model_hop(void)
+{
+    return s_ready ? s_pkg.hop : 0;
+}
+
+extern "C" uint32_t ml_model_version(void)
+{
+    return s_ready ? s_pkg.version : 0;
+}
+
+extern "C" bool ml_get_input_quant(float out_sA[kC], float out_sB[kC])
+/**
+ * 取每通道的量化系数（q = round(x*sA + sB)），供调用方在写入窗口时就量化好。
+ */
+{
+    if (!s_ready || !out_sA || !out_sB) return false;
+    for (int ch = 0; ch < kC; ++ch) {
+        out_sA[ch] = sA[ch];
+        out_sB[ch] = sB[ch];
+    }
+    return true;
+}
+
+// 每次推理完成后调用：按 JOFTMODE_ML_PROFILE_EVERY 定期打印
+static inline void profile_tick(void)
+{
+#if CONFIG_JOFTMODE_ML_PROFILE
+    uint32_t runs = s_profiler.CountRun();
+    if (CONFIG_JOFTMODE_ML_PROFILE_EVERY > 0 && runs % CONFIG_JOFTMODE_ML_PROFILE_EVERY == 0) {
+        ml_profile_dump();
+    }
+#endif
+}
+
+// 输出张量（int8，2 维：0=walk, 1=ebike）转成结果
+static bool read_output(const int8_t* o, int* out_pred, float* out_p_walk, float* out_p_ebike)
+{
+    int i_walk  = o[s_label_walk];
+    int i_ebike = o[s_label_ebike];
+
+    // 对外约定不变：0=walk, 1=ebike
+    if (out_pred) {
+        *out_pred = (i_ebike > i_walk) ? 1 : 0;
+    }
+    if (out_p_walk)  *out_p_walk  = (i_walk  - s_out_zero) * s_out_scale;
+    if (out_p_ebike) *out_p_ebike = (i_ebike - s_out_zero) * s_out_scale;
+
+    return true;
+}
+
+// 输入张量已填好：推理并读取输出
+static bool invoke_and_read(int* out_pred, float* out_p_walk, float* out_p_ebike)
+{
+    TfLiteTensor* out = s_interpreter->output(0);
+    if (!out) return false;
+
+    if (s_interpreter->Invoke() != kTfLiteOk) {
+        ESP_LOGE(TAG, "Invoke failed");
+        return false;
+    }
+    profile_tick();
+    return read_output(out->data.int8, out_pred, out_p_walk, out_p_ebike);
+}
+
 extern "C" bool ml_infer(const float window_75x8[kT][kC],
                          int* out_pred, float* out_p_walk, float* out_p_ebike)
 /**
@@ -129,11 +494,10 @@ extern "C" bool ml_infer(const float window_75x8[kT][kC],
 {
     // 双重保护
     if (!s_ready || !s_interpreter) return false;
-    TfLiteTensor* in  = s_interpreter->input(0);
-    TfLiteTensor* out = s_interpreter->output(0);
-    if (!in || !out) return false;
+    TfLiteTensor* in = s_interpreter->input(0);
+    if (!in) return false;
 
-    // 1) 量化填充输入张量（int8）
+    // 量化填充输入张量（int8）
     int8_t* dst = in->data.int8;
     for (int t = 0; t < kT; ++t) {
         for (int ch = 0; ch < kC; ++ch) {
@@ -144,23 +508,295 @@ extern "C" bool ml_infer(const float window_75x8[kT][kC],
             *dst++ = (int8_t)q;
         }
     }
+    return invoke_and_read(out_pred, out_p_walk, out_p_ebike);
+}
 
-    // 2) 推理
-    if (s_interpreter->Invoke() != kTfLiteOk) {
-        ESP_LOGE(TAG, "Invoke failed");
+extern "C" bool ml_infer_q(const int8_t window_q[kT * kC],
+                           int* out_pred, float* out_p_walk, float* out_p_ebike)
+/**
+ * 同 ml_infer，但窗口已按 ml_get_input_quant 的系数量化好（时间从旧到新，连续 75x8）。
+ * 填输入张量只是一次 memcpy。
+ */
+{
+    if (!s_ready || !s_interpreter || !window_q) return false;
+    TfLiteTensor* in = s_interpreter->input(0);
+    if (!in) return false;
+
+    std::memcpy(in->data.int8, window_q, kT * kC);
+    return invoke_and_read(out_pred, out_p_walk, out_p_ebike);
+}
+
+#if CONFIG_JOFTMODE_ML_STREAMING
+// ======================= 流式推理 =======================
+// 参数直接从 flatbuffer 里取（与 TFLM 用的是同一份权重），结构不符就退回整窗 Invoke
+
+namespace {
+
+struct OpRef {
+    const tflite::Operator* op;
+    tflite::BuiltinOperator code;
+};
+
+static const tflite::Tensor* op_tensor(const tflite::SubGraph* sg, const tflite::Operator* op, int i, bool output = false)
+{
+    const flatbuffers::Vector<int32_t>* v = output ? op->outputs() : op->inputs();
+    if (!v || i >= (int)v->size() || v->Get(i) < 0) return nullptr;
+    return sg->tensors()->Get(v->Get(i));
+}
+
+static const uint8_t* tensor_data(const tflite::Tensor* t, size_t expect_bytes)
+{
+    const tflite::Buffer* b = s_model->buffers()->Get(t->buffer());
+    if (!b || !b->data() || b->data()->size() != expect_bytes) return nullptr;
+    return b->data()->data();
+}
+
+static bool tensor_shape_is(const tflite::Tensor* t, std::initializer_list<int> dims)
+{
+    if (!t || !t->shape() || t->shape()->size() != dims.size()) return false;
+    int i = 0;
+    for (int d : dims) {
+        if (t->shape()->Get(i++) != d) return false;
+    }
+    return true;
+}
+
+static bool tensor_quant(const tflite::Tensor* t, int idx, float* scale, int32_t* zp)
+{
+    const tflite::QuantizationParameters* q = t ? t->quantization() : nullptr;
+    if (!q || !q->scale() || !q->zero_point() || idx >= (int)q->scale()->size()) return false;
+    *scale = q->scale()->Get(idx);
+    *zp = (int32_t)q->zero_point()->Get(idx < (int)q->zero_point()->size() ? idx : 0);
+    return true;
+}
+
+// 同 TFLM CalculateActivationRangeQuantized
+static bool act_range(tflite::ActivationFunctionType act, float scale, int32_t zp, int32_t* lo, int32_t* hi)
+{
+    *lo = -128;
+    *hi = 127;
+    switch (act) {
+    case tflite::ActivationFunctionType_NONE:
+        return true;
+    case tflite::ActivationFunctionType_RELU:
+        *lo = std::max<int32_t>(-128, zp);
+        return true;
+    case tflite::ActivationFunctionType_RELU6:
+        *lo = std::max<int32_t>(-128, zp);
+        *hi = std::min<int32_t>(127, zp + (int32_t)std::lround(6.0f / scale));
+        return true;
+    default:
         return false;
     }
+}
 
-    // 3) 读取输出
-    const int8_t* o = out->data.int8;   // 2 维：0=walk, 1=ebike
-    int i_walk  = o[LABEL_WALK];
-    int i_ebike = o[LABEL_EBIKE];
+static bool load_conv(const tflite::SubGraph* sg, const tflite::Operator* op, int cin, ml_stream_conv_t* L)
+{
+    const tflite::Conv2DOptions* o = op->builtin_options_as_Conv2DOptions();
+    if (!o || o->padding() != tflite::Padding_SAME || o->stride_w() != 1 || o->stride_h() != 1 ||
+        o->dilation_w_factor() != 1) {
+        return false;
+    }
+    const tflite::Tensor* in = op_tensor(sg, op, 0);
+    const tflite::Tensor* w  = op_tensor(sg, op, 1);
+    const tflite::Tensor* b  = op_tensor(sg, op, 2);
+    const tflite::Tensor* out = op_tensor(sg, op, 0, true);
+    if (!tensor_shape_is(w, {ML_STREAM_F, 1, ML_STREAM_K, cin}) || !b || !out ||
+        w->type() != tflite::TensorType_INT8 || b->type() != tflite::TensorType_INT32) {
+        return false;
+    }
+    L->filter = (const int8_t*)tensor_data(w, (size_t)ML_STREAM_F * ML_STREAM_K * cin);
+    L->bias = (const int32_t*)tensor_data(b, ML_STREAM_F * sizeof(int32_t));
+    if (!L->filter || !L->bias) return false;
 
-    if (out_pred) {
-        *out_pred = (i_ebike > i_walk) ? LABEL_EBIKE : LABEL_WALK;
+    float in_scale, out_scale, w_scale;
+    int32_t w_zp;
+    if (!tensor_quant(in, 0, &in_scale, &L->in_zp) || !tensor_quant(out, 0, &out_scale, &L->out_zp)) {
+        return false;
     }
-    if (out_p_walk)  *out_p_walk  = (i_walk  - s_out_zero) * s_out_scale;
-    if (out_p_ebike) *out_p_ebike = (i_ebike - s_out_zero) * s_out_scale;
+    for (int f = 0; f < ML_STREAM_F; ++f) {
+        // per-tensor 量化的权重只有一个 scale
+        if (!tensor_quant(w, f, &w_scale, &w_zp) && !tensor_quant(w, 0, &w_scale, &w_zp)) return false;
+        tflite::QuantizeMultiplier((double)in_scale * (double)w_scale / (double)out_scale,
+                                   &L->mult[f], &L->shift[f]);
+    }
+    return act_range(o->fused_activation_function(), out_scale, L->out_zp, &L->act_min, &L->act_max);
+}
+
+static bool stream_load_model(ml_stream_model_t* m)
+{
+    const tflite::SubGraph* sg = s_model->subgraphs()->Get(0);
+    const auto* ops = sg->operators();
 
+    // ExpandDims / Reshape 只改形状，跳过
+    OpRef seq[5];
+    int n = 0;
+    for (uint32_t i = 0; i < ops->size(); ++i) {
+        const tflite::Operator* op = ops->Get(i);
+        tflite::BuiltinOperator code = tflite::GetBuiltinCode(s_model->operator_codes()->Get(op->opcode_index()));
+        if (code == tflite::BuiltinOperator_EXPAND_DIMS || code == tflite::BuiltinOperator_RESHAPE) continue;
+        if (n == 5) return false;
+        seq[n++] = {op, code};
+    }
+    if (n != 5 || seq[0].code != tflite::BuiltinOperator_CONV_2D || seq[1].code != tflite::BuiltinOperator_CONV_2D ||
+        seq[2].code != tflite::BuiltinOperator_MEAN || seq[3].code != tflite::BuiltinOperator_FULLY_CONNECTED ||
+        seq[4].code != tflite::BuiltinOperator_SOFTMAX) {
+        return false;
+    }
+    if (!load_conv(sg, seq[0].op, ML_STREAM_C, &m->conv1) || !load_conv(sg, seq[1].op, ML_STREAM_F, &m->conv2)) {
+        return false;
+    }
+
+    // Mean：只支持对时间轴求均值
+    const tflite::Tensor* mean_in  = op_tensor(sg, seq[2].op, 0);
+    const tflite::Tensor* mean_ax  = op_tensor(sg, seq[2].op, 1);
+    const tflite::Tensor* mean_out = op_tensor(sg, seq[2].op, 0, true);
+    const int32_t* axis = mean_ax ? (const int32_t*)tensor_data(mean_ax, sizeof(int32_t)) : nullptr;
+    if (!tensor_shape_is(mean_in, {1, ML_STREAM_T, ML_STREAM_F}) || !axis || *axis != 1) return false;
+    float mi_scale, mo_scale;
+    if (!tensor_quant(mean_in, 0, &mi_scale, &m->mean_in_zp) || !tensor_quant(mean_out, 0, &mo_scale, &m->mean_out_zp)) {
+        return false;
+    }
+    tflite::QuantizeMultiplier((double)mi_scale / (double)mo_scale, &m->mean_mult, &m->mean_shift);
+
+    // Dense
+    const tflite::FullyConnectedOptions* fo = seq[3].op->builtin_options_as_FullyConnectedOptions();
+    const tflite::Tensor* fc_in  = op_tensor(sg, seq[3].op, 0);
+    const tflite::Tensor* fc_w   = op_tensor(sg, seq[3].op, 1);
+    const tflite::Tensor* fc_b   = op_tensor(sg, seq[3].op, 2);
+    const tflite::Tensor* fc_out = op_tensor(sg, seq[3].op, 0, true);
+    if (!fo || !tensor_shape_is(fc_w, {ML_STREAM_OUT, ML_STREAM_F}) || !fc_b) return false;
+    m->fc_filter = (const int8_t*)tensor_data(fc_w, ML_STREAM_OUT * ML_STREAM_F);
+    m->fc_bias = (const int32_t*)tensor_data(fc_b, ML_STREAM_OUT * sizeof(int32_t));
+    float fi_scale, fw_scale;
+    int32_t fw_zp;
+    if (!m->fc_filter || !m->fc_bias || !tensor_quant(fc_in, 0, &fi_scale, &m->fc_in_zp) ||
+        !tensor_quant(fc_w, 0, &fw_scale, &fw_zp) || fw_zp != 0 ||
+        !tensor_quant(fc_out, 0, &m->fc_out_scale, &m->fc_out_zp)) {
+        return false;
+    }
+    tflite::QuantizeMultiplier((double)fi_scale * (double)fw_scale / (double)m->fc_out_scale,
+                               &m->fc_mult, &m->fc_shift);
+    if (!act_range(fo->fused_activation_function(), m->fc_out_scale, m->fc_out_zp,
+                   &m->fc_act_min, &m->fc_act_max)) {
+        return false;
+    }
+
+    // Softmax
+    const tflite::SoftmaxOptions* so = seq[4].op->builtin_options_as_SoftmaxOptions();
+    m->softmax_beta = so ? so->beta() : 1.0f;
+    m->out_scale = s_out_scale;
+    m->out_zp = s_out_zero;
+    return true;
+}
+
+// 自检：同一串帧按不同步长滑窗，流式输出和 TFLM Invoke 逐个比对。
+// Softmax 这里用 float 算，和 TFLM 的定点 exp 允许差 1 个 LSB
+static bool stream_selfcheck(void)
+{
+    constexpr int kFrames = kT + 96;
+    static int8_t frames[kFrames * kC];
+    uint32_t x = 0x6d2b79f5u;
+    for (int i = 0; i < kFrames * kC; ++i) {
+        x = x * 1664525u + 1013904223u;
+        frames[i] = (int8_t)(x >> 24);
+    }
+
+    TfLiteTensor* in  = s_interpreter->input(0);
+    TfLiteTensor* out = s_interpreter->output(0);
+    static const uint8_t kHops[] = {1, 5, 5, 3, 5, 2, 5, 70, 5};
+    int max_diff = 0, windows = 0, exact = 0;
+    int64_t t_stream = 0, t_full = 0;
+    uint32_t macs = 0, steps = 0;
+    uint32_t end = kT - 1;
+    for (int h = 0; end < (uint32_t)kFrames; end += kHops[h++ % sizeof(kHops)]) {
+        const int8_t* win = frames + (end - (kT - 1)) * kC;
+        int8_t sq[ML_STREAM_OUT];
+        int64_t t0 = esp_timer_get_time();
+        if (!ml_stream_run(win, end, sq)) return false;
+        int64_t t1 = esp_timer_get_time();
+        std::memcpy(in->data.int8, win, kT * kC);
+        if (s_interpreter->Invoke() != kTfLiteOk) return false;
+        int64_t t2 = esp_timer_get_time();
+
+        if (windows > 0 && kHops[(h + sizeof(kHops) - 1) % sizeof(kHops)] == 5) {
+            t_stream += t1 - t0;
+            t_full += t2 - t1;
+            macs += ml_stream_last_macs();
+            steps++;
+        }
+        int d = 0;
+        for (int o = 0; o < ML_STREAM_OUT; ++o) {
+            d = std::max(d, std::abs((int)sq[o] - (int)out->data.int8[o]));
+        }
+        max_diff = std::max(max_diff, d);
+        exact += (d == 0);
+        windows++;
+    }
+    ml_stream_reset();
+
+    if (max_diff > 1 || steps == 0) {
+        ESP_LOGW(TAG, "stream self-check failed: max diff %d over %d windows, using full Invoke",
+                 max_diff, windows);
+        return false;
+    }
+    ESP_LOGI(TAG, "stream self-check ok: %d/%d exact (max diff %d). hop 5: %" PRIu32 " vs %" PRIu32
+             " MACs, %" PRId64 " vs %" PRId64 " us",
+             exact, windows, max_diff, macs / steps, ml_stream_full_macs(),
+             t_stream / steps, t_full / steps);
     return true;
 }
+
+static bool stream_prepare(void)
+{
+    ml_stream_model_t m;
+    if (!stream_load_model(&m) || !ml_stream_setup(&m)) {
+        ESP_LOGW(TAG, "model layout not supported by streaming path, using full Invoke");
+        return false;
+    }
+    return stream_selfcheck();
+}
+
+} // namespace
+#endif
+
+extern "C" bool ml_infer_stream(const int8_t window_q[kT * kC], uint32_t end_frame,
+                                int* out_pred, float* out_p_walk, float* out_p_ebike)
+/**
+ * 同 ml_infer_q，但利用与上一个窗口的重叠只算新增的列（见 ml_stream.cc）。
+ * end_frame 为窗口最后一帧的绝对帧号；流式不可用时退回 ml_infer_q。
+ */
+{
+#if CONFIG_JOFTMODE_ML_STREAMING
+    if (s_ready && s_stream_ok && window_q) {
+        int8_t o[ML_STREAM_OUT];
+#if CONFIG_JOFTMODE_ML_PROFILE
+        uint32_t ev = s_profiler.BeginEvent("ML_STREAM");
+        bool ok = ml_stream_run(window_q, end_frame, o);
+        s_profiler.EndEvent(ev);
+#else
+        bool ok = ml_stream_run(window_q, end_frame, o);
+#endif
+        if (!ok) return false;
+        profile_tick();
+        return read_output(o, out_pred, out_p_walk, out_p_ebike);
+    }
+#else
+    (void)end_frame;
+#endif
+    return ml_infer_q(window_q, out_pred, out_p_walk, out_p_ebike);
+}
+
+extern "C" void ml_profile_dump(void)
+{
+#if CONFIG_JOFTMODE_ML_PROFILE
+    s_profiler.Dump(s_arena_used, s_arena_size, (s_arena_caps & MALLOC_CAP_SPIRAM) != 0);
+#endif
+}
+
+extern "C" void ml_profile_reset(void)
+{
+#if CONFIG_JOFTMODE_ML_PROFILE
+    s_profiler.Reset();
+#endif
+}
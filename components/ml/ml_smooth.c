@@ -0,0 +1,147 @@
+// components/ml/ml_smooth.c —— 窗口结果的时间平滑和活动分段
+#include <string.h>
+
+#include "ml_smooth.h"
+
+#define P_FLOOR     0.01f   // 单个窗口的概率最多当 99% 用，一个离群窗口翻不动后验
+#define POST_MIN    1e-4f   // 后验不贴死在 0/1，否则再强的证据也要很久才切得回来
+#define POST_SWITCH 0.75f   // 后验越过这个值才算另一类，0.25~0.75 之间维持上一个结果的类别
+
+static inline float clampf(float x, float lo, float hi)
+{
+    return x < lo ? lo : (x > hi ? hi : x);
+}
+
+// 标签 a 在当前后验下的置信度；静止归到 walk 一侧
+static inline float conf_of(const ml_smooth_t *s, ml_activity_t a)
+{
+    return (a == ML_ACT_EBIKE) ? s->post_ebike : 1.0f - s->post_ebike;
+}
+
+static void start_segment(ml_smooth_t *s, ml_activity_t a, uint32_t t_ms, float conf_sum, uint32_t n)
+{
+    s->cur = a;
+    s->cur_start_ms = t_ms;
+    s->cur_conf_sum = conf_sum;
+    s->cur_n = n;
+}
+
+static void clear_pending(ml_smooth_t *s)
+{
+    s->pend = ML_ACT_UNKNOWN;
+    s->pend_conf_sum = 0.0f;
+    s->pend_cur_sum = 0.0f;
+    s->pend_n = 0;
+    s->back = false;
+}
+
+// 候选作废：这些结果仍属于当前段
+static void fold_pending(ml_smooth_t *s)
+{
+    s->cur_conf_sum += s->pend_cur_sum;
+    s->cur_n += s->pend_n;
+    clear_pending(s);
+}
+
+void ml_smooth_init(ml_smooth_t *s, uint32_t w2e_permille, uint32_t e2w_permille, uint32_t min_seg_ms)
+{
+    memset(s, 0, sizeof(*s));
+    s->p_stay[0] = 1.0f - clampf(w2e_permille / 1000.0f, 0.0f, 0.5f);
+    s->p_stay[1] = 1.0f - clampf(e2w_permille / 1000.0f, 0.0f, 0.5f);
+    s->min_seg_ms = min_seg_ms;
+    s->post_ebike = 0.5f;
+    s->inst = ML_ACT_UNKNOWN;
+    s->cur = ML_ACT_UNKNOWN;
+    s->pend = ML_ACT_UNKNOWN;
+}
+
+bool ml_smooth_update(ml_smooth_t *s, const ml_result_t *r, uint32_t t_ms,
+                      ml_activity_t *out_label, float *out_conf, ml_segment_t *out_seg)
+{
+    // 1) 前向滤波：先按转移概率预测，再乘上本窗口的似然（softmax 输出按均匀先验当似然比用）
+    float prior_e = s->post_ebike * s->p_stay[1] + (1.0f - s->post_ebike) * (1.0f - s->p_stay[0]);
+    float le = clampf(r->p_ebike, P_FLOOR, 1.0f - P_FLOOR);
+    float num = prior_e * le;
+    s->post_ebike = clampf(num / (num + (1.0f - prior_e) * (1.0f - le)), POST_MIN, 1.0f - POST_MIN);
+
+    if (s->inst == ML_ACT_EBIKE) {
+        s->inst = (s->post_ebike < 1.0f - POST_SWITCH) ? ML_ACT_WALK : ML_ACT_EBIKE;
+    } else if (s->inst == ML_ACT_WALK) {
+        s->inst = (s->post_ebike > POST_SWITCH) ? ML_ACT_EBIKE : ML_ACT_WALK;
+    } else {
+        s->inst = (s->post_ebike > 0.5f) ? ML_ACT_EBIKE : ML_ACT_WALK;
+    }
+    ml_activity_t a = (r->gate == ML_GATE_STILL) ? ML_ACT_STILL : s->inst;
+    bool ended = false;
+
+    // 2) 段去抖：候选期间短暂回到当前标签不作废，回来持续 min_seg_ms/2 才作废
+    if (!s->started) {
+        s->started = true;
+        start_segment(s, a, t_ms, conf_of(s, a), 1);
+    } else if (a == s->cur && s->pend == ML_ACT_UNKNOWN) {
+        s->cur_conf_sum += conf_of(s, a);
+        s->cur_n++;
+    } else {
+        if (a != s->cur && a != s->pend) {
+            fold_pending(s);
+            s->pend = a;
+            s->pend_start_ms = t_ms;
+        }
+        if (a == s->cur) {
+            if (!s->back) {
+                s->back = true;
+                s->back_since_ms = t_ms;
+            }
+        } else {
+            s->back = false;
+        }
+        s->pend_conf_sum += conf_of(s, s->pend);
+        s->pend_cur_sum += conf_of(s, s->cur);
+        s->pend_n++;
+        if (s->back) {
+            if (t_ms - s->back_since_ms >= s->min_seg_ms / 2) {
+                fold_pending(s);
+            }
+        } else if (t_ms - s->pend_start_ms >= s->min_seg_ms) {
+            if (out_seg) {
+                out_seg->start_ms = s->cur_start_ms;
+                out_seg->end_ms = s->pend_start_ms;
+                out_seg->label = s->cur;
+                out_seg->confidence = s->cur_n ? s->cur_conf_sum / s->cur_n : 0.0f;
+                out_seg->results = s->cur_n;
+            }
+            ended = true;
+            start_segment(s, s->pend, s->pend_start_ms, s->pend_conf_sum, s->pend_n);
+            clear_pending(s);
+        }
+    }
+    s->cur_last_ms = t_ms;
+
+    if (out_label) *out_label = s->cur;
+    if (out_conf) *out_conf = conf_of(s, s->cur);
+    return ended;
+}
+
+bool ml_smooth_current(const ml_smooth_t *s, ml_segment_t *out)
+{
+    if (!s->started || !out) {
+        return false;
+    }
+    uint32_t n = s->cur_n + s->pend_n;
+    out->start_ms = s->cur_start_ms;
+    out->end_ms = s->cur_last_ms;
+    out->label = s->cur;
+    out->confidence = n ? (s->cur_conf_sum + s->pend_cur_sum) / n : 0.0f;
+    out->results = n;
+    return true;
+}
+
+const char *ml_activity_name(ml_activity_t a)
+{
+    switch (a) {
+    case ML_ACT_WALK:  return "walk";
+    case ML_ACT_EBIKE: return "ebike";
+    case ML_ACT_STILL: return "still";
+    default:           return "unknown";
+    }
+}
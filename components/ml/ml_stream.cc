@@ -0,0 +1,246 @@
+// components/ml/ml_stream.cc —— 流式 Conv1D 推理
+//
+// 相邻窗口重叠 74 帧。SAME padding 只影响窗口两端各 2 列，所以：
+//   conv1 的第 2..72 列、conv2 的第 4..70 列只取决于绝对时间，算一次后按帧号缓存在环里；
+//   每个窗口只需算新增的内部列 + 两端受 padding 影响的列（conv1 4 列、conv2 8 列），
+//   Mean 用 conv2 内部列的滑动和加上两端列。整数运算与 TFLM 参考实现一致。
+
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include "ml_stream.h"
+
+namespace {
+
+constexpr int kT   = ML_STREAM_T;
+constexpr int kC   = ML_STREAM_C;
+constexpr int kF   = ML_STREAM_F;
+constexpr int kK   = ML_STREAM_K;
+constexpr int kOut = ML_STREAM_OUT;
+constexpr int kPad = kK / 2;
+
+// 窗口内不受 padding 影响的列：conv1 [kPad, kT-1-kPad]，conv2 [2*kPad, kT-1-2*kPad]
+constexpr int kC1Lo = kPad;
+constexpr int kC1Hi = kT - 1 - kPad;
+constexpr int kC2Lo = 2 * kPad;
+constexpr int kC2Hi = kT - 1 - 2 * kPad;
+constexpr int kC2N  = kC2Hi - kC2Lo + 1;   // 参与滑动和的列数
+
+static ml_stream_model_t s_m;
+static bool     s_ready = false;
+static bool     s_valid = false;        // 缓存的列是否对应 s_end
+static uint32_t s_end = 0;
+static int32_t  s_mean_mult = 0;        // 已并入 1/kT 的 Mean 系数
+static int      s_mean_shift = 0;
+
+static int8_t   s_c1[kT][kF];           // conv1 内部列，按绝对帧号 % kT
+static int8_t   s_c2[kT][kF];           // conv2 内部列
+static int32_t  s_c2_sum[kF];           // 当前窗口 conv2 内部列之和
+static uint32_t s_macs = 0;
+
+// ---- TFLM 的定点重量化（非 single-rounding 版本） ----
+static inline int32_t sat_round_doubling_high_mul(int32_t a, int32_t b)
+{
+    if (a == b && a == INT32_MIN) return INT32_MAX;
+    int64_t ab = (int64_t)a * (int64_t)b;
+    int32_t nudge = ab >= 0 ? (1 << 30) : (1 - (1 << 30));
+    return (int32_t)((ab + nudge) / (1ll << 31));
+}
+
+static inline int32_t rounding_divide_by_pot(int32_t x, int exponent)
+{
+    const int32_t mask = (int32_t)((1ll << exponent) - 1);
+    const int32_t remainder = x & mask;
+    const int32_t threshold = (mask >> 1) + ((x < 0) ? 1 : 0);
+    return (x >> exponent) + ((remainder > threshold) ? 1 : 0);
+}
+
+static inline int32_t requantize(int32_t x, int32_t mult, int shift)
+{
+    int left  = shift > 0 ? shift : 0;
+    int right = shift > 0 ? 0 : -shift;
+    return rounding_divide_by_pot(sat_round_doubling_high_mul(x * (1 << left), mult), right);
+}
+
+static inline int count_leading_zeros_u64(uint64_t v)
+{
+    int n = 0;
+    for (uint64_t bit = 1ull << 63; bit && !(v & bit); bit >>= 1) n++;
+    return n;
+}
+
+// 算一列卷积输出。taps[k] 是第 k 个卷积核位置对应的输入列，nullptr 表示 SAME padding（不计入）
+static void conv_col(const ml_stream_conv_t& L, int cin, const int8_t* const taps[kK], int8_t out[kF])
+{
+    for (int f = 0; f < kF; ++f) {
+        const int8_t* w = L.filter + f * kK * cin;
+        int32_t acc = 0;
+        for (int k = 0; k < kK; ++k) {
+            const int8_t* x = taps[k];
+            if (!x) continue;
+            const int8_t* wk = w + k * cin;
+            for (int c = 0; c < cin; ++c) {
+                acc += ((int32_t)x[c] - L.in_zp) * wk[c];
+            }
+        }
+        acc += L.bias[f];
+        acc = requantize(acc, L.mult[f], L.shift[f]) + L.out_zp;
+        if (acc < L.act_min) acc = L.act_min;
+        if (acc > L.act_max) acc = L.act_max;
+        out[f] = (int8_t)acc;
+    }
+    s_macs += (uint32_t)(kF * kK * cin);
+}
+
+inline int slot(uint32_t abs_frame) { return (int)(abs_frame % kT); }
+
+} // namespace
+
+extern "C" bool ml_stream_setup(const ml_stream_model_t* m)
+{
+    s_ready = false;
+    s_valid = false;
+    if (!m || !m->conv1.filter || !m->conv1.bias || !m->conv2.filter || !m->conv2.bias ||
+        !m->fc_filter || !m->fc_bias) {
+        return false;
+    }
+    s_m = *m;
+
+    // 同 TFLM QuantizedMeanOrSum：把 1/kT 并进乘数，shift 受限防溢出
+    int shift = 63 - count_leading_zeros_u64((uint64_t)kT);
+    if (shift > 32) shift = 32;
+    if (shift > 31 + s_m.mean_shift) shift = 31 + s_m.mean_shift;
+    s_mean_mult  = (int32_t)(((int64_t)s_m.mean_mult << shift) / kT);
+    s_mean_shift = s_m.mean_shift - shift;
+
+    s_ready = true;
+    return true;
+}
+
+extern "C" void ml_stream_reset(void)
+{
+    s_valid = false;
+}
+
+extern "C" bool ml_stream_run(const int8_t window_q[kT * kC], uint32_t end_frame, int8_t out_q[kOut])
+{
+    if (!s_ready || !window_q || !out_q || end_frame < (uint32_t)(kT - 1)) return false;
+    s_macs = 0;
+
+    const uint32_t start = end_frame - (kT - 1);   // 窗口第 0 列的绝对帧号
+    const bool incremental = s_valid && end_frame > s_end && end_frame - s_end <= (uint32_t)kC2N;
+
+    uint32_t c1_from, c2_from;
+    if (incremental) {
+        c1_from = s_end - kPad + 1;
+        c2_from = s_end - 2 * kPad + 1;
+    } else {
+        c1_from = start + kC1Lo;
+        c2_from = start + kC2Lo;
+        memset(s_c2_sum, 0, sizeof(s_c2_sum));
+    }
+
+    // 1) conv1 新增内部列：输入全部在窗口内
+    const int8_t* taps[kK];
+    for (uint32_t a = c1_from; a <= end_frame - kPad; ++a) {
+        const int8_t* x = window_q + (size_t)(a - start - kPad) * kC;
+        for (int k = 0; k < kK; ++k) taps[k] = x + k * kC;
+        conv_col(s_m.conv1, kC, taps, s_c1[slot(a)]);
+    }
+
+    // 2) conv2 新增内部列，并更新滑动和（移出窗口的那一列此时还没被覆盖）
+    for (uint32_t b = c2_from; b <= end_frame - 2 * kPad; ++b) {
+        for (int k = 0; k < kK; ++k) taps[k] = s_c1[slot(b - kPad + k)];
+        int8_t* col = s_c2[slot(b)];
+        conv_col(s_m.conv2, kF, taps, col);
+        for (int f = 0; f < kF; ++f) s_c2_sum[f] += col[f];
+        if (incremental) {
+            const int8_t* old = s_c2[slot(b - kC2N)];
+            for (int f = 0; f < kF; ++f) s_c2_sum[f] -= old[f];
+        }
+    }
+    s_end = end_frame;
+    s_valid = true;
+
+    // 3) conv1 两端的列（带 padding）
+    int8_t e1[2 * kPad][kF];   // 窗口第 0..kPad-1 列、第 kC1Hi+1..kT-1 列
+    for (int e = 0; e < 2 * kPad; ++e) {
+        int i = (e < kPad) ? e : (kC1Hi + 1 + (e - kPad));
+        for (int k = 0; k < kK; ++k) {
+            int r = i - kPad + k;
+            taps[k] = (r >= 0 && r < kT) ? window_q + (size_t)r * kC : nullptr;
+        }
+        conv_col(s_m.conv1, kC, taps, e1[e]);
+    }
+    auto c1_at = [&](int i) -> const int8_t* {
+        if (i < 0 || i >= kT) return nullptr;
+        if (i < kC1Lo) return e1[i];
+        if (i > kC1Hi) return e1[kPad + (i - kC1Hi - 1)];
+        return s_c1[slot(start + i)];
+    };
+
+    // 4) conv2 两端的列，累加进 Mean 的和
+    int32_t sum[kF];
+    memcpy(sum, s_c2_sum, sizeof(sum));
+    for (int e = 0; e < 4 * kPad; ++e) {
+        int j = (e < 2 * kPad) ? e : (kC2Hi + 1 + (e - 2 * kPad));
+        for (int k = 0; k < kK; ++k) taps[k] = c1_at(j - kPad + k);
+        int8_t col[kF];
+        conv_col(s_m.conv2, kF, taps, col);
+        for (int f = 0; f < kF; ++f) sum[f] += col[f];
+    }
+
+    // 5) Mean
+    int8_t pooled[kF];
+    for (int f = 0; f < kF; ++f) {
+        int32_t v = requantize(sum[f] - s_m.mean_in_zp * kT, s_mean_mult, s_mean_shift) + s_m.mean_out_zp;
+        if (v < -128) v = -128;
+        if (v > 127)  v = 127;
+        pooled[f] = (int8_t)v;
+    }
+
+    // 6) Dense
+    float logits[kOut];
+    float max_logit = -INFINITY;
+    for (int o = 0; o < kOut; ++o) {
+        const int8_t* w = s_m.fc_filter + o * kF;
+        int32_t acc = 0;
+        for (int f = 0; f < kF; ++f) {
+            acc += ((int32_t)pooled[f] - s_m.fc_in_zp) * w[f];
+        }
+        acc += s_m.fc_bias[o];
+        acc = requantize(acc, s_m.fc_mult, s_m.fc_shift) + s_m.fc_out_zp;
+        if (acc < s_m.fc_act_min) acc = s_m.fc_act_min;
+        if (acc > s_m.fc_act_max) acc = s_m.fc_act_max;
+        logits[o] = (float)(acc - s_m.fc_out_zp) * s_m.fc_out_scale * s_m.softmax_beta;
+        if (logits[o] > max_logit) max_logit = logits[o];
+    }
+    s_macs += (uint32_t)(kOut * kF);
+
+    // 7) Softmax（float；TFLM 的定点 exp 与之可能差 1 个 LSB）
+    float e[kOut];
+    float denom = 0.0f;
+    for (int o = 0; o < kOut; ++o) {
+        e[o] = expf(logits[o] - max_logit);
+        denom += e[o];
+    }
+    for (int o = 0; o < kOut; ++o) {
+        int32_t q = (int32_t)lroundf(e[o] / denom / s_m.out_scale) + s_m.out_zp;
+        if (q < -128) q = -128;
+        if (q > 127)  q = 127;
+        out_q[o] = (int8_t)q;
+    }
+    return true;
+}
+
+extern "C" uint32_t ml_stream_last_macs(void)
+{
+    return s_macs;
+}
+
+extern "C" uint32_t ml_stream_full_macs(void)
+{
+    return (uint32_t)(kT * kF * kK * (kC + kF) + kOut * kF);
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 流式推理只支持这一种结构：
+//   Conv1D(C→F, k=K, SAME, stride 1) → Conv1D(F→F, k=K, SAME) → Mean over T → Dense(F→OUT) → Softmax
+// 参数由 ml_runner 从模型里取出来（形状不符就不用流式）
+#define ML_STREAM_T     75
+#define ML_STREAM_C     8
+#define ML_STREAM_F     16
+#define ML_STREAM_K     5
+#define ML_STREAM_OUT   2
+
+// int8 per-channel 卷积层（TFLM 语义：acc = Σ(x - in_zp)*w + bias，再按 mult/shift 重量化）
+typedef struct {
+    const int8_t  *filter;              // [F][1][K][Cin]（OHWI）
+    const int32_t *bias;                // [F]
+    int32_t mult[ML_STREAM_F];
+    int     shift[ML_STREAM_F];
+    int32_t in_zp;
+    int32_t out_zp;
+    int32_t act_min;
+    int32_t act_max;
+} ml_stream_conv_t;
+
+typedef struct {
+    ml_stream_conv_t conv1;             // Cin = ML_STREAM_C
+    ml_stream_conv_t conv2;             // Cin = ML_STREAM_F
+
+    // GlobalAveragePooling1D（ReduceMean）：mult/shift 为 in_scale/out_scale
+    int32_t mean_in_zp;
+    int32_t mean_out_zp;
+    int32_t mean_mult;
+    int     mean_shift;
+
+    // Dense
+    const int8_t  *fc_filter;           // [OUT][F]
+    const int32_t *fc_bias;             // [OUT]
+    int32_t fc_in_zp;
+    int32_t fc_out_zp;
+    int32_t fc_mult;
+    int     fc_shift;
+    int32_t fc_act_min;
+    int32_t fc_act_max;
+    float   fc_out_scale;
+
+    // Softmax（float 计算后按输出张量量化）
+    float   softmax_beta;
+    float   out_scale;
+    int32_t out_zp;
+} ml_stream_model_t;
+
+bool ml_stream_setup(const ml_stream_model_t *m);
+// 丢掉缓存的中间列，下一次 ml_stream_run 从整窗重算
+void ml_stream_reset(void);
+
+/**
+ * 推理一个窗口，输出与模型输出张量同样量化的 int8。
+ * - window_q: 最近 75 帧（量化后，时间从旧到新）
+ * - end_frame: 窗口最后一帧的绝对帧号。比上次大且差不超过窗口内部列数时只算新增的列，
+ *   否则（首次、跳帧太多、倒退）整窗重算
+ */
+bool ml_stream_run(const int8_t window_q[ML_STREAM_T * ML_STREAM_C], uint32_t end_frame,
+                   int8_t out_q[ML_STREAM_OUT]);
+
+// 上次 ml_stream_run 的乘加次数，和整窗（ml_stream_full_macs）对比
+uint32_t ml_stream_last_macs(void);
+uint32_t ml_stream_full_macs(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,35 +1,144 @@
 // components/ml/ml_window.c  —— 纯 C，实现外部 API（供 C 代码调用）
+#include <inttypes.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <string.h>
 #include <math.h>
+#include "esp_log.h"
 #include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
 
+#include "ml_runner.h"
+#include "ml_smooth.h"
 #include "ml_window.h"
 
 // 与模型一致
 #define K_T 75   // 时间长度
 #define K_C 8    // 通道数：acc_x,acc_y,acc_z,gyro_x,gyro_y,gyro_z,speed_mps,turn_rate_deg_s
 
-// 由 ml_runner.cc 暴露的 C 接口（注意：ml_runner.cc 里已用了 extern "C"）
-bool ml_init(void);
-bool ml_infer(const float window_75x8[K_T][K_C],
-              int* out_pred, float* out_p_walk, float* out_p_ebike);
+// 每滑动 ML_HOP 帧推理一次（1 = 每帧都推）。JOFTMODE_ENABLE_ML 关闭时本组件照样编译，给个默认值
+#ifdef CONFIG_JOFTMODE_ML_HOP_FRAMES
+#define ML_HOP          CONFIG_JOFTMODE_ML_HOP_FRAMES
+#else
+#define ML_HOP          1
+#endif
+#if CONFIG_JOFTMODE_ML_TASK
+#define ML_TASK_STACK   6144
+#define ML_TASK_PRIO    CONFIG_JOFTMODE_ML_TASK_PRIO
+#define ML_TASK_CORE    ((CONFIG_JOFTMODE_ML_TASK_CORE < 0) ? tskNO_AFFINITY : CONFIG_JOFTMODE_ML_TASK_CORE)
+#endif
+
+#define ML_REPORT_EVERY 100
+
+// 模型按 25 Hz 的均匀时间轴训练：输入样本按自带的时间戳线性插值到整 40 ms 的网格上
+#define ML_FRAME_US     40000
+#ifdef CONFIG_JOFTMODE_ML_RESAMPLE_MAX_GAP_MS
+#define ML_MAX_GAP_US   ((int64_t)CONFIG_JOFTMODE_ML_RESAMPLE_MAX_GAP_MS * 1000)
+#else
+#define ML_MAX_GAP_US   200000
+#endif
+#define ML_DAY_MS       86400000
+#define ML_FIX_MAX_DT_MS 5000   // 相邻两次定位隔太久（丢星后恢复）就不算转向角速度
+
+// 结果平滑：每个结果的转移概率（‰）和最短段长。JOFTMODE_ENABLE_ML 关闭时同样给默认值
+#ifdef CONFIG_JOFTMODE_ML_SMOOTH_W2E_PERMILLE
+#define ML_SMOOTH_W2E   CONFIG_JOFTMODE_ML_SMOOTH_W2E_PERMILLE
+#define ML_SMOOTH_E2W   CONFIG_JOFTMODE_ML_SMOOTH_E2W_PERMILLE
+#define ML_SEG_MIN_MS   (CONFIG_JOFTMODE_ML_SEG_MIN_S * 1000u)
+#else
+#define ML_SMOOTH_W2E   10
+#define ML_SMOOTH_E2W   10
+#define ML_SEG_MIN_MS   10000u
+#endif
+
+#if CONFIG_JOFTMODE_ML_GATE
+// IMU 量程见 axis6_interface.c：±4 g（0.122 mg/LSB），500 dps（17.5 mdps/LSB）
+#define ACC_LSB_PER_MG      8.197f
+#define GYR_LSB_PER_DPS     57.14f
+#define GATE_HYST(x)        ((x) * (100 + CONFIG_JOFTMODE_ML_GATE_HYST_PCT) / 100)
+#define GATE_SLOW_IN_CMS    CONFIG_JOFTMODE_ML_GATE_SLOW_CMS
+#define GATE_SLOW_OUT_CMS   GATE_HYST(CONFIG_JOFTMODE_ML_GATE_SLOW_CMS)
+#endif
+
+static const char *TAG = "ml_window";
 
 // ------------------- 窗口缓冲（环形） -------------------
-static float s_ring[K_T][K_C];
-static int   s_wr = 0;         // 写指针
+// 每帧写入时就按 ml_runner 的 sA/sB 量化成 int8，并且同时写在 s_wr 和 s_wr+K_T 两处：
+// 最近 75 帧永远是 s_qring[s_wr .. s_wr+K_T-1] 这一段连续内存，取窗口只需一次 memcpy
+static int8_t s_qring[2 * K_T][K_C];
+static float  s_qa[K_C];
+static float  s_qb[K_C];
+static int    s_wr = 0;        // 写指针
 static int   s_count = 0;      // 累计已写帧数（<= K_T）
+static int   s_since_hop = 0;  // 距上次送推理已滑动的帧数
+static int   s_hop = ML_HOP;   // 模型包指定了 hop 就用包里的
+static volatile bool s_inited = false;
+static uint32_t s_frames = 0;  // 累计帧数（绝对帧号，给流式推理对齐相邻窗口）
+static uint32_t s_frame_ms = 0; // 最新一帧的网格时间
 
-// GPS 衍生量计算（转向角速度）
-static bool   s_have_prev_gps = false;
+// 重采样：上一个输入样本，和下一个要输出的网格时刻
+static bool    s_rs_have = false;
+static int64_t s_rs_prev_us = 0;
+static int     s_rs_prev[6];
+static int64_t s_rs_next_us = 0;
+
+// GPS 衍生量计算（转向角速度）：按定位时刻求导，两次定位之间保持
+static bool   s_have_prev_fix = false;
 static float  s_prev_course = 0.0f;
-static int64_t s_prev_gps_time_us = 0;
+static int32_t s_prev_fix_ms = 0;
+static float  s_turn_rate = 0.0f;
 static float  s_last_speed = 0.0f;
 
-// 最近一次推理结果
-static volatile bool        s_has_result = false;
-static volatile ml_result_t s_last_res = {0};
+#if CONFIG_JOFTMODE_ML_GATE
+// ------------------- 门控（不跑模型的简单情况） -------------------
+// 窗口内各轴原始值的和 / 平方和随帧增量更新（滑出的帧减掉），判定只要几次整数乘法。
+// 进入和退出用两档阈值（退出 = 进入 × (1 + HYST_PCT%)），避免在边界上来回切换
+typedef struct {
+    int16_t  imu[6];
+    uint16_t speed_cms;
+    bool     gps;
+} gate_frame_t;
+
+static gate_frame_t s_gate_ring[K_T];   // 与 s_qring 同一个写指针
+static int64_t   s_gate_sum[6];
+static int64_t   s_gate_sq[6];
+static int       s_gate_gps;            // 窗口里有 GPS 定位的帧数
+static int       s_gate_fast_in;        // 速度 >= 进入阈值的帧数
+static int       s_gate_fast_out;       // 速度 >= 退出阈值的帧数
+static ml_gate_t s_gate = ML_GATE_NONE;
+// 静止阈值折算到 3 轴 Σ(N·Σx² − (Σx)²) = N²·总方差 的尺度上
+static int64_t   s_still_acc_in, s_still_acc_out;
+static int64_t   s_still_gyr_in, s_still_gyr_out;
+#endif
+
+// 最近一次推理结果（ml 任务写、logger 读，用自旋锁保证整体读写）
+static portMUX_TYPE         s_res_mux = portMUX_INITIALIZER_UNLOCKED;
+static bool                 s_has_result = false;
+static ml_result_t          s_last_res = {0};
+static uint32_t             s_res_end = 0;      // s_last_res 对应窗口的最后一帧
+static ml_smooth_t          s_smooth;           // 同样在 s_res_mux 里更新
+static ml_segment_cb_t      s_seg_cb = NULL;
+static ml_stats_t           s_stats = {0};
+
+#define WIN_BYTES (K_T * K_C)
+
+#if CONFIG_JOFTMODE_ML_TASK
+// latest-wins 三缓冲：logger 填 back 后和 mid 交换；ml 任务把 mid 换到 front 再推理。
+// 交换只动下标，logger 永远不会等模型；mid 没被取走又来了新窗口就算一次 skipped
+static int8_t       s_win_buf[3][WIN_BYTES];
+static uint32_t     s_win_end[3];       // 各缓冲窗口最后一帧的帧号
+static uint32_t     s_win_end_ms[3];    // 和它的网格时间
+static int          s_win_back = 0;
+static int          s_win_mid = 1;
+static int          s_win_front = 2;
+static bool         s_win_fresh = false;
+static portMUX_TYPE s_win_mux = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t s_ml_task = NULL;
+#else
+static int8_t       s_win_sync[WIN_BYTES];
+#endif
 
 // 角差归一化到 [-180, 180]
 static inline float wrap_deg(float d)
@@ -39,110 +148,591 @@ static inline float wrap_deg(float d)
     return d;
 }
 
-// 取最近 75 帧，按时间从旧到新，拷贝到 out_win
-static void snapshot_window(float out_win[K_T][K_C])
+static inline int8_t quantize(float x, int ch)
 {
-    // 若不足 75 帧，也照样补“已有的”帧；ml_infer 仍然可以跑（模型已量化），
-    // 但建议尽量保证 s_count>=K_T 再信任结果。
-    int n = (s_count < K_T) ? s_count : K_T;
-    int start = (s_wr - n + K_T) % K_T;
+    int q = lroundf(x * s_qa[ch] + s_qb[ch]);
+    if (q < -128) q = -128;
+    if (q > 127)  q = 127;
+    return (int8_t)q;
+}
+
+// 取最近 75 帧（时间从旧到新）。只在 s_count >= K_T 时调用
+static inline void snapshot_window(int8_t out_win[WIN_BYTES])
+{
+    memcpy(out_win, s_qring[s_wr], WIN_BYTES);
+}
+
+static void note_prep(uint32_t dt)
+{
+    taskENTER_CRITICAL(&s_res_mux);
+    s_stats.last_prep_us = dt;
+    if (dt > s_stats.max_prep_us) {
+        s_stats.max_prep_us = dt;
+    }
+    s_stats.total_prep_us += dt;
+    taskEXIT_CRITICAL(&s_res_mux);
+}
 
-    // 先清零（防止不足 75 帧时使用到垃圾数据）
+#if CONFIG_JOFTMODE_ML_PREP_BENCH
+// 开机对比一次预处理开销：旧做法（float 环 → 清零 + 拷 75x8 float → 600 次 lroundf 量化）
+// 对比现在的（一次 600 字节 memcpy 进张量）。只测预处理，不含 Invoke
+static void bench_prep(void)
+{
+    enum { N = 200 };
+    static float ring_f[K_T][K_C];
+    static float win_f[K_T][K_C];
+    static int8_t tensor[WIN_BYTES];
     for (int t = 0; t < K_T; ++t) {
         for (int c = 0; c < K_C; ++c) {
-            out_win[t][c] = 0.0f;
+            ring_f[t][c] = (float)((t * 37 + c * 101) % 4000 - 2000);
         }
     }
 
-    for (int i = 0; i < n; ++i) {
-        int src = (start + i) % K_T;
-        for (int c = 0; c < K_C; ++c) {
-            out_win[i][c] = s_ring[src][c];
+    int64_t t0 = esp_timer_get_time();
+    for (int it = 0; it < N; ++it) {
+        int start = it % K_T;
+        memset(win_f, 0, sizeof(win_f));
+        for (int i = 0; i < K_T; ++i) {
+            memcpy(win_f[i], ring_f[(start + i) % K_T], sizeof(win_f[i]));
         }
+        int8_t *dst = tensor;
+        for (int t = 0; t < K_T; ++t) {
+            for (int c = 0; c < K_C; ++c) {
+                *dst++ = quantize(win_f[t][c], c);
+            }
+        }
+    }
+    int64_t t1 = esp_timer_get_time();
+    for (int it = 0; it < N; ++it) {
+        memcpy(tensor, s_qring[it % K_T], WIN_BYTES);
     }
+    int64_t t2 = esp_timer_get_time();
+
+    ESP_LOGI(TAG, "prep bench: float+quantize %.2f us/window, int8 ring memcpy %.2f us/window",
+             (double)(t1 - t0) / N, (double)(t2 - t1) / N);
 }
+#endif
 
-bool ml_window_init(void)
+// 发布一个窗口结果（调用方持 s_res_mux）：经平滑后写进 s_last_res。
+// 比已发布的窗口旧的结果丢掉（任务模式下门控可能先发布了更新的窗口）。返回 true 表示有一段结束
+static bool publish_locked(const ml_result_t *r, uint32_t end_frame, uint32_t t_ms, ml_segment_t *seg)
+{
+    if (s_has_result && end_frame <= s_res_end) {
+        return false;
+    }
+    s_last_res = *r;
+    bool ended = ml_smooth_update(&s_smooth, r, t_ms, &s_last_res.activity, &s_last_res.confidence, seg);
+    s_res_end = end_frame;
+    s_has_result = true;
+    return ended;
+}
+
+static void notify_segment(const ml_segment_t *seg)
+{
+    ml_segment_cb_t cb = s_seg_cb;
+    if (cb) {
+        cb(seg);
+    }
+}
+
+static void log_stats(const ml_stats_t *st)
+{
+    ESP_LOGI(TAG, "infer n=%" PRIu32 " avg=%" PRIu32 "us max=%" PRIu32 "us skipped=%" PRIu32 "/%" PRIu32
+             " gated=%" PRIu32 " (%" PRIu32 "%%, ~%" PRIu32 "ms saved)",
+             st->inferences, st->inferences ? (uint32_t)(st->total_latency_us / st->inferences) : 0,
+             st->max_latency_us, st->skipped_windows, st->windows, st->gated_windows,
+             st->windows ? st->gated_windows * 100 / st->windows : 0, (uint32_t)(st->gate_saved_us / 1000));
+    ESP_LOGI(TAG, "resample in=%" PRIu32 " frames=%" PRIu32 " dt=%" PRIu32 "..%" PRIu32 "ms"
+             " jitter avg=%" PRIu32 "us gaps=%" PRIu32 " dup=%" PRIu32,
+             st->in_samples, st->frames, st->in_dt_min_us / 1000, st->in_dt_max_us / 1000,
+             st->in_intervals ? (uint32_t)(st->in_jitter_us / st->in_intervals) : 0,
+             st->in_gaps, st->in_dup);
+}
+
+#if CONFIG_JOFTMODE_ML_GATE
+static void gate_reset(void)
+{
+    memset(s_gate_ring, 0, sizeof(s_gate_ring));
+    memset(s_gate_sum, 0, sizeof(s_gate_sum));
+    memset(s_gate_sq, 0, sizeof(s_gate_sq));
+    s_gate_gps = 0;
+    s_gate_fast_in = 0;
+    s_gate_fast_out = 0;
+    s_gate = ML_GATE_NONE;
+
+    const int64_t n2 = (int64_t)K_T * K_T;
+    float acc = CONFIG_JOFTMODE_ML_GATE_STILL_ACC_MG * ACC_LSB_PER_MG;
+    float gyr = CONFIG_JOFTMODE_ML_GATE_STILL_GYRO_DPS * GYR_LSB_PER_DPS;
+    float acc_out = GATE_HYST(acc);
+    float gyr_out = GATE_HYST(gyr);
+    s_still_acc_in = n2 * (int64_t)(acc * acc);
+    s_still_acc_out = n2 * (int64_t)(acc_out * acc_out);
+    s_still_gyr_in = n2 * (int64_t)(gyr * gyr);
+    s_still_gyr_out = n2 * (int64_t)(gyr_out * gyr_out);
+}
+
+static inline int16_t clamp_i16(int v)
+{
+    if (v < INT16_MIN) return INT16_MIN;
+    if (v > INT16_MAX) return INT16_MAX;
+    return (int16_t)v;
+}
+
+// 新帧写进 s_wr 槽位；窗口已满时这个槽位上是最老的一帧，先从累加和里减掉
+static void gate_push(const int imu[6], bool gps, float speed_mps)
+{
+    gate_frame_t *f = &s_gate_ring[s_wr];
+    if (s_count == K_T) {
+        for (int c = 0; c < 6; ++c) {
+            s_gate_sum[c] -= f->imu[c];
+            s_gate_sq[c] -= (int32_t)f->imu[c] * f->imu[c];
+        }
+        s_gate_gps -= f->gps;
+        s_gate_fast_in -= (f->speed_cms >= GATE_SLOW_IN_CMS);
+        s_gate_fast_out -= (f->speed_cms >= GATE_SLOW_OUT_CMS);
+    }
+
+    long cms = lroundf(speed_mps * 100.0f);
+    f->speed_cms = (uint16_t)(cms < 0 ? 0 : (cms > UINT16_MAX ? UINT16_MAX : cms));
+    f->gps = gps;
+    for (int c = 0; c < 6; ++c) {
+        f->imu[c] = clamp_i16(imu[c]);
+        s_gate_sum[c] += f->imu[c];
+        s_gate_sq[c] += (int32_t)f->imu[c] * f->imu[c];
+    }
+    s_gate_gps += f->gps;
+    s_gate_fast_in += (f->speed_cms >= GATE_SLOW_IN_CMS);
+    s_gate_fast_out += (f->speed_cms >= GATE_SLOW_OUT_CMS);
+}
+
+// 3 轴 N²·方差之和。陀螺仪也按方差算（去掉零偏），相当于去直流后的能量
+static inline int64_t gate_spread(int c0)
+{
+    int64_t v = 0;
+    for (int c = c0; c < c0 + 3; ++c) {
+        v += (int64_t)K_T * s_gate_sq[c] - s_gate_sum[c] * s_gate_sum[c];
+    }
+    return v;
+}
+
+// 当前状态决定用进入还是退出阈值
+static ml_gate_t gate_decide(void)
+{
+    int64_t acc = gate_spread(0);
+    int64_t gyr = gate_spread(3);
+    bool still = (s_gate == ML_GATE_STILL) ? (acc < s_still_acc_out && gyr < s_still_gyr_out)
+                                           : (acc < s_still_acc_in && gyr < s_still_gyr_in);
+    if (still) {
+        return ML_GATE_STILL;
+    }
+    // 慢速判定要求窗口里有真实的 GPS 定位，不能只靠复用的旧速度
+    bool slow = (s_gate_gps > 0) &&
+                ((s_gate == ML_GATE_SLOW) ? (s_gate_fast_out == 0) : (s_gate_fast_in == 0));
+    return slow ? ML_GATE_SLOW : ML_GATE_NONE;
+}
+
+// 不跑模型，直接发布门控结果；省下的时间按到目前为止的平均推理耗时估算
+static void publish_gated(ml_gate_t gate, uint32_t end_frame, uint32_t end_ms)
+{
+    ml_result_t r = { .pred = 0, .p_walk = 1.0f, .p_ebike = 0.0f, .gate = gate };
+    ml_segment_t seg;
+
+    taskENTER_CRITICAL(&s_res_mux);
+    bool ended = publish_locked(&r, end_frame, end_ms, &seg);
+    s_stats.windows++;
+    s_stats.gated_windows++;
+    if (s_stats.inferences > 0) {
+        s_stats.gate_saved_us += s_stats.total_latency_us / s_stats.inferences;
+    }
+    ml_stats_t st = s_stats;
+    taskEXIT_CRITICAL(&s_res_mux);
+
+    if (ended) {
+        notify_segment(&seg);
+    }
+    if ((st.gated_windows % ML_REPORT_EVERY) == 0) {
+        log_stats(&st);
+    }
+}
+#endif
+
+// 推理一个窗口并发布结果，记录耗时。结果的时间用窗口最后一帧的网格时间，不受推理排队影响
+static void run_inference(const int8_t win[WIN_BYTES], uint32_t end_frame, uint32_t end_ms)
+{
+    int pred = 0;
+    float pw = 0.0f, pe = 0.0f;
+    int64_t t0 = esp_timer_get_time();
+    bool ok = ml_infer_stream(win, end_frame, &pred, &pw, &pe);
+    int64_t t1 = esp_timer_get_time();
+    uint32_t dt = (uint32_t)(t1 - t0);
+    ml_result_t r = { .pred = pred, .p_walk = pw, .p_ebike = pe, .gate = ML_GATE_NONE };
+    ml_segment_t seg;
+    bool ended = false;
+
+    taskENTER_CRITICAL(&s_res_mux);
+    if (ok) {
+        ended = publish_locked(&r, end_frame, end_ms, &seg);
+        s_stats.inferences++;
+        s_stats.last_latency_us = dt;
+        if (dt > s_stats.max_latency_us) {
+            s_stats.max_latency_us = dt;
+        }
+        s_stats.total_latency_us += dt;
+    } else {
+        s_stats.failures++;
+    }
+    ml_stats_t st = s_stats;
+    taskEXIT_CRITICAL(&s_res_mux);
+
+    if (ended) {
+        notify_segment(&seg);
+    }
+    if (ok && (st.inferences % ML_REPORT_EVERY) == 0) {
+        log_stats(&st);
+    }
+}
+
+#if CONFIG_JOFTMODE_ML_TASK
+static void ml_task(void *arg)
+{
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        bool have = false;
+        taskENTER_CRITICAL(&s_win_mux);
+        if (s_win_fresh) {
+            int t = s_win_front;
+            s_win_front = s_win_mid;
+            s_win_mid = t;
+            s_win_fresh = false;
+            have = true;
+        }
+        taskEXIT_CRITICAL(&s_win_mux);
+
+        if (have) {
+            run_inference(s_win_buf[s_win_front], s_win_end[s_win_front], s_win_end_ms[s_win_front]);
+        }
+    }
+}
+#endif
+
+// 窗口从头开始攒（输入断档之后，不拿断档两边的数据拼窗口）。帧号不回退
+static void restart_frames(void)
 {
-    memset((void*)s_ring, 0, sizeof(s_ring));
     s_wr = 0;
     s_count = 0;
-    s_have_prev_gps = false;
+    s_since_hop = 0;
+#if CONFIG_JOFTMODE_ML_GATE
+    gate_reset();
+#endif
+}
+
+void ml_window_reset(void)
+{
+    memset(s_qring, 0, sizeof(s_qring));
+    restart_frames();
+    s_frames = 0;
+    s_frame_ms = 0;
+    s_rs_have = false;
+    s_have_prev_fix = false;
     s_prev_course = 0.0f;
-    s_prev_gps_time_us = 0;
+    s_prev_fix_ms = 0;
+    s_turn_rate = 0.0f;
     s_last_speed = 0.0f;
+
+    taskENTER_CRITICAL(&s_res_mux);
     s_has_result = false;
     s_last_res.pred = 0;
     s_last_res.p_walk = 0.0f;
     s_last_res.p_ebike = 0.0f;
+    s_last_res.gate = ML_GATE_NONE;
+    s_last_res.activity = ML_ACT_UNKNOWN;
+    s_last_res.confidence = 0.0f;
+    s_res_end = 0;
+    ml_smooth_init(&s_smooth, ML_SMOOTH_W2E, ML_SMOOTH_E2W, ML_SEG_MIN_MS);
+    taskEXIT_CRITICAL(&s_res_mux);
 
-    return ml_init();  // 调用 TFLM 初始化（来自 ml_runner.cc）
+#if CONFIG_JOFTMODE_ML_TASK
+    taskENTER_CRITICAL(&s_win_mux);
+    s_win_fresh = false;
+    taskEXIT_CRITICAL(&s_win_mux);
+#endif
 }
 
-void ml_window_push_sample_raw(int ax, int ay, int az,
+bool ml_window_init(void)
+{
+    s_inited = false;
+    ml_window_reset();
+    taskENTER_CRITICAL(&s_res_mux);
+    memset(&s_stats, 0, sizeof(s_stats));
+    taskEXIT_CRITICAL(&s_res_mux);
+
+    if (!ml_init()) {  // 调用 TFLM 初始化（来自 ml_runner.cc）
+        return false;
+    }
+    if (!ml_get_input_quant(s_qa, s_qb)) {
+        return false;
+    }
+    s_hop = (ml_model_hop() > 0) ? ml_model_hop() : ML_HOP;
+#if CONFIG_JOFTMODE_ML_PREP_BENCH
+    bench_prep();
+#endif
+
+#if CONFIG_JOFTMODE_ML_TASK
+    if (s_ml_task == NULL) {
+        if (xTaskCreatePinnedToCore(ml_task, "ml_infer", ML_TASK_STACK, NULL,
+                                    ML_TASK_PRIO, &s_ml_task, ML_TASK_CORE) != pdPASS) {
+            ESP_LOGE(TAG, "ml task create failed");
+            return false;
+        }
+    }
+    ESP_LOGI(TAG, "inference task: hop=%d core=%d prio=%d",
+             s_hop, CONFIG_JOFTMODE_ML_TASK_CORE, ML_TASK_PRIO);
+#else
+    ESP_LOGI(TAG, "inline inference: hop=%d", s_hop);
+#endif
+    s_inited = true;
+    return true;
+}
+
+int32_t ml_gnss_time_ms(const char *hhmmss)
+{
+    if (!hhmmss) return -1;
+    for (int i = 0; i < 6; ++i) {
+        if (hhmmss[i] < '0' || hhmmss[i] > '9') return -1;
+    }
+    int h = (hhmmss[0] - '0') * 10 + (hhmmss[1] - '0');
+    int m = (hhmmss[2] - '0') * 10 + (hhmmss[3] - '0');
+    int s = (hhmmss[4] - '0') * 10 + (hhmmss[5] - '0');
+    if (h > 23 || m > 59 || s > 60) return -1;
+    int32_t ms = ((h * 60 + m) * 60 + s) * 1000;
+    if (hhmmss[6] == '.') {
+        int scale = 100;
+        for (const char *p = hhmmss + 7; *p >= '0' && *p <= '9' && scale > 0; ++p, scale /= 10) {
+            ms += (*p - '0') * scale;
+        }
+    }
+    return ms;
+}
+
+// 输入间隔统计（logger 的采样抖动）
+static void note_input(int64_t dt_us, bool dup, bool gap)
+{
+    taskENTER_CRITICAL(&s_res_mux);
+    s_stats.in_samples++;
+    if (dup) {
+        s_stats.in_dup++;
+    } else if (gap) {
+        s_stats.in_gaps++;
+    } else if (dt_us > 0) {
+        uint32_t dt = (uint32_t)dt_us;
+        if (s_stats.in_intervals == 0 || dt < s_stats.in_dt_min_us) s_stats.in_dt_min_us = dt;
+        if (dt > s_stats.in_dt_max_us) s_stats.in_dt_max_us = dt;
+        s_stats.in_jitter_us += (dt > ML_FRAME_US) ? dt - ML_FRAME_US : ML_FRAME_US - dt;
+        s_stats.in_intervals++;
+    }
+    taskEXIT_CRITICAL(&s_res_mux);
+}
+
+// 一个网格帧进窗口；够 hop 就门控 / 送推理
+static void push_frame(const int imu[6], bool has_gps, float speed_mps, float turn_rate, uint32_t t_ms)
+{
+    // 1) 组 1 帧（顺序必须与训练一致）
+    float frame[K_C];
+    for (int c = 0; c < 6; ++c) {
+        frame[c] = (float)imu[c];
+    }
+    frame[6] = speed_mps;
+    frame[7] = turn_rate;
+
+#if CONFIG_JOFTMODE_ML_GATE
+    gate_push(imu, has_gps, speed_mps);
+#else
+    (void)has_gps;
+#endif
+
+    // 2) 量化后写入环形缓冲（两份）
+    for (int c = 0; c < K_C; ++c) {
+        int8_t q = quantize(frame[c], c);
+        s_qring[s_wr][c] = q;
+        s_qring[s_wr + K_T][c] = q;
+    }
+    s_wr = (s_wr + 1) % K_T;
+    s_frames++;
+    s_frame_ms = t_ms;
+    if (s_count < K_T) s_count++;
+
+    taskENTER_CRITICAL(&s_res_mux);
+    s_stats.frames++;
+    taskEXIT_CRITICAL(&s_res_mux);
+
+    // 3) 满 75 帧后每滑动 s_hop 帧送一次推理
+    if (s_since_hop < s_hop) s_since_hop++;
+    if (s_count < K_T || s_since_hop < s_hop) {
+        return;
+    }
+    s_since_hop = 0;
+
+#if CONFIG_JOFTMODE_ML_GATE
+    ml_gate_t gate = gate_decide();
+    if (gate != s_gate) {
+        ESP_LOGD(TAG, "gate %d -> %d at frame %" PRIu32, (int)s_gate, (int)gate, s_frames - 1);
+        s_gate = gate;
+    }
+    if (gate != ML_GATE_NONE) {
+#if CONFIG_JOFTMODE_ML_TASK
+        taskENTER_CRITICAL(&s_win_mux);
+        s_win_fresh = false;    // 还没取走的旧窗口也不用推了
+        taskEXIT_CRITICAL(&s_win_mux);
+#endif
+        publish_gated(gate, s_frames - 1, s_frame_ms);
+        return;
+    }
+#endif
+
+#if CONFIG_JOFTMODE_ML_TASK
+    int64_t t0 = esp_timer_get_time();
+    snapshot_window(s_win_buf[s_win_back]);
+    s_win_end[s_win_back] = s_frames - 1;
+    s_win_end_ms[s_win_back] = s_frame_ms;
+    note_prep((uint32_t)(esp_timer_get_time() - t0));
+
+    bool skipped;
+    taskENTER_CRITICAL(&s_win_mux);
+    int t = s_win_mid;
+    s_win_mid = s_win_back;
+    s_win_back = t;
+    skipped = s_win_fresh;   // 上一个窗口还没被取走，被新窗口顶掉
+    s_win_fresh = true;
+    taskEXIT_CRITICAL(&s_win_mux);
+
+    taskENTER_CRITICAL(&s_res_mux);
+    s_stats.windows++;
+    if (skipped) s_stats.skipped_windows++;
+    taskEXIT_CRITICAL(&s_res_mux);
+
+    if (s_ml_task) {
+        xTaskNotifyGive(s_ml_task);
+    }
+#else
+    int64_t t0 = esp_timer_get_time();
+    snapshot_window(s_win_sync);
+    note_prep((uint32_t)(esp_timer_get_time() - t0));
+    taskENTER_CRITICAL(&s_res_mux);
+    s_stats.windows++;
+    taskEXIT_CRITICAL(&s_res_mux);
+    run_inference(s_win_sync, s_frames - 1, s_frame_ms);
+#endif
+}
+
+void ml_window_push_sample_raw(int64_t t_us,
+                               int ax, int ay, int az,
                                int gx, int gy, int gz,
                                bool has_gps,
                                float speed_mps,
-                               float course_deg_now)
+                               float course_deg_now,
+                               int32_t fix_ms)
 {
-    // 1) 计算 turn_rate_deg_s （由 course 导数得到）
-    float turn_rate = 0.0f;
-    int64_t now_us = esp_timer_get_time();
+    // logger 可能比 ml_window_init 先起来（开机要先挂 SD 装模型包），初始化完成前丢弃
+    if (!s_inited) {
+        return;
+    }
+
+    // 1) 时间戳没前进（同一个 IMU 样本又送了一次）直接丢掉；间隔太大就不插值，窗口重新攒
+    int64_t dt_us = s_rs_have ? t_us - s_rs_prev_us : 0;
+    bool dup = s_rs_have && dt_us <= 0;
+    bool gap = s_rs_have && dt_us > ML_MAX_GAP_US;
+    note_input(dt_us, dup, gap);
+    if (dup) {
+        return;
+    }
+    if (!s_rs_have || gap) {
+        if (gap) {
+            ESP_LOGW(TAG, "input gap %" PRId64 " ms, window restarted", dt_us / 1000);
+            restart_frames();
+        }
+        s_rs_have = true;
+        s_rs_prev_us = t_us;
+        s_rs_next_us = t_us;    // 网格从这个样本开始
+        dt_us = 0;
+    }
 
+    // 2) 转向角速度 = course 对定位时刻（UTC）的导数；同一次定位重复送进来时保持上次的值。
+    //    定位时刻未知（<0）就没法求导，按 0 处理
     if (has_gps) {
-        // 更新“最后速度”
         s_last_speed = speed_mps;
-
-        if (s_have_prev_gps) {
-            float dcourse = wrap_deg(course_deg_now - s_prev_course);
-            float dt_s = (float)(now_us - s_prev_gps_time_us) / 1000000.0f;
-            if (dt_s > 0.0f) {
-                turn_rate = dcourse / dt_s;  // deg/s
+        if (fix_ms < 0) {
+            s_turn_rate = 0.0f;
+            s_have_prev_fix = false;
+        } else if (!s_have_prev_fix || fix_ms != s_prev_fix_ms) {
+            s_turn_rate = 0.0f;
+            if (s_have_prev_fix) {
+                int32_t dt_ms = fix_ms - s_prev_fix_ms;
+                if (dt_ms < 0) dt_ms += ML_DAY_MS;  // 跨 UTC 零点
+                if (dt_ms > 0 && dt_ms <= ML_FIX_MAX_DT_MS) {
+                    s_turn_rate = wrap_deg(course_deg_now - s_prev_course) * 1000.0f / (float)dt_ms;
+                }
             }
+            s_have_prev_fix = true;
+            s_prev_course = course_deg_now;
+            s_prev_fix_ms = fix_ms;
         }
-        s_have_prev_gps = true;
-        s_prev_course = course_deg_now;
-        s_prev_gps_time_us = now_us;
     } else {
         // 没有 GPS，就复用最后速度，转向角速度置 0
         speed_mps = s_last_speed;
-        turn_rate = 0.0f;
+        s_turn_rate = 0.0f;
+        s_have_prev_fix = false;
     }
 
-    // 2) 组 1 帧（顺序必须与训练一致）
-    float frame[K_C];
-    frame[0] = (float)ax;
-    frame[1] = (float)ay;
-    frame[2] = (float)az;
-    frame[3] = (float)gx;
-    frame[4] = (float)gy;
-    frame[5] = (float)gz;
-    frame[6] = speed_mps;
-    frame[7] = turn_rate;
-
-    // 3) 写入环形缓冲
-    for (int c = 0; c < K_C; ++c) s_ring[s_wr][c] = frame[c];
-    s_wr = (s_wr + 1) % K_T;
-    if (s_count < K_T) s_count++;
-
-    // 4) 满 75 帧就做一次推理（你现在是 25 Hz，每秒会推 25 次，窗口滑动一步推一次）
-    if (s_count >= K_T) {
-        float win[K_T][K_C];
-        snapshot_window(win);
-
-        int pred = 0;
-        float pw = 0.0f, pe = 0.0f;
-        if (ml_infer(win, &pred, &pw, &pe)) {
-            ml_result_t r = { pred, pw, pe };
-            s_last_res = r;
-            s_has_result = true;
+    // 3) (prev, 当前] 之间每个网格时刻出一帧：IMU 线性插值，速度 / 转向按最新定位保持
+    const int cur[6] = {ax, ay, az, gx, gy, gz};
+    while (s_rs_next_us <= t_us) {
+        int frame[6];
+        if (dt_us > 0) {
+            float a = (float)(s_rs_next_us - s_rs_prev_us) / (float)dt_us;
+            for (int c = 0; c < 6; ++c) {
+                frame[c] = s_rs_prev[c] + (int)lroundf(a * (float)(cur[c] - s_rs_prev[c]));
+            }
+        } else {
+            memcpy(frame, cur, sizeof(frame));
         }
+        push_frame(frame, has_gps, speed_mps, s_turn_rate, (uint32_t)(s_rs_next_us / 1000));
+        s_rs_next_us += ML_FRAME_US;
     }
+    s_rs_prev_us = t_us;
+    memcpy(s_rs_prev, cur, sizeof(s_rs_prev));
 }
 
 bool ml_get_latest_result(ml_result_t* out)
 {
-    if (!s_has_result || !out) return false;
-    *out = s_last_res;
+    if (!out) return false;
+    bool have;
+    taskENTER_CRITICAL(&s_res_mux);
+    have = s_has_result;
+    if (have) *out = s_last_res;
+    taskEXIT_CRITICAL(&s_res_mux);
+    return have;
+}
+
+bool ml_get_stats(ml_stats_t* out)
+{
+    if (!out) return false;
+    taskENTER_CRITICAL(&s_res_mux);
+    *out = s_stats;
+    taskEXIT_CRITICAL(&s_res_mux);
     return true;
 }
+
+void ml_window_set_segment_cb(ml_segment_cb_t cb)
+{
+    s_seg_cb = cb;
+}
+
+bool ml_get_current_segment(ml_segment_t* out)
+{
+    if (!out) return false;
+    taskENTER_CRITICAL(&s_res_mux);
+    bool have = ml_smooth_current(&s_smooth, out);
+    taskEXIT_CRITICAL(&s_res_mux);
+    return have;
+}
@@ -5,8 +5,7 @@
 
 #include "ui.h"
 #include "ui_helpers.h"
-#include "freertos/FreeRTOS.h"
-#include "freertos/task.h"
+#include "ui_screens.h"
 
 ///////////////////// VARIABLES ////////////////////
 
@@ -32,18 +31,11 @@ void ui_init(void)
     lv_theme_t * theme = lv_theme_default_init(dispp, lv_palette_main(LV_PALETTE_BLUE), lv_palette_main(LV_PALETTE_RED),
                                                true, LV_FONT_DEFAULT);
     lv_disp_set_theme(dispp, theme);
+    // 只建主页；其他屏切过去时现建或空闲时预建（ui_screens.c）
     ui_scrhome_screen_init();
-    vTaskDelay(pdMS_TO_TICKS(1));
-    ui_scrcarbon_screen_init();
-    vTaskDelay(pdMS_TO_TICKS(1));
-    ui_scrbadge_screen_init();
-    vTaskDelay(pdMS_TO_TICKS(1));
-    ui_scrsettings_screen_init();
-    vTaskDelay(pdMS_TO_TICKS(1));
-    ui_Calendar_screen_init();
-    vTaskDelay(pdMS_TO_TICKS(1));
     ui____initial_actions0 = lv_obj_create(NULL);
     lv_disp_load_scr(ui_scrhome);
+    ui_screens_init();
 }
 
 void ui_destroy(void)
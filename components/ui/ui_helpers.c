@@ -4,6 +4,7 @@
 // Project name: ecostepv1
 
 #include "ui_helpers.h"
+#include "ui_screens.h"
 
 void _ui_bar_set_property(lv_obj_t * target, int id, int val)
 {
@@ -54,7 +55,8 @@ void _ui_screen_change(lv_obj_t ** target, lv_screen_load_anim_t fademode, int s
 {
     if(*target == NULL)
         target_init();
-    lv_screen_load_anim(*target, fademode, spd, delay, false);
+    ui_screens_track(*target);
+    ui_screens_load(*target, fademode, spd, delay);
 }
 
 void _ui_screen_delete(lv_obj_t ** target)
@@ -0,0 +1,256 @@
+// components/ui/ui_screens.c —— 屏幕生命周期管理
+// 开机只建主页，其他屏第一次切过去时由 _ui_screen_change 现建（生成的代码本来就支持 NULL 时现建）。
+// 载入一屏后空闲一会儿，把最可能的下一屏先建好；卸载的屏先留着，LVGL 内存紧张时回收，最久没用的先走。
+#include <stdint.h>
+
+#include "ui_screens.h"
+#include "ui.h"
+
+#include "sdkconfig.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+
+static const char *TAG = "ui_screens";
+
+#define UI_PREBUILD_DELAY_MS   500          // 载入后这么久、且没有动画在跑才预建
+#define UI_MIN_FREE_INTERNAL   (48 * 1024)  // LVGL 用系统 malloc 时改看内部 RAM 剩余
+
+typedef struct {
+    const char *name;
+    lv_obj_t  **obj;
+    void      (*init)(void);
+    void      (*destroy)(void);
+    lv_obj_t   *tracked;                    // 挂过回调的对象；重建后是新对象，要重新挂
+    uint32_t    last_used_ms;
+    uint16_t    next_cnt[UI_SCR_COUNT];     // 从本屏切到各屏的次数，预测下一屏用
+} ui_scr_slot_t;
+
+static ui_scr_slot_t s_slots[UI_SCR_COUNT] = {
+    [UI_SCR_HOME]     = { "home",     &ui_scrhome,     ui_scrhome_screen_init,     ui_scrhome_screen_destroy },
+    [UI_SCR_CARBON]   = { "carbon",   &ui_scrcarbon,   ui_scrcarbon_screen_init,   ui_scrcarbon_screen_destroy },
+    [UI_SCR_BADGE]    = { "badge",    &ui_scrbadge,    ui_scrbadge_screen_init,    ui_scrbadge_screen_destroy },
+    [UI_SCR_SETTINGS] = { "settings", &ui_scrsettings, ui_scrsettings_screen_init, ui_scrsettings_screen_destroy },
+    [UI_SCR_CALENDAR] = { "calendar", &ui_Calendar,    ui_Calendar_screen_init,    ui_Calendar_screen_destroy },
+};
+
+// 还没有切换记录时的猜测：主页左滑进碳排图，其他屏都回主页
+static const ui_scr_id_t k_default_next[UI_SCR_COUNT] = {
+    [UI_SCR_HOME]     = UI_SCR_CARBON,
+    [UI_SCR_CARBON]   = UI_SCR_HOME,
+    [UI_SCR_BADGE]    = UI_SCR_HOME,
+    [UI_SCR_SETTINGS] = UI_SCR_HOME,
+    [UI_SCR_CALENDAR] = UI_SCR_HOME,
+};
+
+static ui_scr_id_t s_current = UI_SCR_HOME;
+static lv_timer_t *s_prebuild_timer = NULL;
+static ui_screens_load_hook_t s_load_hook = NULL;
+
+static int slot_of(lv_obj_t *scr)
+{
+    for (int i = 0; scr && i < UI_SCR_COUNT; ++i) {
+        if (*s_slots[i].obj == scr) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static size_t mem_free(void)
+{
+    lv_mem_monitor_t mon;
+    lv_mem_monitor(&mon);
+    return mon.total_size > 0 ? mon.free_size : heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+}
+
+static bool mem_pressure(void)
+{
+    lv_mem_monitor_t mon;
+    lv_mem_monitor(&mon);
+    if (mon.total_size > 0) {
+        return mon.used_pct >= CONFIG_JOFTMODE_UI_EVICT_USED_PCT;
+    }
+    return heap_caps_get_free_size(MALLOC_CAP_INTERNAL) < UI_MIN_FREE_INTERNAL;
+}
+
+void ui_screens_log_mem(const char *what)
+{
+    lv_mem_monitor_t mon;
+    lv_mem_monitor(&mon);
+    if (mon.total_size > 0) {
+        ESP_LOGI(TAG, "%s: LVGL heap %u/%u KB used (%u%%, frag %u%%)", what,
+                 (unsigned)((mon.total_size - mon.free_size) / 1024), (unsigned)(mon.total_size / 1024),
+                 (unsigned)mon.used_pct, (unsigned)mon.frag_pct);
+    } else {
+        ESP_LOGI(TAG, "%s: internal heap %u KB free", what,
+                 (unsigned)(heap_caps_get_free_size(MALLOC_CAP_INTERNAL) / 1024));
+    }
+}
+
+static void build(ui_scr_id_t id, const char *why)
+{
+    ui_scr_slot_t *s = &s_slots[id];
+    if (*s->obj) {
+        return;
+    }
+    size_t before = mem_free();
+    uint32_t t0 = lv_tick_get();
+    s->init();
+    ESP_LOGI(TAG, "%s %s: %d B, %u ms", why, s->name,
+             (int)(before - mem_free()), (unsigned)lv_tick_elaps(t0));
+    ui_screens_track(*s->obj);
+}
+
+// 回收一个不在显示的屏（主页常驻）。用生成的 _destroy：scr_unloaded_delete_cb 只删树、
+// 只清屏幕变量，子控件变量会悬空
+static bool evict(ui_scr_id_t id)
+{
+    ui_scr_slot_t *s = &s_slots[id];
+    lv_obj_t *scr = *s->obj;
+    if (id == UI_SCR_HOME || !scr || scr == lv_screen_active() ||
+        scr == lv_display_get_screen_loading(NULL)) {
+        return false;
+    }
+    size_t before = mem_free();
+    s->destroy();
+    ESP_LOGI(TAG, "evicted %s: %d B freed", s->name, (int)(mem_free() - before));
+    return true;
+}
+
+// 内存紧张时按最久没用的顺序回收，keep 那一屏不动
+static void evict_lru(int keep)
+{
+    while (mem_pressure()) {
+        int victim = -1;
+        for (int i = UI_SCR_HOME + 1; i < UI_SCR_COUNT; ++i) {
+            if (i == keep || !*s_slots[i].obj || *s_slots[i].obj == lv_screen_active()) {
+                continue;
+            }
+            if (victim < 0 || (int32_t)(s_slots[i].last_used_ms - s_slots[victim].last_used_ms) < 0) {
+                victim = i;
+            }
+        }
+        if (victim < 0 || !evict((ui_scr_id_t)victim)) {
+            return;
+        }
+    }
+}
+
+// 卸载事件里不能直接删自己，挪到下一轮 lv_timer_handler
+static void evict_async_cb(void *arg)
+{
+    ui_scr_slot_t *s = (ui_scr_slot_t *)arg;
+    if (mem_pressure()) {
+        (void)evict((ui_scr_id_t)(s - s_slots));
+    }
+}
+
+static ui_scr_id_t predict_next(ui_scr_id_t from)
+{
+    const ui_scr_slot_t *s = &s_slots[from];
+    ui_scr_id_t best = k_default_next[from];
+    for (int i = 0; i < UI_SCR_COUNT; ++i) {
+        if (s->next_cnt[i] > s->next_cnt[best]) {
+            best = (ui_scr_id_t)i;
+        }
+    }
+    return best;
+}
+
+static void prebuild_timer_cb(lv_timer_t *t)
+{
+    if (lv_anim_count_running() > 0) {
+        return;     // 还在切屏动画里，下个周期再看
+    }
+    lv_timer_pause(t);
+
+    ui_scr_id_t next = predict_next(s_current);
+    if (*s_slots[next].obj) {
+        return;
+    }
+    evict_lru(next);
+    if (mem_pressure()) {
+        ESP_LOGI(TAG, "skip prebuild %s: memory pressure", s_slots[next].name);
+        return;
+    }
+    build(next, "prebuilt");
+}
+
+static void screen_event_cb(lv_event_t *e)
+{
+    ui_scr_slot_t *s = (ui_scr_slot_t *)lv_event_get_user_data(e);
+    ui_scr_id_t id = (ui_scr_id_t)(s - s_slots);
+
+    switch (lv_event_get_code(e)) {
+    case LV_EVENT_SCREEN_LOADED:
+        if (id != s_current && s_slots[s_current].next_cnt[id] < UINT16_MAX) {
+            s_slots[s_current].next_cnt[id]++;
+        }
+        s_current = id;
+        s->last_used_ms = lv_tick_get();
+        if (s_prebuild_timer) {
+            lv_timer_reset(s_prebuild_timer);
+            lv_timer_resume(s_prebuild_timer);
+        }
+        break;
+    case LV_EVENT_SCREEN_UNLOADED:
+        s->last_used_ms = lv_tick_get();
+        if (id != UI_SCR_HOME && mem_pressure()) {
+            lv_async_call(evict_async_cb, s);
+        }
+        break;
+    case LV_EVENT_DELETE:
+        s->tracked = NULL;
+        break;
+    default:
+        break;
+    }
+}
+
+void ui_screens_track(lv_obj_t *scr)
+{
+    int i = slot_of(scr);
+    if (i < 0 || s_slots[i].tracked == scr) {
+        return;
+    }
+    s_slots[i].tracked = scr;
+    lv_obj_add_event_cb(scr, screen_event_cb, LV_EVENT_SCREEN_LOADED, &s_slots[i]);
+    lv_obj_add_event_cb(scr, screen_event_cb, LV_EVENT_SCREEN_UNLOADED, &s_slots[i]);
+    lv_obj_add_event_cb(scr, screen_event_cb, LV_EVENT_DELETE, &s_slots[i]);
+}
+
+lv_obj_t *ui_screens_get(ui_scr_id_t id)
+{
+    if (id >= UI_SCR_COUNT) {
+        return NULL;
+    }
+    build(id, "built");
+    return *s_slots[id].obj;
+}
+
+void ui_screens_set_load_hook(ui_screens_load_hook_t hook)
+{
+    s_load_hook = hook;
+}
+
+void ui_screens_load(lv_obj_t *scr, lv_screen_load_anim_t anim, uint32_t time, uint32_t delay)
+{
+    if (s_load_hook && s_load_hook(scr, anim, time, delay)) {
+        return;
+    }
+    lv_screen_load_anim(scr, anim, time, delay, false);
+}
+
+void ui_screens_init(void)
+{
+    s_current = UI_SCR_HOME;
+    s_slots[UI_SCR_HOME].last_used_ms = lv_tick_get();
+    ui_screens_track(ui_scrhome);
+#if CONFIG_JOFTMODE_UI_PREBUILD
+    // 开机后主页空闲下来就先建好下一屏
+    if (!s_prebuild_timer) {
+        s_prebuild_timer = lv_timer_create(prebuild_timer_cb, UI_PREBUILD_DELAY_MS, NULL);
+    }
+#endif
+    ui_screens_log_mem("boot (home only)");
+}
@@ -0,0 +1,40 @@
+// components/ui/ui_screens.h —— 屏幕生命周期：按需构建、空闲预建、内存紧张时回收
+#pragma once
+
+#include "lvgl.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    UI_SCR_HOME = 0,        // 常驻，不回收
+    UI_SCR_CARBON,
+    UI_SCR_BADGE,
+    UI_SCR_SETTINGS,
+    UI_SCR_CALENDAR,
+    UI_SCR_COUNT
+} ui_scr_id_t;
+
+// ui_init() 建好主页后调用：给主页挂回调、建预建定时器，打一次 LVGL 内存
+void ui_screens_init(void);
+
+// 屏幕对象（没建就现建）。给跑分之类直接用屏幕的地方
+lv_obj_t *ui_screens_get(ui_scr_id_t id);
+
+// _ui_screen_change 切屏前调用：挂载入/卸载回调（每个屏幕对象挂一次）
+void ui_screens_track(lv_obj_t *scr);
+
+// 打一行 LVGL 内存占用，what 说明时机
+void ui_screens_log_mem(const char *what);
+
+// 切屏接管：返回 true 表示由钩子完成这次切屏（比如快照动画），false 就走 LVGL 自己的动画
+typedef bool (*ui_screens_load_hook_t)(lv_obj_t *scr, lv_screen_load_anim_t anim, uint32_t time, uint32_t delay);
+void ui_screens_set_load_hook(ui_screens_load_hook_t hook);
+
+// _ui_screen_change 用：先问钩子，不接管就 lv_screen_load_anim
+void ui_screens_load(lv_obj_t *scr, lv_screen_load_anim_t anim, uint32_t time, uint32_t delay);
+
+#ifdef __cplusplus
+}
+#endif
@@ -17,6 +17,20 @@
 #include "ml_window.h"
 #endif
 
+#if CONFIG_JOFTMODE_ENABLE_ML
+// 平滑后的活动段发布到 app_state（在 ML 任务 / logger 里调用）
+static void on_activity_segment(const ml_segment_t *seg)
+{
+    app_state_activity_segment_t s = {
+        .start_ms = seg->start_ms,
+        .end_ms = seg->end_ms,
+        .label = (uint8_t)seg->label,
+        .confidence = seg->confidence,
+    };
+    app_state_push_activity_segment(&s);
+}
+#endif
+
 void app_main(void)
 {
     app_state_init();
@@ -28,12 +42,14 @@ void app_main(void)
 
     app_power_start();
 
+    // 先挂 SD：开机时卡上若有新的模型包要在 ml_init 映射分区之前装好
+    app_sdcard_start();
+
 #if CONFIG_JOFTMODE_ENABLE_ML
+    ml_window_set_segment_cb(on_activity_segment);
     ml_window_init();
 #endif
 
-    app_sdcard_start();
-
     app_antenna_start();
 
     while (1) vTaskDelay(pdMS_TO_TICKS(1000));
@@ -0,0 +1,249 @@
+"""Pack LVGL C image arrays (SquareLine / LVGLImage.py output) into compressed blobs.
+
+usage: python img_pack.py [--check] image.c [image.c ...]
+
+Each file is rewritten in place: the pixel array keeps its declaration (and with it
+LV_ATTRIBUTE_LARGE_CONST / LV_ATTRIBUTE_IMAGE_*) but its bytes become a packed blob,
+and the lv_image_dsc_t keeps its symbol, size and colour format, with
+LV_IMAGE_FLAGS_USER1 set so app_img's decoder claims it. The blob is whichever of
+RLE (runs of whole pixels) and LZ4 (independent 64 KB blocks, the block format
+app_sdcard's log_lz4 decodes) comes out smaller. Files that are already packed are
+skipped; --check only prints what packing would save.
+
+Blob layout (little endian):
+  0  "JIMG"
+  4  u8  version (1)
+  5  u8  method (1 = RLE, 2 = LZ4)
+  6  u8  RLE unit in bytes (bytes per pixel)
+  7  u8  reserved
+  8  u32 raw size
+  12 u32 LZ4 block size
+  16 u16 LZ4 block count, u16 reserved
+  20 u32 stored size of each LZ4 block, then the payload
+
+RLE packet: control byte c, c & 0x80 -> (c & 0x7F) + 1 copies of the next unit,
+otherwise c + 1 literal units follow.
+"""
+import re
+import struct
+import sys
+
+MAGIC = b"JIMG"
+VERSION = 1
+METHOD_RLE = 1
+METHOD_LZ4 = 2
+HDR = struct.Struct("<4sBBBBIIHH")
+LZ4_BLOCK = 64 * 1024           # log_lz4 handles at most 64 KB per block
+PACKED_MARK = "Packed by tools/img_pack.py"
+
+
+def rle_compress(data, unit):
+    units = [data[i:i + unit] for i in range(0, len(data), unit)]
+    out = bytearray()
+    lit = []
+    i = 0
+    n = len(units)
+
+    def flush_lit():
+        while lit:
+            chunk = lit[:128]
+            del lit[:128]
+            out.append(len(chunk) - 1)
+            for u in chunk:
+                out.extend(u)
+
+    while i < n:
+        run = 1
+        while i + run < n and run < 128 and units[i + run] == units[i]:
+            run += 1
+        if run >= 2:
+            flush_lit()
+            out.append(0x80 | (run - 1))
+            out += units[i]
+            i += run
+        else:
+            lit.append(units[i])
+            i += 1
+    flush_lit()
+    return bytes(out)
+
+
+def rle_decompress(src, unit, raw_len):
+    out = bytearray()
+    i = 0
+    while i < len(src):
+        c = src[i]
+        i += 1
+        if c & 0x80:
+            out += src[i:i + unit] * ((c & 0x7F) + 1)
+            i += unit
+        else:
+            cnt = (c + 1) * unit
+            out += src[i:i + cnt]
+            i += cnt
+    if len(out) != raw_len:
+        raise ValueError("RLE length mismatch %d != %d" % (len(out), raw_len))
+    return bytes(out)
+
+
+def _lz4_len(out, n):
+    while n >= 255:
+        out.append(255)
+        n -= 255
+    out.append(n)
+
+
+def _lz4_seq(out, lit, offset, mlen):
+    ml = mlen - 4
+    token = (min(len(lit), 15) << 4) | min(ml, 15)
+    out.append(token)
+    if len(lit) >= 15:
+        _lz4_len(out, len(lit) - 15)
+    out += lit
+    out += struct.pack("<H", offset)
+    if ml >= 15:
+        _lz4_len(out, ml - 15)
+
+
+def lz4_compress_block(src):
+    """Greedy LZ4 block compressor; keeps the spec's end-of-block rules
+    (last match starts >= 12 bytes before the end, last 5 bytes are literals)."""
+    n = len(src)
+    out = bytearray()
+    table = {}
+    anchor = 0
+    i = 0
+    mflimit = n - 12
+    while i < mflimit:
+        key = src[i:i + 4]
+        cand = table.get(key)
+        table[key] = i
+        if cand is not None and i - cand <= 0xFFFF:
+            m = 4
+            limit = n - 5
+            while i + m < limit and src[cand + m] == src[i + m]:
+                m += 1
+            _lz4_seq(out, src[anchor:i], i - cand, m)
+            i += m
+            anchor = i
+        else:
+            i += 1
+    lit = src[anchor:]
+    out.append(min(len(lit), 15) << 4)
+    if len(lit) >= 15:
+        _lz4_len(out, len(lit) - 15)
+    out += lit
+    return bytes(out)
+
+
+def lz4_pack(data):
+    blocks = [lz4_compress_block(data[i:i + LZ4_BLOCK]) for i in range(0, len(data), LZ4_BLOCK)]
+    table = b"".join(struct.pack("<I", len(b)) for b in blocks)
+    return len(blocks), table + b"".join(blocks)
+
+
+def pack(data, unit):
+    rle = rle_compress(data, unit)
+    nblocks, lz4 = lz4_pack(data)
+    if len(rle) <= len(lz4):
+        hdr = HDR.pack(MAGIC, VERSION, METHOD_RLE, unit, 0, len(data), 0, 0, 0)
+        blob = hdr + rle
+    else:
+        hdr = HDR.pack(MAGIC, VERSION, METHOD_LZ4, unit, 0, len(data), LZ4_BLOCK, nblocks, 0)
+        blob = hdr + lz4
+    if unpack(blob) != data:
+        raise ValueError("round trip failed")
+    return blob
+
+
+def unpack(blob):
+    sys.path.insert(0, __file__.rsplit("/", 1)[0] if "/" in __file__ else ".")
+    from log_decode import lz4_block_decompress
+    magic, version, method, unit, _, raw_len, block, nblocks, _ = HDR.unpack_from(blob, 0)
+    if magic != MAGIC or version != VERSION:
+        raise ValueError("not a packed image")
+    payload = blob[HDR.size:]
+    if method == METHOD_RLE:
+        return rle_decompress(payload, unit, raw_len)
+    sizes = struct.unpack_from("<%dI" % nblocks, payload, 0)
+    pos = 4 * nblocks
+    out = bytearray()
+    for k, size in enumerate(sizes):
+        want = min(block, raw_len - k * block)
+        out += lz4_block_decompress(payload[pos:pos + size], want)
+        pos += size
+    return bytes(out)
+
+
+def parse(text):
+    m = re.search(r"uint8_t\s+(\w+)\s*\[\s*\]\s*=\s*\{(.*?)\};", text, re.S)
+    if not m:
+        raise ValueError("no pixel array")
+    data = bytes(int(x, 16) for x in re.findall(r"0x([0-9a-fA-F]{1,2})", m.group(2)))
+    dsc = re.search(r"const\s+lv_image_dsc_t\s+(\w+)\s*=\s*\{(.*?)\};", text, re.S)
+    if not dsc:
+        raise ValueError("no lv_image_dsc_t")
+    body = dsc.group(2)
+    w = int(re.search(r"\.header\.w\s*=\s*(\d+)", body).group(1))
+    h = int(re.search(r"\.header\.h\s*=\s*(\d+)", body).group(1))
+    cf = re.search(r"\.header\.cf\s*=\s*(\w+)", body).group(1)
+    # everything but the array bytes and the descriptor body is kept as written,
+    # so the declaration keeps LV_ATTRIBUTE_LARGE_CONST / LV_ATTRIBUTE_IMAGE_*
+    head = text[:m.start(2)].rstrip(" \t\n") + "\n"
+    mid = text[m.end(2):dsc.start()]
+    tail = text[dsc.end():]
+    return (head, mid, tail), m.group(1), data, dsc.group(1), w, h, cf
+
+
+def emit(path, parts, arr, blob, name, w, h, cf):
+    head, mid, tail = parts
+    with open(path, "w", newline="\n") as f:
+        f.write("// %s (%d -> %d bytes); decoded at run time by app_img\n"
+                % (PACKED_MARK, int.from_bytes(blob[8:12], "little"), len(blob)))
+        f.write(head)
+        for i in range(0, len(blob), 16):
+            f.write("    " + ",".join("0x%02x" % b for b in blob[i:i + 16]) + ",\n")
+        f.write(mid)
+        f.write("const lv_image_dsc_t %s = {\n" % name)
+        f.write("    .header.w = %d,\n" % w)
+        f.write("    .header.h = %d,\n" % h)
+        f.write("    .header.cf = %s,\n" % cf)
+        f.write("    .header.flags = LV_IMAGE_FLAGS_USER1,\n")
+        f.write("    .header.magic = LV_IMAGE_HEADER_MAGIC,\n")
+        f.write("    .data_size = sizeof(%s),\n" % arr)
+        f.write("    .data = %s,\n" % arr)
+        f.write("};")
+        f.write(tail)
+
+
+def main(argv):
+    check = "--check" in argv
+    files = [a for a in argv if a != "--check"]
+    if not files:
+        print(__doc__.splitlines()[2])
+        return 1
+    total_raw = total_packed = 0
+    for path in files:
+        text = open(path, encoding="utf-8", errors="replace").read()
+        if PACKED_MARK in text:
+            print("%s: already packed" % path)
+            continue
+        parts, arr, data, name, w, h, cf = parse(text)
+        if len(data) % (w * h):
+            raise ValueError("%s: %d bytes is not a whole number of pixels" % (path, len(data)))
+        blob = pack(data, len(data) // (w * h))
+        method = "RLE" if blob[5] == METHOD_RLE else "LZ4"
+        print("%s: %s %dx%d %d -> %d bytes (%s, %.1f%%)"
+              % (path, name, w, h, len(data), len(blob), method, 100.0 * len(blob) / len(data)))
+        total_raw += len(data)
+        total_packed += len(blob)
+        if not check:
+            emit(path, parts, arr, blob, name, w, h, cf)
+    if total_raw:
+        print("total %d -> %d bytes, %d KB saved"
+              % (total_raw, total_packed, (total_raw - total_packed) // 1024))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1:]))
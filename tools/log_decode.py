@@ -0,0 +1,185 @@
+"""Decode SD log files written by app_sdcard back into CSV.
+
+usage: python log_decode.py log_0001.jlg [out.csv]
+       python log_decode.py --index log_0001.idx
+
+Plain .csv files are copied through unchanged. Journal files are scanned for the
+block magic; a block whose header, CRC or payload does not check out is skipped
+and reported, the scan resyncs on the next magic. Gaps in the block sequence
+numbers are reported as well. Every file starts with a META block holding the CSV
+header; META blocks do not take a sequence number. INDEX blocks carry the periodic
+time-index summaries and are left out of the CSV; --index dumps the .idx side file.
+"""
+import struct
+import sys
+import zlib
+
+BLOCK_MAGIC = b"JB"
+HDR_V1 = struct.Struct("<2sBBHH")     # magic, version, flags, raw_len, stored_len
+HDR_V2 = struct.Struct("<2sBBIHHI")   # magic, version, flags, seq, raw_len, stored_len, crc32
+FLAG_LZ4 = 0x01
+FLAG_META = 0x02
+FLAG_INDEX = 0x04
+FLAG_NOSEQ = FLAG_META | FLAG_INDEX
+IDX_HDR = struct.Struct("<3sBHH")      # magic, version, entry_size, interval_s
+IDX_ENTRY = struct.Struct("<IIIIiHHHHHHHH")
+IDX_FIELDS = ("t_start_ms", "t_end_ms", "data_offset", "next_offset", "utc_sod", "records",
+              "gps_records", "acc_min", "acc_max", "acc_mean", "spd_min", "spd_max", "spd_mean")
+
+
+def lz4_block_decompress(src, raw_len):
+    out = bytearray()
+    i = 0
+    n = len(src)
+    while i < n:
+        token = src[i]
+        i += 1
+        lit = token >> 4
+        if lit == 15:
+            while True:
+                b = src[i]
+                i += 1
+                lit += b
+                if b != 255:
+                    break
+        out += src[i:i + lit]
+        i += lit
+        if i >= n:
+            break
+        offset = src[i] | (src[i + 1] << 8)
+        i += 2
+        if offset == 0 or offset > len(out):
+            raise ValueError("bad match offset")
+        mlen = token & 0x0F
+        if mlen == 15:
+            while True:
+                b = src[i]
+                i += 1
+                mlen += b
+                if b != 255:
+                    break
+        mlen += 4
+        start = len(out) - offset
+        for k in range(mlen):
+            out.append(out[start + k])
+    if len(out) != raw_len:
+        raise ValueError("length mismatch %d != %d" % (len(out), raw_len))
+    return bytes(out)
+
+
+def parse_header(data, pos):
+    """Return (hdr_size, seq, flags, raw_len, stored_len, crc) or None."""
+    if pos + 3 > len(data):
+        return None
+    version = data[pos + 2]
+    if version == 1 and pos + HDR_V1.size <= len(data):
+        _, _, flags, raw_len, stored_len = HDR_V1.unpack_from(data, pos)
+        return HDR_V1.size, None, flags, raw_len, stored_len, None
+    if version == 2 and pos + HDR_V2.size <= len(data):
+        _, _, flags, seq, raw_len, stored_len, crc = HDR_V2.unpack_from(data, pos)
+        return HDR_V2.size, seq, flags, raw_len, stored_len, crc
+    return None
+
+
+def iter_blocks(data):
+    """Yield (offset, seq, payload_bytes or None) for every block candidate.
+
+    seq is None for v1 blocks and META/INDEX blocks. INDEX payloads are
+    returned as b"" so they do not end up in the CSV.
+    """
+    pos = 0
+    while True:
+        pos = data.find(BLOCK_MAGIC, pos)
+        if pos < 0:
+            return
+        hdr = parse_header(data, pos)
+        if hdr is None:
+            yield pos, None, None
+            pos += 1
+            continue
+        hdr_size, seq, flags, raw_len, stored_len, crc = hdr
+        body = pos + hdr_size
+        if body + stored_len > len(data):
+            yield pos, seq, None
+            pos += 1
+            continue
+        payload = data[body:body + stored_len]
+        if crc is not None:
+            calc = zlib.crc32(data[pos:pos + hdr_size - 4])
+            calc = zlib.crc32(payload, calc)
+            if calc != crc:
+                yield pos, seq, None
+                pos += 1
+                continue
+        try:
+            if flags & FLAG_LZ4:
+                payload = lz4_block_decompress(payload, raw_len)
+            elif stored_len != raw_len:
+                raise ValueError("raw block length mismatch")
+        except (ValueError, IndexError):
+            yield pos, seq, None
+            pos += 1
+            continue
+        if flags & FLAG_INDEX:
+            payload = b""
+        yield pos, (None if flags & FLAG_NOSEQ else seq), payload
+        pos = body + stored_len
+
+
+def decode(path):
+    data = open(path, "rb").read()
+    if path.lower().endswith(".csv"):
+        return data, 0, 0
+    out = bytearray()
+    good = bad = 0
+    expect_seq = None
+    for pos, seq, payload in iter_blocks(data):
+        if payload is None:
+            bad += 1
+            sys.stderr.write("skip corrupt block @%d\n" % pos)
+            continue
+        if seq is not None:
+            if expect_seq is not None and seq != expect_seq:
+                sys.stderr.write("sequence gap @%d: expected %d got %d\n" % (pos, expect_seq, seq))
+            expect_seq = seq + 1
+        good += 1
+        out += payload
+    return bytes(out), good, bad
+
+
+def dump_index(path):
+    data = open(path, "rb").read()
+    magic, version, entry_size, interval_s = IDX_HDR.unpack_from(data, 0)
+    if magic != b"JIX" or entry_size < IDX_ENTRY.size:
+        sys.stderr.write("%s: not an index file\n" % path)
+        return 1
+    print("# version=%d interval=%ds" % (version, interval_s))
+    print(",".join(IDX_FIELDS))
+    pos = IDX_HDR.size
+    while pos + entry_size <= len(data):
+        print(",".join(str(v) for v in IDX_ENTRY.unpack_from(data, pos)))
+        pos += entry_size
+    return 0
+
+
+def main(argv):
+    if len(argv) < 2:
+        sys.stderr.write(__doc__)
+        return 2
+    if argv[1] == "--index":
+        return dump_index(argv[2])
+    csv, good, bad = decode(argv[1])
+    if len(argv) > 2:
+        with open(argv[2], "wb") as f:
+            f.write(csv)
+    else:
+        sys.stdout.buffer.write(csv)
+    if good or bad:
+        raw = len(csv)
+        stored = len(open(argv[1], "rb").read())
+        sys.stderr.write("blocks ok=%d bad=%d ratio=%.2f\n" % (good, bad, raw / max(stored, 1)))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
@@ -0,0 +1,150 @@
+"""Build a model package for the "model" partition (see components/ml/include/ml_pkg.h).
+
+usage: python mkmodelpkg.py model_int8.tflite deploy_params.json out.pkg [--version N] [--hop N]
+       python mkmodelpkg.py --info model.pkg
+
+deploy_params.json needs "mu" and "sigma" (one float per input channel) and "labels",
+either a list in output order or a {"name": index} map. "window"/"T", "channels"/"C" and
+"hop" are optional; window and channels default to the model input shape [1, T, C] and
+must match what the firmware was built for (75x8).
+
+Flash it with
+    parttool.py write_partition --partition-name model --input out.pkg
+or copy it to the SD card root as model.pkg; it is installed at the next boot.
+"""
+import json
+import struct
+import sys
+import zlib
+
+MAGIC = b"JMPK"
+FORMAT = 1
+MAX_CH = 16
+MAX_LABELS = 8
+LABEL_LEN = 16
+# magic, format, header_size, total_size, crc32, version, model_offset, model_size,
+# window, channels, hop, n_labels, mu[16], sigma[16], labels[8][16]
+HDR = struct.Struct("<4sHHIIIIIHHHH%df%df%ds" % (MAX_CH, MAX_CH, MAX_LABELS * LABEL_LEN))
+CRC_START = 16          # offsetof(ml_pkg_header_t, version)
+MODEL_ALIGN = 16
+assert HDR.size == 292
+
+
+def tflite_input_shape(model):
+    """[T, C] of the first subgraph input, or None if the flatbuffer is not what we expect."""
+    def u32(o):
+        return struct.unpack_from("<I", model, o)[0]
+
+    def table(o):
+        vt = o - struct.unpack_from("<i", model, o)[0]
+        n = (struct.unpack_from("<H", model, vt)[0] - 4) // 2
+        return o, [struct.unpack_from("<H", model, vt + 4 + 2 * i)[0] for i in range(n)]
+
+    def field(t, i):
+        o, offs = t
+        return o + offs[i] if i < len(offs) and offs[i] else None
+
+    def vec(p):
+        p += u32(p)
+        return p + 4, u32(p)
+
+    try:
+        root = table(u32(0))
+        sg_start, _ = vec(field(root, 2))
+        sg = table(sg_start + u32(sg_start))
+        ins, _ = vec(field(sg, 1))
+        tensors, _ = vec(field(sg, 0))
+        idx = u32(ins)
+        t = table(tensors + 4 * idx + u32(tensors + 4 * idx))
+        shp, n = vec(field(t, 0))
+        dims = [struct.unpack_from("<i", model, shp + 4 * k)[0] for k in range(n)]
+        return dims[1:] if len(dims) == 3 else None
+    except (struct.error, TypeError):
+        return None
+
+
+def build(model, params, version, hop):
+    mu = [float(v) for v in params["mu"]]
+    sigma = [float(v) for v in params["sigma"]]
+    labels = params["labels"]
+    if isinstance(labels, dict):
+        labels = [name for name, _ in sorted(labels.items(), key=lambda kv: kv[1])]
+    shape = tflite_input_shape(model)
+    window = int(params.get("window", params.get("T", shape[0] if shape else 0)))
+    channels = int(params.get("channels", params.get("C", shape[1] if shape else 0)))
+    if hop is None:
+        hop = int(params.get("hop", 0))
+
+    if shape and shape != [window, channels]:
+        raise ValueError("model input is %s, params say %dx%d" % (shape, window, channels))
+    if not (0 < channels <= MAX_CH) or len(mu) != channels or len(sigma) != channels:
+        raise ValueError("need %d mu/sigma values, got %d/%d" % (channels, len(mu), len(sigma)))
+    if any(s <= 0 for s in sigma):
+        raise ValueError("sigma must be > 0")
+    if not (0 < len(labels) <= MAX_LABELS) or any(len(l.encode()) >= LABEL_LEN for l in labels):
+        raise ValueError("1..%d labels, each shorter than %d bytes" % (MAX_LABELS, LABEL_LEN))
+
+    model_offset = (HDR.size + MODEL_ALIGN - 1) // MODEL_ALIGN * MODEL_ALIGN
+    total = model_offset + len(model)
+    pad = lambda v: v + [0.0] * (MAX_CH - len(v))
+    label_bytes = b"".join(l.encode().ljust(LABEL_LEN, b"\0") for l in labels).ljust(MAX_LABELS * LABEL_LEN, b"\0")
+
+    def pack(crc):
+        return HDR.pack(MAGIC, FORMAT, HDR.size, total, crc, version, model_offset, len(model),
+                        window, channels, hop, len(labels), *pad(mu), *pad(sigma), label_bytes)
+
+    body = pack(0).ljust(model_offset, b"\0") + model
+    crc = zlib.crc32(body[CRC_START:]) & 0xFFFFFFFF
+    return pack(crc).ljust(model_offset, b"\0") + model
+
+
+def info(pkg):
+    f = HDR.unpack_from(pkg)
+    magic, fmt, hsize, total, crc, version, moff, msize, window, channels, hop, n_labels = f[:12]
+    mu = f[12:12 + MAX_CH][:channels]
+    sigma = f[12 + MAX_CH:12 + 2 * MAX_CH][:channels]
+    raw = f[-1]
+    labels = [raw[i * LABEL_LEN:(i + 1) * LABEL_LEN].split(b"\0")[0].decode() for i in range(n_labels)]
+    ok = magic == MAGIC and total <= len(pkg) and (zlib.crc32(pkg[CRC_START:total]) & 0xFFFFFFFF) == crc
+    print("format %d  version %d  %d bytes  crc %08x %s" % (fmt, version, total, crc, "ok" if ok else "BAD"))
+    print("model %d bytes at %d  window %dx%d  hop %d" % (msize, moff, window, channels, hop))
+    print("labels", labels)
+    print("mu    ", ["%.6g" % v for v in mu])
+    print("sigma ", ["%.6g" % v for v in sigma])
+    return 0 if ok else 1
+
+
+def main(argv):
+    args = argv[1:]
+    if len(args) == 2 and args[0] == "--info":
+        with open(args[1], "rb") as f:
+            return info(f.read())
+    version, hop = 1, None
+    pos = []
+    i = 0
+    while i < len(args):
+        if args[i] == "--version":
+            version = int(args[i + 1], 0)
+            i += 2
+        elif args[i] == "--hop":
+            hop = int(args[i + 1])
+            i += 2
+        else:
+            pos.append(args[i])
+            i += 1
+    if len(pos) != 3:
+        sys.stderr.write(__doc__)
+        return 2
+    with open(pos[0], "rb") as f:
+        model = f.read()
+    with open(pos[1], "r", encoding="utf-8") as f:
+        params = json.load(f)
+    pkg = build(model, params, version, hop)
+    with open(pos[2], "wb") as f:
+        f.write(pkg)
+    print("wrote %s: %d bytes, version %d" % (pos[2], len(pkg), version))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv))
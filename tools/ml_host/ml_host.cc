@@ -0,0 +1,494 @@
+// tools/ml_host/ml_host.cc —— 在 PC 上回放 SD 日志，跑和固件同一套窗口 / 量化 / 推理代码
+//
+// usage: ml_host [--pkg model.pkg] [--label walk|ebike|still] [--quiet] [--segments] [--check-stream]
+//                log.csv|dir ...
+//
+// log.csv 是 log_decode.py 解出来的 CSV（表头见 app_sdcard.c），目录则回放其中所有 .csv（按文件名排序）。
+// 每个文件单独回放（文件之间 ml_window_reset）。每行按固件 logger 的方式喂给 ml_window_push_sample_raw
+// （速度列为空 = 没有 GPS，沿用上一次的速度 / 航向），推理在本线程同步完成。
+//
+// 真值标签按优先级取：CSV 里的 label 列 > --label > 文件所在目录名（walk / ebike / still）。
+// 有真值时按窗口统计混淆矩阵（原始预测和平滑后的活动各一张）。
+// 日志里有 ml_pred / ml_p_ebike 时逐行比对：设备上推理在 ML 任务里跑，结果可能晚几行
+// 才进日志，所以预测“一致”按允许最多 hop 行延迟来算。--segments 打印平滑后的活动段。
+//
+// --check-stream：每个送去推理的窗口在 ml_infer_stream 之后再用 ml_infer_q 整窗 Invoke 一次，
+// 统计两者输出的最大差（流式和 TFLM 的等价性，在真实数据上检查）。ml_infer_stream 由链接器
+// --wrap 截下来（见 CMakeLists.txt），所以 ml_window 的代码不用改。此模式下推理耗时包含两次推理
+#include <dirent.h>
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "esp_partition.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+
+#include "ml_runner.h"
+#include "ml_window.h"
+
+#define LAG_MAX     64      // 比对时最多回看的行数
+#define N_TRUTH     3       // walk, ebike, still
+
+namespace {
+
+const char* const kTruthNames[N_TRUTH] = {"walk", "ebike", "still"};
+
+struct Columns {
+    int ts_ms = -1;
+    int utc = -1;       // GNSS 的 hhmmss.ss
+    int speed = -1;
+    int course = -1;
+    int imu[6] = {-1, -1, -1, -1, -1, -1};
+    int pred = -1;
+    int p_ebike = -1;
+    int label = -1;
+};
+
+struct Tally {
+    uint64_t rows = 0;
+    uint64_t bad_rows = 0;
+    uint64_t windows = 0;
+    uint64_t push_ns = 0;               // 花在 ml_window_push_sample_raw 里的时间
+    uint64_t raw[N_TRUTH][2] = {};      // 真值 x 单窗口预测（walk, ebike）
+    uint64_t act[N_TRUTH][N_TRUTH] = {};// 真值 x 平滑后的活动（walk, ebike, still）
+    uint64_t cmp_rows = 0;              // 设备和主机都有结果的行
+    uint64_t cmp_same_row = 0;          // 同一行预测一致
+    uint64_t cmp_within_lag = 0;        // 允许延迟后一致
+    double   cmp_sum_dp = 0.0;
+    double   cmp_max_dp = 0.0;
+    uint64_t sc_windows = 0;            // --check-stream：流式和整窗都跑了的窗口
+    uint64_t sc_exact = 0;              // 两路输出完全相同
+    uint64_t sc_pred_diff = 0;          // 预测不同
+    uint64_t sc_failures = 0;           // 整窗 Invoke 失败
+    double   sc_max_dp = 0.0;           // max |Δp|，walk / ebike 两个输出取大
+
+    void add(const Tally& o)
+    {
+        rows += o.rows;
+        bad_rows += o.bad_rows;
+        windows += o.windows;
+        push_ns += o.push_ns;
+        for (int t = 0; t < N_TRUTH; ++t) {
+            for (int p = 0; p < 2; ++p) raw[t][p] += o.raw[t][p];
+            for (int p = 0; p < N_TRUTH; ++p) act[t][p] += o.act[t][p];
+        }
+        cmp_rows += o.cmp_rows;
+        cmp_same_row += o.cmp_same_row;
+        cmp_within_lag += o.cmp_within_lag;
+        cmp_sum_dp += o.cmp_sum_dp;
+        cmp_max_dp = std::max(cmp_max_dp, o.cmp_max_dp);
+        sc_windows += o.sc_windows;
+        sc_exact += o.sc_exact;
+        sc_pred_diff += o.sc_pred_diff;
+        sc_failures += o.sc_failures;
+        sc_max_dp = std::max(sc_max_dp, o.sc_max_dp);
+    }
+};
+
+struct Options {
+    int  label = -1;
+    bool quiet = false;
+    bool segments = false;
+    bool check_stream = false;
+};
+
+Tally* g_check = nullptr;      // --check-stream 时指向正在回放的文件的统计
+
+int64_t now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+std::vector<std::string> split_csv(const std::string& line)
+{
+    std::vector<std::string> out;
+    size_t start = 0;
+    while (true) {
+        size_t comma = line.find(',', start);
+        out.push_back(line.substr(start, comma == std::string::npos ? std::string::npos : comma - start));
+        if (comma == std::string::npos) break;
+        start = comma + 1;
+    }
+    return out;
+}
+
+std::string chomp(const char* s)
+{
+    std::string line(s);
+    while (!line.empty() && (line.back() == '\n' || line.back() == '\r')) line.pop_back();
+    return line;
+}
+
+bool parse_header(const std::vector<std::string>& h, Columns* c)
+{
+    static const char* kImu[6] = {"acc_x", "acc_y", "acc_z", "gyro_x", "gyro_y", "gyro_z"};
+    for (int i = 0; i < (int)h.size(); ++i) {
+        const std::string& n = h[i];
+        if (n == "timestamp_ms") c->ts_ms = i;
+        else if (n == "timestamp") c->utc = i;
+        else if (n == "speed_mps") c->speed = i;
+        else if (n == "course_deg") c->course = i;
+        else if (n == "ml_pred") c->pred = i;
+        else if (n == "ml_p_ebike") c->p_ebike = i;
+        else if (n == "label") c->label = i;
+        for (int k = 0; k < 6; ++k) {
+            if (n == kImu[k]) c->imu[k] = i;
+        }
+    }
+    if (c->ts_ms < 0 || c->speed < 0 || c->course < 0) return false;
+    for (int k = 0; k < 6; ++k) {
+        if (c->imu[k] < 0) return false;
+    }
+    return true;
+}
+
+// 真值标签名转下标，未知返回 -1
+int truth_index(const std::string& s)
+{
+    for (int i = 0; i < N_TRUTH; ++i) {
+        if (s == kTruthNames[i]) return i;
+    }
+    return -1;
+}
+
+// 日志里的 ml_pred 转成下标（walk / still=0, ebike=1），空 / 未知返回 -1
+int label_to_pred(const std::string& s)
+{
+    if (s == "walk" || s == "still") return 0;
+    if (s == "ebike") return 1;
+    return -1;
+}
+
+int activity_index(ml_activity_t a)
+{
+    switch (a) {
+    case ML_ACT_WALK:  return 0;
+    case ML_ACT_EBIKE: return 1;
+    case ML_ACT_STILL: return 2;
+    default:           return -1;
+    }
+}
+
+const std::string& field(const std::vector<std::string>& f, int i)
+{
+    static const std::string kEmpty;
+    return (i >= 0 && i < (int)f.size()) ? f[i] : kEmpty;
+}
+
+void print_segment(const ml_segment_t* seg)
+{
+    printf("  segment %10" PRIu32 " .. %10" PRIu32 " ms  %-6s conf %.3f  (%" PRIu32 " results)\n",
+           seg->start_ms, seg->end_ms, ml_activity_name(seg->label), seg->confidence, seg->results);
+}
+
+bool is_dir(const std::string& p)
+{
+    struct stat st;
+    return stat(p.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+void collect_inputs(const std::string& p, std::vector<std::string>* out)
+{
+    if (!is_dir(p)) {
+        out->push_back(p);
+        return;
+    }
+    DIR* d = opendir(p.c_str());
+    if (!d) return;
+    std::vector<std::string> names;
+    while (struct dirent* e = readdir(d)) {
+        std::string n = e->d_name;
+        if (n.size() > 4 && n.compare(n.size() - 4, 4, ".csv") == 0) names.push_back(p + "/" + n);
+    }
+    closedir(d);
+    std::sort(names.begin(), names.end());
+    out->insert(out->end(), names.begin(), names.end());
+}
+
+// 文件所在目录名是 walk / ebike / still 时当真值
+int label_from_path(const std::string& path)
+{
+    size_t slash = path.find_last_of('/');
+    if (slash == std::string::npos || slash == 0) return -1;
+    size_t prev = path.find_last_of('/', slash - 1);
+    size_t from = (prev == std::string::npos) ? 0 : prev + 1;
+    return truth_index(path.substr(from, slash - from));
+}
+
+// 回放一个文件，结果累加进 *t。返回 false 表示文件打不开或不是日志
+bool replay_file(const std::string& path, const Options& opt, int hop, Tally* t)
+{
+    FILE* f = fopen(path.c_str(), "r");
+    if (!f) {
+        fprintf(stderr, "cannot open %s\n", path.c_str());
+        return false;
+    }
+    char buf[512];
+    Columns col;
+    if (!fgets(buf, sizeof(buf), f) || !parse_header(split_csv(chomp(buf)), &col)) {
+        fprintf(stderr, "%s: not an SD log CSV (header)\n", path.c_str());
+        fclose(f);
+        return false;
+    }
+    ml_window_reset();
+    g_check = opt.check_stream ? t : nullptr;
+
+    const int file_label = (opt.label >= 0) ? opt.label : label_from_path(path);
+    const int lag = std::min(hop, LAG_MAX);
+    const bool have_device = col.pred >= 0 && col.p_ebike >= 0;
+    int host_hist[LAG_MAX + 1];
+    std::fill(host_hist, host_hist + LAG_MAX + 1, -1);
+    float last_speed = 0.0f;
+    float last_course = 0.0f;
+    ml_stats_t st;
+    ml_get_stats(&st);
+    uint32_t last_windows = st.windows;
+
+    while (fgets(buf, sizeof(buf), f)) {
+        std::vector<std::string> v = split_csv(chomp(buf));
+        const std::string& ts = field(v, col.ts_ms);
+        int imu[6];
+        bool ok = !ts.empty();
+        for (int k = 0; k < 6 && ok; ++k) {
+            const std::string& s = field(v, col.imu[k]);
+            ok = !s.empty();
+            imu[k] = atoi(s.c_str());
+        }
+        if (!ok) {
+            ++t->bad_rows;
+            continue;
+        }
+        // 和 logger 一样：没 GPS 的行用最后一次的速度 / 航向
+        bool has_gps = !field(v, col.speed).empty();
+        if (has_gps) {
+            last_speed = strtof(field(v, col.speed).c_str(), nullptr);
+            last_course = strtof(field(v, col.course).c_str(), nullptr);
+        }
+
+        int64_t t_us = strtoll(ts.c_str(), nullptr, 10) * 1000;
+        int32_t fix_ms = has_gps ? ml_gnss_time_ms(field(v, col.utc).c_str()) : -1;
+        host_timer_set(t_us);
+        int64_t t0 = now_ns();
+        ml_window_push_sample_raw(t_us, imu[0], imu[1], imu[2], imu[3], imu[4], imu[5],
+                                  has_gps, last_speed, last_course, fix_ms);
+        t->push_ns += (uint64_t)(now_ns() - t0);
+        ++t->rows;
+
+        ml_result_t r;
+        bool have = ml_get_latest_result(&r);
+        ml_get_stats(&st);
+        if (st.windows != last_windows) {
+            t->windows += st.windows - last_windows;
+            last_windows = st.windows;
+            int truth = truth_index(field(v, col.label));
+            if (truth < 0) truth = file_label;
+            int act = have ? activity_index(r.activity) : -1;
+            if (have && truth >= 0) {
+                t->raw[truth][r.pred ? 1 : 0]++;
+                if (act >= 0) t->act[truth][act]++;
+            }
+        }
+
+        int host_pred = have ? r.pred : -1;
+        memmove(&host_hist[1], &host_hist[0], LAG_MAX * sizeof(host_hist[0]));
+        host_hist[0] = host_pred;
+        if (!have_device || host_pred < 0) continue;
+        int dev_pred = label_to_pred(field(v, col.pred));
+        if (dev_pred < 0) continue;
+
+        float dev_p = strtof(field(v, col.p_ebike).c_str(), nullptr);
+        ++t->cmp_rows;
+        if (dev_pred == host_pred) ++t->cmp_same_row;
+        bool lag_ok = false;
+        for (int k = 0; k <= lag && !lag_ok; ++k) {
+            lag_ok = (host_hist[k] == dev_pred);
+        }
+        if (lag_ok) ++t->cmp_within_lag;
+        double dp = fabs((double)dev_p - r.p_ebike);
+        t->cmp_sum_dp += dp;
+        t->cmp_max_dp = std::max(t->cmp_max_dp, dp);
+        if (!opt.quiet && !lag_ok) {
+            printf("  row %" PRIu64 " t=%s: device %s %.3f, host %s %.3f\n", t->rows, ts.c_str(),
+                   field(v, col.pred).c_str(), dev_p, host_pred ? "ebike" : "walk", r.p_ebike);
+        }
+    }
+    fclose(f);
+    g_check = nullptr;
+
+    ml_segment_t seg;
+    if (opt.segments && ml_get_current_segment(&seg)) {
+        print_segment(&seg);
+    }
+    return true;
+}
+
+// 只有 walk / ebike 两列时，真值 still 判成 walk 算对
+inline int expected_col(int truth, int cols)
+{
+    return (truth < cols) ? truth : 0;
+}
+
+void print_confusion(const char* title, const uint64_t* m, int cols, const char* const* col_names)
+{
+    uint64_t total = 0, diag = 0;
+    for (int tr = 0; tr < N_TRUTH; ++tr) {
+        for (int p = 0; p < cols; ++p) {
+            total += m[tr * cols + p];
+            if (p == expected_col(tr, cols)) diag += m[tr * cols + p];
+        }
+    }
+    if (total == 0) return;
+    printf("%s (rows = truth, %" PRIu64 " windows, accuracy %.2f%%)\n", title, total, 100.0 * diag / total);
+    printf("  %-8s", "");
+    for (int p = 0; p < cols; ++p) printf(" %9s", col_names[p]);
+    printf("\n");
+    for (int tr = 0; tr < N_TRUTH; ++tr) {
+        uint64_t n = 0;
+        for (int p = 0; p < cols; ++p) n += m[tr * cols + p];
+        if (n == 0) continue;
+        printf("  %-8s", kTruthNames[tr]);
+        for (int p = 0; p < cols; ++p) printf(" %9" PRIu64, m[tr * cols + p]);
+        printf("   recall %.2f%%\n", 100.0 * m[tr * cols + expected_col(tr, cols)] / n);
+    }
+}
+
+void print_tally(const char* name, const Tally& t, int hop)
+{
+    double push_s = t.push_ns / 1e9;
+    printf("%s: %" PRIu64 " rows (%" PRIu64 " skipped), %" PRIu64 " windows, %.0f windows/s, %.0f rows/s\n",
+           name, t.rows, t.bad_rows, t.windows, push_s > 0 ? t.windows / push_s : 0.0,
+           push_s > 0 ? t.rows / push_s : 0.0);
+    if (t.cmp_rows > 0) {
+        printf("  vs logged ml_pred: %" PRIu64 " rows, disagree %.2f%% same row, %.2f%% beyond %d rows; "
+               "|dp_ebike| mean %.4f max %.4f\n",
+               t.cmp_rows, 100.0 - 100.0 * t.cmp_same_row / t.cmp_rows,
+               100.0 - 100.0 * t.cmp_within_lag / t.cmp_rows, std::min(hop, LAG_MAX),
+               t.cmp_sum_dp / t.cmp_rows, t.cmp_max_dp);
+    }
+    if (t.sc_windows + t.sc_failures > 0) {
+        printf("  stream vs full Invoke: %" PRIu64 " windows, %" PRIu64 " exact, %" PRIu64 " pred differ, "
+               "max |dp| %.4f, %" PRIu64 " Invoke failures\n",
+               t.sc_windows, t.sc_exact, t.sc_pred_diff, t.sc_max_dp, t.sc_failures);
+    }
+}
+
+}  // namespace
+
+extern "C" bool __real_ml_infer_stream(const int8_t window_q[75 * 8], uint32_t end_frame,
+                                       int* out_pred, float* out_p_walk, float* out_p_ebike);
+
+// ml_window 调 ml_infer_stream 都到这里（-Wl,--wrap=ml_infer_stream）
+extern "C" bool __wrap_ml_infer_stream(const int8_t window_q[75 * 8], uint32_t end_frame,
+                                       int* out_pred, float* out_p_walk, float* out_p_ebike)
+{
+    bool ok = __real_ml_infer_stream(window_q, end_frame, out_pred, out_p_walk, out_p_ebike);
+    if (!ok || !g_check) return ok;
+
+    int pred = 0;
+    float pw = 0.0f, pe = 0.0f;
+    if (!ml_infer_q(window_q, &pred, &pw, &pe)) {
+        ++g_check->sc_failures;
+        return ok;
+    }
+    double dp = std::max(fabs((double)*out_p_walk - pw), fabs((double)*out_p_ebike - pe));
+    ++g_check->sc_windows;
+    if (dp == 0.0) ++g_check->sc_exact;
+    if (pred != *out_pred) ++g_check->sc_pred_diff;
+    g_check->sc_max_dp = std::max(g_check->sc_max_dp, dp);
+    return ok;
+}
+
+int main(int argc, char** argv)
+{
+    const char* pkg = nullptr;
+    Options opt;
+    std::vector<std::string> inputs;
+    bool usage = false;
+    for (int i = 1; i < argc && !usage; ++i) {
+        if (strcmp(argv[i], "--pkg") == 0 && i + 1 < argc) {
+            pkg = argv[++i];
+        } else if (strcmp(argv[i], "--label") == 0 && i + 1 < argc) {
+            opt.label = truth_index(argv[++i]);
+            usage = (opt.label < 0);
+        } else if (strcmp(argv[i], "--quiet") == 0) {
+            opt.quiet = true;
+        } else if (strcmp(argv[i], "--segments") == 0) {
+            opt.segments = true;
+        } else if (strcmp(argv[i], "--check-stream") == 0) {
+            opt.check_stream = true;
+        } else if (argv[i][0] == '-') {
+            usage = true;
+        } else {
+            collect_inputs(argv[i], &inputs);
+        }
+    }
+    if (usage || inputs.empty()) {
+        fprintf(stderr, "usage: %s [--pkg model.pkg] [--label walk|ebike|still] [--quiet] [--segments] "
+                        "[--check-stream] log.csv|dir ...\n", argv[0]);
+        return 2;
+    }
+    if (pkg && !host_partition_load(pkg)) {
+        fprintf(stderr, "cannot read %s\n", pkg);
+        return 1;
+    }
+
+    if (opt.segments) {
+        ml_window_set_segment_cb(print_segment);
+    }
+    if (!ml_window_init()) {
+        fprintf(stderr, "ml_window_init failed\n");
+        return 1;
+    }
+    const int hop = ml_model_hop() > 0 ? ml_model_hop() : CONFIG_JOFTMODE_ML_HOP_FRAMES;
+    if (opt.check_stream && !CONFIG_JOFTMODE_ML_STREAMING) {
+        fprintf(stderr, "--check-stream: built without ML_HOST_STREAMING, both paths are full Invoke\n");
+    }
+
+    Tally total;
+    int files = 0;
+    for (const std::string& path : inputs) {
+        Tally t;
+        if (!replay_file(path, opt, hop, &t)) continue;
+        print_tally(path.c_str(), t, hop);
+        total.add(t);
+        ++files;
+    }
+    if (files == 0) return 1;
+
+    printf("\n");
+    if (files > 1) print_tally("total", total, hop);
+    static const char* const kPredNames[2] = {"walk", "ebike"};
+    print_confusion("per-window prediction", &total.raw[0][0], 2, kPredNames);
+    print_confusion("smoothed activity", &total.act[0][0], N_TRUTH, kTruthNames);
+
+    ml_stats_t st = {};
+    ml_get_stats(&st);
+    printf("%" PRIu32 " windows, %" PRIu32 " inferences, %" PRIu32 " failures, hop %d\n",
+           st.windows, st.inferences, st.failures, hop);
+    printf("resample: %" PRIu32 " rows -> %" PRIu32 " frames, dt %.0f..%.0f ms, jitter avg %.1f ms,"
+           " %" PRIu32 " gaps, %" PRIu32 " duplicates\n",
+           st.in_samples, st.frames, st.in_dt_min_us / 1000.0, st.in_dt_max_us / 1000.0,
+           st.in_intervals ? st.in_jitter_us / 1000.0 / st.in_intervals : 0.0, st.in_gaps, st.in_dup);
+    if (st.gated_windows > 0) {
+        printf("gate: %" PRIu32 " windows (%.1f%%) answered without inference\n", st.gated_windows,
+               100.0 * st.gated_windows / st.windows);
+    }
+    if (st.inferences > 0) {
+        printf("inference: avg %.1f us, max %" PRIu32 " us (window prep avg %.2f us)\n",
+               (double)st.total_latency_us / st.inferences, st.max_latency_us,
+               st.windows ? (double)st.total_prep_us / st.windows : 0.0);
+    }
+    ml_profile_dump();
+    return 0;
+}
@@ -0,0 +1,11 @@
+#pragma once
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+// 主机上“周期”是纳秒（esp_rom_get_cpu_ticks_per_us() 返回 1000）
+uint32_t esp_cpu_get_cycle_count(void);
+#ifdef __cplusplus
+}
+#endif
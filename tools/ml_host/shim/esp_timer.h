@@ -0,0 +1,12 @@
+#pragma once
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+// 回放时由 ml_host 对齐到日志行的时间戳（<0 表示只用真实的单调时钟）
+void host_timer_set(int64_t us);
+int64_t esp_timer_get_time(void);
+#ifdef __cplusplus
+}
+#endif
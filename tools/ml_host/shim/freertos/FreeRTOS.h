@@ -0,0 +1,11 @@
+#pragma once
+#include <stdint.h>
+
+// 主机上单线程回放，临界区为空
+typedef int portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED    0
+#define taskENTER_CRITICAL(mux)         ((void)(mux))
+#define taskEXIT_CRITICAL(mux)          ((void)(mux))
+#define pdPASS                          1
+#define tskNO_AFFINITY                  0x7FFFFFFF
+typedef void *TaskHandle_t;
@@ -0,0 +1,135 @@
+// Host implementations of the few ESP-IDF services the ML component uses.
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "esp_cpu.h"
+#include "esp_err.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "esp_timer.h"
+
+#define HOST_PARTITION_SIZE 0x40000
+
+static int64_t s_time_base_us = -1;     // host_timer_set 设的时间
+static int64_t s_time_base_ns = 0;      // 设的那一刻的单调时钟
+static uint8_t *s_part_data = NULL;
+static esp_partition_t s_part = {0, HOST_PARTITION_SIZE, 4096, "model"};
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    static char buf[16];
+    snprintf(buf, sizeof(buf), "0x%x", code);
+    return buf;
+}
+
+static int64_t mono_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void host_timer_set(int64_t us)
+{
+    s_time_base_us = us;
+    s_time_base_ns = mono_ns();
+}
+
+// 日志时间 + 之后真实流逝的时间：turn rate 按日志里的间隔算，耗时统计仍是真实的
+int64_t esp_timer_get_time(void)
+{
+    if (s_time_base_us < 0) {
+        return mono_ns() / 1000;
+    }
+    return s_time_base_us + (mono_ns() - s_time_base_ns) / 1000;
+}
+
+uint32_t esp_cpu_get_cycle_count(void)
+{
+    return (uint32_t)mono_ns();
+}
+
+uint32_t esp_rom_crc32_le(uint32_t crc, uint8_t const *buf, uint32_t len)
+{
+    crc = ~crc;
+    while (len--) {
+        crc ^= *buf++;
+        for (int k = 0; k < 8; ++k) {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+        }
+    }
+    return ~crc;
+}
+
+bool host_partition_load(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return false;
+    }
+    free(s_part_data);
+    s_part_data = malloc(HOST_PARTITION_SIZE);
+    memset(s_part_data, 0xFF, HOST_PARTITION_SIZE);
+    size_t n = fread(s_part_data, 1, HOST_PARTITION_SIZE, f);
+    fclose(f);
+    return n > 0;
+}
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char *label)
+{
+    (void)type;
+    (void)subtype;
+    (void)label;
+    return s_part_data ? &s_part : NULL;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *part, size_t offset, void *dst, size_t size)
+{
+    if (offset + size > part->size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(dst, s_part_data + offset, size);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *part, size_t offset, const void *src, size_t size)
+{
+    if (offset + size > part->size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    for (size_t i = 0; i < size; ++i) {
+        s_part_data[offset + i] &= ((const uint8_t *)src)[i];
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *part, size_t offset, size_t size)
+{
+    if (offset + size > part->size || offset % part->erase_size || size % part->erase_size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memset(s_part_data + offset, 0xFF, size);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_mmap(const esp_partition_t *part, size_t offset, size_t size,
+                             esp_partition_mmap_memory_t memory, const void **out_ptr,
+                             esp_partition_mmap_handle_t *out_handle)
+{
+    (void)memory;
+    if (offset + size > part->size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    *out_ptr = s_part_data + offset;
+    *out_handle = 1;
+    return ESP_OK;
+}
+
+void esp_partition_munmap(esp_partition_mmap_handle_t handle)
+{
+    (void)handle;
+}
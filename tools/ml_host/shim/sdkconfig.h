@@ -0,0 +1,31 @@
+// Host build configuration (mirrors the firmware's JOFTMODE_* ML options).
+// Anything here can be overridden from CMake with -DCONFIG_...=value.
+#pragma once
+
+#define CONFIG_JOFTMODE_ENABLE_ML 1
+#ifndef CONFIG_JOFTMODE_ML_HOP_FRAMES
+#define CONFIG_JOFTMODE_ML_HOP_FRAMES 5
+#endif
+// 推理在调用方线程里同步跑，回放时结果和输入行一一对应
+#define CONFIG_JOFTMODE_ML_TASK 0
+#ifndef CONFIG_JOFTMODE_ML_STREAMING
+#define CONFIG_JOFTMODE_ML_STREAMING 1
+#endif
+#ifndef CONFIG_JOFTMODE_ML_PROFILE
+#define CONFIG_JOFTMODE_ML_PROFILE 1
+#endif
+#define CONFIG_JOFTMODE_ML_PROFILE_EVERY 0
+#ifndef CONFIG_JOFTMODE_ML_GATE
+#define CONFIG_JOFTMODE_ML_GATE 1
+#endif
+#define CONFIG_JOFTMODE_ML_GATE_STILL_ACC_MG 30
+#define CONFIG_JOFTMODE_ML_GATE_STILL_GYRO_DPS 5
+#define CONFIG_JOFTMODE_ML_GATE_SLOW_CMS 200
+#define CONFIG_JOFTMODE_ML_GATE_HYST_PCT 50
+#define CONFIG_JOFTMODE_ML_BUILTIN_MODEL 1
+#define CONFIG_JOFTMODE_ML_ARENA_INTERNAL 1
+#define CONFIG_JOFTMODE_ML_ARENA_KB 64
+#define CONFIG_JOFTMODE_ML_ARENA_AUTOSIZE 1
+#define CONFIG_JOFTMODE_ML_SMOOTH_W2E_PERMILLE 10
+#define CONFIG_JOFTMODE_ML_SMOOTH_E2W_PERMILLE 10
+#define CONFIG_JOFTMODE_ML_SEG_MIN_S 10